@@ -5,9 +5,111 @@
 #include "env.h"
 #include "losglobal.h"
 
+// The level is split into square regions, and each one has the set of
+// monsters in it. A monster is in no region if it is not on the map.
+#define REGION_SHIFT 3
+#define REGIONS_X ((GXM + (1 << REGION_SHIFT) - 1) >> REGION_SHIFT)
+#define REGIONS_Y ((GYM + (1 << REGION_SHIFT) - 1) >> REGION_SHIFT)
+
+static monster_set region_monsters[REGIONS_X][REGIONS_Y];
+// The region of each monster slot, plus one; 0 for none.
+static int16_t monster_region[MAX_MONSTERS];
+
+static int _region_of(const coord_def &c)
+{
+    if (!map_bounds(c))
+        return 0;
+    return (c.x >> REGION_SHIFT) * REGIONS_Y + (c.y >> REGION_SHIFT) + 1;
+}
+
+void monster_index_moved(const monster &mon)
+{
+    // Monsters outside env.mons are temporary, and never iterated over.
+    const monster *first = env.mons.buffer();
+    if (&mon < first || &mon >= first + MAX_MONSTERS)
+        return;
+
+    const int i = &mon - first;
+    const int region = _region_of(mon.pos());
+    const int old_region = monster_region[i];
+    if (region == old_region)
+        return;
+
+    const uint64_t bit = (uint64_t)1 << (i & 63);
+    if (old_region)
+        (&region_monsters[0][0])[old_region - 1][i >> 6] &= ~bit;
+    if (region)
+        (&region_monsters[0][0])[region - 1][i >> 6] |= bit;
+    monster_region[i] = region;
+}
+
+bool monster_index_current(const monster &mon)
+{
+    return monster_region[mon.mindex()] == _region_of(mon.pos());
+}
+
+// Finds the monsters up to slot last that could be within LOS_RADIUS of c,
+// or that could be anywhere for LOS_NONE.
+static void _monsters_near(monster_set &set, const coord_def &c, los_type los,
+                           int last)
+{
+    const int words = last < 0 ? 0 : (last >> 6) + 1;
+    memset(set, 0, sizeof(set));
+    if (los == LOS_NONE)
+    {
+        memset(set, 0xff, words * sizeof(uint64_t));
+        return;
+    }
+    if (!map_bounds(c))
+        return;
+
+    const int x0 = max(c.x - LOS_RADIUS, 0) >> REGION_SHIFT;
+    const int x1 = min(c.x + LOS_RADIUS, GXM - 1) >> REGION_SHIFT;
+    const int y0 = max(c.y - LOS_RADIUS, 0) >> REGION_SHIFT;
+    const int y1 = min(c.y + LOS_RADIUS, GYM - 1) >> REGION_SHIFT;
+    for (int x = x0; x <= x1; ++x)
+        for (int y = y0; y <= y1; ++y)
+            for (int w = 0; w < words; ++w)
+                set[w] |= region_monsters[x][y][w];
+}
+
+// Index of the lowest set bit of a nonzero word.
+static inline int _lowest_bit(uint64_t word)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    int i = 0;
+    while (!(word & 1))
+    {
+        word >>= 1;
+        ++i;
+    }
+    return i;
+#endif
+}
+
+// The first slot after i in the set, or last + 1 if there is none.
+static int _next_monster(const monster_set &set, int i, int last)
+{
+    ++i;
+    while (i <= last)
+    {
+        const uint64_t word = set[i >> 6] >> (i & 63);
+        if (word)
+        {
+            i += _lowest_bit(word);
+            break;
+        }
+        i = (i | 63) + 1;
+    }
+    return i > last ? last + 1 : i;
+}
+
 actor_near_iterator::actor_near_iterator(coord_def c, los_type los)
     : center(c), _los(los), viewer(nullptr), i(-1), max(env.max_mon_index)
 {
+    _monsters_near(near, center, _los, max);
     if (!valid(&you))
         advance();
 }
@@ -15,6 +117,7 @@ actor_near_iterator::actor_near_iterator(coord_def c, los_type los)
 actor_near_iterator::actor_near_iterator(const actor* a, los_type los)
     : center(a->pos()), _los(los), viewer(a), i(-1), max(env.max_mon_index)
 {
+    _monsters_near(near, center, _los, max);
     if (!valid(&you))
         advance();
 }
@@ -64,7 +167,7 @@ bool actor_near_iterator::valid(const actor* a) const
 void actor_near_iterator::advance()
 {
     do
-         if (++i > max)
+         if ((i = _next_monster(near, i, max)) > max)
              return;
     while (!valid(**this));
 }
@@ -72,18 +175,18 @@ void actor_near_iterator::advance()
 //////////////////////////////////////////////////////////////////////////
 
 monster_near_iterator::monster_near_iterator(coord_def c, los_type los)
-    : center(c), _los(los), viewer(nullptr), i(0), max(env.max_mon_index)
+    : center(c), _los(los), viewer(nullptr), i(-1), max(env.max_mon_index)
 {
-    if (!valid(&env.mons[0]))
-        advance();
+    _monsters_near(near, center, _los, max);
+    advance();
     begin_point = i;
 }
 
 monster_near_iterator::monster_near_iterator(const actor *a, los_type los)
-    : center(a->pos()), _los(los), viewer(a), i(0), max(env.max_mon_index)
+    : center(a->pos()), _los(los), viewer(a), i(-1), max(env.max_mon_index)
 {
-    if (!valid(&env.mons[0]))
-        advance();
+    _monsters_near(near, center, _los, max);
+    advance();
     begin_point = i;
 }
 
@@ -154,7 +257,7 @@ bool monster_near_iterator::valid(const monster* a) const
 void monster_near_iterator::advance()
 {
     do
-         if (++i > max)
+         if ((i = _next_monster(near, i, max)) > max)
              return;
     while (!valid(**this));
 }
@@ -5,8 +5,23 @@
 
 #pragma once
 
+#include <cstdint>
+
+#include "defines.h"
 #include "los-type.h"
 
+// A set of monster slots, as a bitmap.
+#define MONSTER_SET_WORDS ((MAX_MONSTERS + 63) / 64)
+typedef uint64_t monster_set[MONSTER_SET_WORDS];
+
+// The near iterators only look at monsters that an index of which part of
+// the level each monster is in says could be in range. It is updated by
+// monster::set_position(); anything else that moves a monster in env.mons
+// has to call this.
+void monster_index_moved(const monster &mon);
+// Whether the index has the monster where it is, for debugging.
+bool monster_index_current(const monster &mon);
+
 class actor_near_iterator
 {
 public:
@@ -25,6 +40,7 @@ protected:
     const actor* viewer;
     int i;
     const int max;
+    monster_set near;
 
     bool valid(const actor* a) const;
     void advance();
@@ -52,6 +68,7 @@ protected:
     const actor* viewer;
     int i;
     const int max;
+    monster_set near;
     int begin_point;
 
     bool valid(const monster* a) const;
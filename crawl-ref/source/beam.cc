@@ -1178,21 +1178,49 @@ void bolt::affect_cell()
         affect_ground();
 }
 
-static void _undo_tracer(bolt &orig, bolt &copy)
-{
-    // FIXME: we should have a better idea of what gets changed!
-    orig.target           = copy.target;
-    orig.source           = copy.source;
-    orig.aimed_at_spot    = copy.aimed_at_spot;
-    orig.aimed_at_feet    = copy.aimed_at_feet;
-    orig.extra_range_used = copy.extra_range_used;
-    orig.ray              = copy.ray;
-    orig.colour           = copy.colour;
-    orig.flavour          = copy.flavour;
-    orig.real_flavour     = copy.real_flavour;
-    orig.bounces          = copy.bounces;
-    orig.bounce_pos       = copy.bounce_pos;
-}
+// The parts of a bolt that firing a tracer changes and has to put back.
+// Much cheaper to keep around than a copy of the whole bolt, with its
+// strings, path and hit counts.
+// FIXME: we should have a better idea of what gets changed!
+struct tracer_undo
+{
+    coord_def target;
+    coord_def source;
+    bool      aimed_at_spot;
+    bool      aimed_at_feet;
+    int       extra_range_used;
+    ray_def   ray;
+    colour_t  colour;
+    beam_type flavour;
+    beam_type real_flavour;
+    int       bounces;
+    coord_def bounce_pos;
+
+    explicit tracer_undo(const bolt &orig)
+        : target(orig.target), source(orig.source),
+          aimed_at_spot(orig.aimed_at_spot), aimed_at_feet(orig.aimed_at_feet),
+          extra_range_used(orig.extra_range_used), ray(orig.ray),
+          colour(orig.colour), flavour(orig.flavour),
+          real_flavour(orig.real_flavour), bounces(orig.bounces),
+          bounce_pos(orig.bounce_pos)
+    {
+    }
+
+    void restore(bolt &orig) const
+    {
+        orig.target           = target;
+        orig.source           = source;
+        orig.aimed_at_spot    = aimed_at_spot;
+        orig.aimed_at_feet    = aimed_at_feet;
+        orig.extra_range_used = extra_range_used;
+        orig.ray              = ray;
+        orig.colour           = colour;
+        orig.flavour          = flavour;
+        orig.real_flavour     = real_flavour;
+        orig.bounces          = bounces;
+        orig.bounce_pos       = bounce_pos;
+    }
+};
 
 // This saves some important things before calling fire().
 void bolt::fire()
@@ -1204,19 +1232,17 @@ void bolt::fire()
 
     if (is_tracer)
     {
-        bolt boltcopy = *this;
-        if (special_explosion != nullptr)
-            boltcopy.special_explosion = new bolt(*special_explosion);
+        const tracer_undo undo(*this);
+        // Only restored if there is a special explosion.
+        const tracer_undo explosion_undo(special_explosion ? *special_explosion
+                                                           : *this);
 
         do_fire();
 
         if (special_explosion != nullptr)
-        {
-            _undo_tracer(*special_explosion, *boltcopy.special_explosion);
-            delete boltcopy.special_explosion;
-        }
+            explosion_undo.restore(*special_explosion);
 
-        _undo_tracer(*this, boltcopy);
+        undo.restore(*this);
     }
     else
         do_fire();
@@ -2247,6 +2273,199 @@ int silver_damages_victim(actor* victim, int damage, string &dmg_msg)
     return ret;
 }
 
+static bool _same_ray(const ray_def &a, const ray_def &b)
+{
+    return a.r.start.x == b.r.start.x && a.r.start.y == b.r.start.y
+           && a.r.dir.x == b.r.dir.x && a.r.dir.y == b.r.dir.y
+           && a.on_corner == b.on_corner && a.cycle_idx == b.cycle_idx;
+}
+
+// What decides where a monster tracer goes and what it makes of what it
+// hits. How the beam looks and sounds doesn't matter to a tracer, and what
+// firing changes is either put back by bolt::fire() or reset by
+// fire_tracer() first.
+struct tracer_key
+{
+    coord_def source;
+    coord_def target;
+    int range;
+    beam_type flavour;
+    beam_type real_flavour;
+    spell_type origin_spell;
+    mid_t source_id;
+    mon_attitude_type attitude;
+    killer_type thrower;
+    dice_def damage;
+    int ench_power;
+    int hit;
+    int ex_size;
+    ac_type ac_rule;
+    const item_def *item;
+    bool drop_item;
+    bool pierce;
+    bool is_explosion;
+    bool is_death_effect;
+    bool aimed_at_spot;
+    bool aimed_at_feet;
+    bool affects_nothing;
+    bool no_saving_throw;
+    bool chose_ray;
+    ray_def ray;
+    coord_def bounce_pos;
+    // Some beams are told apart by name.
+    string name;
+    string aux_source;
+    bool explode_only;
+    bool explosion_hole;
+
+    tracer_key(const bolt &beam, bool explode, bool hole)
+        : source(beam.source), target(beam.target), range(beam.range),
+          flavour(beam.flavour), real_flavour(beam.real_flavour),
+          origin_spell(beam.origin_spell), source_id(beam.source_id),
+          attitude(beam.attitude), thrower(beam.thrower),
+          damage(beam.damage), ench_power(beam.ench_power), hit(beam.hit),
+          ex_size(beam.ex_size), ac_rule(beam.ac_rule), item(beam.item),
+          drop_item(beam.drop_item), pierce(beam.pierce),
+          is_explosion(beam.is_explosion),
+          is_death_effect(beam.is_death_effect),
+          aimed_at_spot(beam.aimed_at_spot),
+          aimed_at_feet(beam.aimed_at_feet),
+          affects_nothing(beam.affects_nothing),
+          no_saving_throw(beam.no_saving_throw), chose_ray(beam.chose_ray),
+          ray(beam.ray), bounce_pos(beam.bounce_pos), name(beam.name),
+          aux_source(beam.aux_source), explode_only(explode), explosion_hole(hole)
+    {
+    }
+
+    bool operator==(const tracer_key &o) const
+    {
+        // Most likely to differ first.
+        return target == o.target && source == o.source
+            && source_id == o.source_id && origin_spell == o.origin_spell
+            && flavour == o.flavour && real_flavour == o.real_flavour
+            && range == o.range && ex_size == o.ex_size
+            && explode_only == o.explode_only
+            && explosion_hole == o.explosion_hole
+            && damage.num == o.damage.num && damage.size == o.damage.size
+            && ench_power == o.ench_power && hit == o.hit
+            && attitude == o.attitude && thrower == o.thrower
+            && ac_rule == o.ac_rule && item == o.item
+            && drop_item == o.drop_item && pierce == o.pierce
+            && is_explosion == o.is_explosion
+            && is_death_effect == o.is_death_effect
+            && aimed_at_spot == o.aimed_at_spot
+            && aimed_at_feet == o.aimed_at_feet
+            && affects_nothing == o.affects_nothing
+            && no_saving_throw == o.no_saving_throw
+            && chose_ray == o.chose_ray
+            && (!chose_ray || _same_ray(ray, o.ray))
+            && bounce_pos == o.bounce_pos && name == o.name
+            && aux_source == o.aux_source;
+    }
+};
+
+// What firing a monster tracer leaves in the beam: the results callers look
+// at, and what fire() and explode() change without putting back.
+struct tracer_result
+{
+    tracer_info foe_info;
+    tracer_info friend_info;
+    vector<coord_def> path_taken;
+    beam_type flavour;
+    beam_type real_flavour;
+    int range;
+    bool in_explosion_phase;
+    bool passed_target;
+    bool obvious_effect;
+    bool seen;
+    bool heard;
+
+    explicit tracer_result(const bolt &beam)
+        : foe_info(beam.foe_info), friend_info(beam.friend_info),
+          path_taken(beam.path_taken), flavour(beam.flavour),
+          real_flavour(beam.real_flavour), range(beam.range),
+          in_explosion_phase(beam.in_explosion_phase),
+          passed_target(beam.passed_target),
+          obvious_effect(beam.obvious_effect), seen(beam.seen),
+          heard(beam.heard)
+    {
+    }
+
+    void restore(bolt &beam) const
+    {
+        beam.foe_info           = foe_info;
+        beam.friend_info        = friend_info;
+        beam.path_taken         = path_taken;
+        beam.flavour            = flavour;
+        beam.real_flavour       = real_flavour;
+        beam.range              = range;
+        beam.in_explosion_phase = in_explosion_phase;
+        beam.passed_target      = passed_target;
+        beam.obvious_effect     = obvious_effect;
+        beam.seen               = seen;
+        beam.heard              = heard;
+    }
+};
+
+struct cached_tracer
+{
+    tracer_key key;
+    tracer_result result;
+};
+
+// Enough for everything one monster looks at while picking a spell.
+#define MAX_CACHED_TRACERS 64
+
+static int tracer_cache_depth = 0;
+static int tracer_cache_hits = 0;
+static vector<cached_tracer> tracer_cache;
+
+tracer_cache_scope::tracer_cache_scope()
+{
+    if (!tracer_cache_depth++)
+    {
+        tracer_cache.clear();
+        tracer_cache_hits = 0;
+    }
+}
+
+tracer_cache_scope::~tracer_cache_scope()
+{
+    if (!--tracer_cache_depth)
+        tracer_cache.clear();
+}
+
+void tracer_cache_scope::forget()
+{
+    tracer_cache.clear();
+}
+
+int tracer_cache_scope::hits() const
+{
+    return tracer_cache_hits;
+}
+
+static const tracer_result *_cached_tracer(const tracer_key &key)
+{
+    for (const cached_tracer &cached : tracer_cache)
+        if (cached.key == key)
+            return &cached.result;
+    return nullptr;
+}
+
+static void _fire_tracer_beam(bolt &pbolt, bool explode_only,
+                              bool explosion_hole)
+{
+    // Fire!
+    if (explode_only)
+        pbolt.explode(false, explosion_hole);
+    else
+        pbolt.fire();
+
+    // Unset tracer flag (convenience).
+    pbolt.is_tracer = false;
+}
+
 //  Used by monsters in "planning" which spell to cast. Fires off a "tracer"
 //  which tells the monster what it'll hit if it breathes/casts etc.
 //
@@ -2290,14 +2509,28 @@ void fire_tracer(const monster* mons, bolt &pbolt, bool explode_only,
 
     pbolt.in_explosion_phase = false;
 
-    // Fire!
-    if (explode_only)
-        pbolt.explode(false, explosion_hole);
-    else
-        pbolt.fire();
+    // A special explosion is a bolt of its own that firing changes, which
+    // can't be put back from the cache.
+    if (!tracer_cache_depth || pbolt.special_explosion)
+    {
+        _fire_tracer_beam(pbolt, explode_only, explosion_hole);
+        return;
+    }
 
-    // Unset tracer flag (convenience).
-    pbolt.is_tracer = false;
+    tracer_key key(pbolt, explode_only, explosion_hole);
+    if (const tracer_result *result = _cached_tracer(key))
+    {
+        result->restore(pbolt);
+        pbolt.is_tracer = false;
+        ++tracer_cache_hits;
+        return;
+    }
+
+    _fire_tracer_beam(pbolt, explode_only, explosion_hole);
+
+    if (tracer_cache.size() >= MAX_CACHED_TRACERS)
+        tracer_cache.erase(tracer_cache.begin());
+    tracer_cache.push_back({move(key), tracer_result(pbolt)});
 }
 
 set<coord_def> create_feat_splash(coord_def center,
@@ -359,6 +359,23 @@ bool curare_actor(actor* source, actor* target, string name,
 int silver_damages_victim(actor* victim, int damage, string &dmg_msg);
 void fire_tracer(const monster* mons, bolt &pbolt,
                   bool explode_only = false, bool explosion_hole = false);
+
+// While one of these exists, a monster tracer fired from the same place at
+// the same target with the same beam settings as an earlier one gets that
+// one's results without walking the ray again. Only for stretches in which
+// nothing a tracer looks at can change, such as a monster making up its mind
+// about what to cast.
+class tracer_cache_scope
+{
+public:
+    tracer_cache_scope();
+    ~tracer_cache_scope();
+    // Drop what has been cached so far, e.g. after the caster's foe changed.
+    void forget();
+    // How many tracers were answered from the cache since the outermost
+    // scope was opened.
+    int hits() const;
+};
 spret zapping(zap_type ztype, int power, bolt &pbolt,
                    bool needs_tracer = false, const char* msg = nullptr,
                    bool fail = false);
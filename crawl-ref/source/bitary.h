@@ -9,6 +9,7 @@
 #pragma once
 
 #include <bitset>
+#include <cstdint>
 #include <vector>
 
 #include "debug.h"
@@ -112,6 +113,51 @@ public:
     }
 };
 
+/**
+ * A fixed capacity bit vector stored as 64-bit words, aligned so that
+ * several words can be processed at once. Unlike FixedBitVector, this
+ * exposes its words, for kernels that work on them directly (see los.cc).
+ */
+template <unsigned int SIZE> class alignas(32) FixedBitWords
+{
+public:
+    enum { NWORDS = (SIZE + 63) / 64 };
+
+    FixedBitWords()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        for (unsigned int w = 0; w < NWORDS; ++w)
+            words[w] = 0;
+    }
+
+    inline bool get(unsigned int i) const
+    {
+#ifdef ASSERTS
+        if (i >= SIZE)
+            die("bit vector range error: %d / %u", (int)i, SIZE);
+#endif
+        return words[i / 64] & (uint64_t(1) << (i % 64));
+    }
+
+    inline void set(unsigned int i, bool value = true)
+    {
+#ifdef ASSERTS
+        if (i >= SIZE)
+            die("bit vector range error: %d / %u", (int)i, SIZE);
+#endif
+        if (value)
+            words[i / 64] |= uint64_t(1) << (i % 64);
+        else
+            words[i / 64] &= ~(uint64_t(1) << (i % 64));
+    }
+
+    uint64_t words[NWORDS];
+};
+
 template <unsigned int SIZEX, unsigned int SIZEY> class FixedBitArray
 {
 protected:
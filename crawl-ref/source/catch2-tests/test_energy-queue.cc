@@ -0,0 +1,166 @@
+#include <map>
+#include <queue>
+#include <random>
+#include <tuple>
+
+#include "catch_amalgamated.hpp"
+
+#include "AppHdr.h"
+
+#include "energy-queue.h"
+
+// The monster queue as it was before energy_queue.
+class MonsterActionQueueCompare
+{
+public:
+    bool operator() (pair<int, int> m1, pair<int, int> m2)
+    {
+        return m1.second < m2.second;
+    }
+};
+
+class heap_queue
+{
+public:
+    bool empty() const { return heap.empty(); }
+    void push(int item, int energy) { heap.emplace(item, energy); }
+    pair<int, int> top() const { return heap.top(); }
+    void pop() { heap.pop(); }
+
+private:
+    priority_queue<pair<int, int>, vector<pair<int, int>>,
+                   MonsterActionQueueCompare> heap;
+};
+
+// Most energy first, then first pushed: a queue that agrees with the heap
+// except among equal energies.
+class stable_queue
+{
+public:
+    stable_queue() : pushed(0) { }
+
+    bool empty() const { return items.empty(); }
+    void push(int item, int energy) { items[{-energy, pushed++}] = item; }
+    pair<int, int> top() const
+    {
+        return { items.begin()->second, -items.begin()->first.first };
+    }
+    void pop() { items.erase(items.begin()); }
+
+private:
+    map<pair<int, int>, int> items;
+    int pushed;
+};
+
+struct sim_monster
+{
+    int speed;
+    int energy;
+};
+
+// Replays some turns of handle_monsters() with a seeded generator, and
+// returns who acted, in order, with their energy at the time.
+template <typename Q>
+static vector<pair<int, int>> _replay(unsigned seed, int nmons, int turns)
+{
+    mt19937 gen(seed);
+    vector<sim_monster> mons(nmons);
+    for (sim_monster &m : mons)
+        m = { 5 + (int)(gen() % 30), (int)(gen() % 80) };
+
+    const int threshold = 80;
+    vector<pair<int, int>> acted;
+    Q queue;
+    // As queue_monster_for_action().
+    auto queue_for_action = [&](int i) { queue.push(i, mons[i].energy); };
+
+    for (int turn = 0; turn < turns; ++turn)
+    {
+        // As _start_monster_turn().
+        for (int i = 0; i < nmons; ++i)
+        {
+            mons[i].energy += mons[i].speed;
+            if (mons[i].energy >= threshold)
+                queue_for_action(i);
+        }
+
+        while (!queue.empty())
+        {
+            const int i = queue.top().first;
+            const int old_energy = queue.top().second;
+            queue.pop();
+            sim_monster &mon = mons[i];
+            if (mon.energy < threshold)
+                continue;
+
+            if (old_energy == mon.energy)
+            {
+                acted.emplace_back(i, mon.energy);
+                mon.energy -= 70 + gen() % 60;
+
+                // Sometimes give someone else energy, and queue them, which
+                // leaves their old entry stale.
+                if (gen() % 8 == 0)
+                {
+                    const int other = gen() % nmons;
+                    mons[other].energy += gen() % 40;
+                    queue_for_action(other);
+                }
+            }
+
+            if (mon.energy >= threshold)
+                queue_for_action(i);
+        }
+    }
+    return acted;
+}
+
+TEST_CASE( "Energy queues pop in the same order as the old heap",
+           "[single-file]" ) {
+
+    mt19937 gen(1);
+    energy_queue<int> queue;
+    heap_queue heap;
+    for (int round = 0; round < 100; ++round)
+    {
+        // Few distinct energies, so that there are plenty of ties.
+        for (int i = 0, n = gen() % 40; i < n; ++i)
+        {
+            const int energy = gen() % 8;
+            queue.push(round * 100 + i, energy);
+            heap.push(round * 100 + i, energy);
+        }
+        for (int i = 0, n = gen() % 40; i < n && !heap.empty(); ++i)
+        {
+            REQUIRE(queue.top() == heap.top());
+            queue.pop();
+            heap.pop();
+        }
+    }
+    while (!heap.empty())
+    {
+        REQUIRE(queue.top() == heap.top());
+        queue.pop();
+        heap.pop();
+    }
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE( "Replayed monster turns act exactly as with the old heap",
+           "[single-file]" ) {
+
+    bool ties_matter = false;
+    for (unsigned seed = 1; seed <= 20; ++seed)
+    {
+        const auto expected = _replay<heap_queue>(seed, 200, 50);
+        const auto actual = _replay<energy_queue<int>>(seed, 200, 50);
+        REQUIRE(expected.size() > 1000);
+        REQUIRE(actual == expected);
+
+        if (_replay<stable_queue>(seed, 200, 50) != expected)
+            ties_matter = true;
+    }
+    // The replays have ties that a different tie order would act otherwise,
+    // so the comparison above covers the heap's order among them.
+    REQUIRE(ties_matter);
+}
@@ -0,0 +1,215 @@
+#include "catch_amalgamated.hpp"
+
+#include "AppHdr.h"
+
+#include <cstdio>
+#include <cstring>
+#include <zlib.h>
+
+#include "endianness.h"
+#include "errors.h"
+#include "package.h"
+#include "syscalls.h"
+
+static const char *test_save = "test_package.tmp";
+
+static vector<char> _test_data(size_t len)
+{
+    vector<char> data(len);
+    // Some of it repetitive, some of it not.
+    uint32_t x = 12345;
+    for (size_t i = 0; i < len; i++)
+    {
+        x = x * 1103515245 + 12345;
+        data[i] = (i % 100 < 70) ? (char)(i / 100 % 7) : (char)(x >> 24);
+    }
+    return data;
+}
+
+static void _write_chunk(package &save, const string &name,
+                         const vector<char> &data)
+{
+    chunk_writer out(&save, name);
+    // In uneven pieces, to cross frame boundaries mid-write.
+    for (size_t at = 0; at < data.size(); at += 5000)
+        out.write(&data[at], min<size_t>(5000, data.size() - at));
+}
+
+static vector<char> _read_chunk(package &save, const string &name)
+{
+    chunk_reader in(&save, name);
+    vector<char> data;
+    in.read_all(data);
+    return data;
+}
+
+TEST_CASE( "Save chunks survive a round trip", "[single-file]" ) {
+
+    const vector<char> small = _test_data(100);
+    const vector<char> big = _test_data(5 * CHUNK_FRAME_SIZE + 321);
+    const vector<char> empty;
+
+    for (auto codec : { chunk_codec::store, chunk_codec::zlib,
+                        chunk_codec::lz })
+    {
+        {
+            package save(test_save, true, true);
+            save.set_codec(codec);
+            _write_chunk(save, "small", small);
+            _write_chunk(save, "big", big);
+            _write_chunk(save, "empty", empty);
+        }
+        {
+            package save(test_save, false);
+            REQUIRE(_read_chunk(save, "small") == small);
+            REQUIRE(_read_chunk(save, "big") == big);
+            REQUIRE(_read_chunk(save, "empty") == empty);
+            if (codec != chunk_codec::store)
+                REQUIRE(save.get_chunk_compressed_length("big") < big.size());
+        }
+        unlink_u(test_save);
+    }
+}
+
+TEST_CASE( "Chunks written after the file was mapped can be read", "[single-file]" ) {
+
+    const vector<char> first = _test_data(2 * CHUNK_FRAME_SIZE);
+    const vector<char> second = _test_data(CHUNK_FRAME_SIZE + 7);
+
+    package save(test_save, true, true);
+    _write_chunk(save, "a", first);
+    save.commit();
+    REQUIRE(_read_chunk(save, "a") == first);
+
+    // The file grows past what was mapped.
+    _write_chunk(save, "b", second);
+    REQUIRE(_read_chunk(save, "b") == second);
+    REQUIRE(_read_chunk(save, "a") == first);
+
+    // A reader that is part way through a frame when the file grows.
+    chunk_reader in(&save, "a");
+    vector<char> start(100);
+    REQUIRE(in.read(&start[0], start.size()) == start.size());
+    _write_chunk(save, "c", _test_data(3 * CHUNK_FRAME_SIZE));
+    vector<char> rest;
+    in.read_all(rest);
+    start.insert(start.end(), rest.begin(), rest.end());
+    REQUIRE(start == first);
+    REQUIRE(_read_chunk(save, "c") == _test_data(3 * CHUNK_FRAME_SIZE));
+
+    unlink_u(test_save);
+}
+
+// Lay out a save the way older versions did: each chunk a single block
+// holding a bare zlib stream.
+static void _append_zlib_block(vector<char> &file, const vector<char> &data)
+{
+    uLongf len = compressBound(data.size());
+    vector<char> packed(len);
+    REQUIRE(compress2((Bytef*)&packed[0], &len, (const Bytef*)&data[0],
+                      data.size(), Z_DEFAULT_COMPRESSION) == Z_OK);
+    const plen_t head[2] = { htole32((plen_t)len), 0 };
+    file.insert(file.end(), (const char*)head, (const char*)(head + 2));
+    file.insert(file.end(), packed.begin(), packed.begin() + len);
+}
+
+TEST_CASE( "Saves with bare zlib chunks can still be read", "[single-file]" ) {
+
+    const vector<char> data = _test_data(3 * CHUNK_FRAME_SIZE);
+    const string name = "lvl";
+
+    vector<char> file(12); // header, filled in below
+    const plen_t chunk_at = file.size();
+    _append_zlib_block(file, data);
+
+    vector<char> dir;
+    dir.push_back(name.size());
+    dir.insert(dir.end(), name.begin(), name.end());
+    const plen_t start = htole32(chunk_at);
+    dir.insert(dir.end(), (const char*)&start, (const char*)(&start + 1));
+    const plen_t dir_at = file.size();
+    _append_zlib_block(file, dir);
+
+    const uint32_t magic = htole32(0x53534344);
+    memcpy(&file[0], &magic, 4);
+    file[4] = 1; // version
+    const plen_t dir_start = htole32(dir_at);
+    memcpy(&file[8], &dir_start, 4);
+
+    FILE *f = fopen_u(test_save, "wb");
+    REQUIRE(f);
+    REQUIRE(fwrite(&file[0], 1, file.size(), f) == file.size());
+    fclose(f);
+
+    {
+        package save(test_save, true);
+        REQUIRE(_read_chunk(save, name) == data);
+
+        // Mixing in new chunks is fine.
+        _write_chunk(save, "new", data);
+        save.commit();
+        REQUIRE(_read_chunk(save, name) == data);
+        REQUIRE(_read_chunk(save, "new") == data);
+    }
+    unlink_u(test_save);
+}
+
+TEST_CASE( "Damaged save chunks are detected", "[single-file]" ) {
+
+    {
+        package save(test_save, true, true);
+        save.set_codec(chunk_codec::lz);
+        _write_chunk(save, "lvl", _test_data(1000));
+    }
+
+    // Claim the first frame is larger than any frame can be; it sits after
+    // the file header, the block header and the codec byte.
+    FILE *f = fopen_u(test_save, "r+b");
+    REQUIRE(f);
+    fseek(f, 12 + 8 + 1, SEEK_SET);
+    const plen_t bad_len = htole32(CHUNK_FRAME_SIZE + 1);
+    fwrite(&bad_len, sizeof(bad_len), 1, f);
+    fclose(f);
+
+    package save(test_save, false);
+    REQUIRE_THROWS_AS(_read_chunk(save, "lvl"), corrupted_save);
+    unlink_u(test_save);
+}
+
+TEST_CASE( "Background commits keep the last committed state", "[single-file]" ) {
+
+    const vector<char> first = _test_data(3 * CHUNK_FRAME_SIZE);
+    const vector<char> second = _test_data(20000);
+
+    {
+        package save(test_save, true, true);
+        _write_chunk(save, "lvl", first);
+        _write_chunk(save, "you", second);
+        save.commit(true);
+
+        // Replace a chunk several times while the commit may be under way;
+        // none of this may touch what the commit points to.
+        for (int i = 1; i <= 4; i++)
+            _write_chunk(save, "lvl", _test_data(i * CHUNK_FRAME_SIZE / 2));
+        save.delete_chunk("you");
+
+        // As if we crashed.
+        save.abort();
+    }
+    {
+        package save(test_save, true);
+        REQUIRE(_read_chunk(save, "lvl") == first);
+        REQUIRE(_read_chunk(save, "you") == second);
+
+        _write_chunk(save, "lvl", second);
+        save.commit(true);
+        save.commit(true); // nothing new; just waits
+        _write_chunk(save, "you", first);
+    }
+    {
+        package save(test_save, false);
+        REQUIRE(_read_chunk(save, "lvl") == second);
+        REQUIRE(_read_chunk(save, "you") == first);
+    }
+    unlink_u(test_save);
+}
@@ -0,0 +1,84 @@
+#include "catch_amalgamated.hpp"
+
+#include "AppHdr.h"
+#include "pattern.h"
+
+TEST_CASE( "required_literal finds only what every match contains",
+           "[single-file]" )
+{
+    CHECK(text_pattern_set::required_literal("You feel") == "you feel");
+    CHECK(text_pattern_set::required_literal("^You die") == "you die");
+    CHECK(text_pattern_set::required_literal("colou?r") == "colo");
+    CHECK(text_pattern_set::required_literal("ab*cd") == "cd");
+    CHECK(text_pattern_set::required_literal("x{2}yz") == "yz");
+    CHECK(text_pattern_set::required_literal("a.b\\.c") == "b.c");
+    CHECK(text_pattern_set::required_literal("(orc|elf) hits you")
+          == " hits you");
+    CHECK(text_pattern_set::required_literal("[Yy]ou are \\w+ hungry")
+          == "ou are ");
+    CHECK(text_pattern_set::required_literal("foo|barbaz") == "");
+    CHECK(text_pattern_set::required_literal("(?i)foo") == "");
+    CHECK(text_pattern_set::required_literal("ab\\x41cdef") == "ab");
+    CHECK(text_pattern_set::required_literal("\\<orc\\>s") == "orc");
+    CHECK(text_pattern_set::required_literal("\\`You die\\'") == "you die");
+    CHECK(text_pattern_set::required_literal("") == "");
+}
+
+TEST_CASE( "text_pattern_set agrees with trying every pattern",
+           "[single-file]" )
+{
+    const vector<string> regexes =
+    {
+        "\\<orc\\> priest",
+        "\\`It changes",
+        "You feel",
+        "hits? you",
+        "(orc|elf) priest",
+        "^You die",
+        "colou?r",
+        "[0-9]+ gold",
+        "a|b",
+        "feel",
+        "",
+        "elf",
+        "Your .* (glows|shimmers)",
+    };
+    const vector<string> texts =
+    {
+        "You feel a bit better.",
+        "The orc priest hits you.",
+        "The elf priest hit you!",
+        "You die...",
+        "It changes colour.",
+        "You pick up 23 gold.",
+        "Nothing happens.",
+        "Your sword glows red.",
+        "YOU FEEL STRANGE",
+        "",
+    };
+
+    vector<text_pattern> patterns;
+    text_pattern_set set;
+    for (const string &re : regexes)
+    {
+        patterns.emplace_back(re, true);
+        set.add(re);
+    }
+    REQUIRE(set.size() == regexes.size());
+
+    for (const string &text : texts)
+    {
+        int expected = -1;
+        for (size_t i = 0; i < patterns.size(); ++i)
+            if (patterns[i].matches(text))
+            {
+                expected = i;
+                break;
+            }
+
+        const int got = set.find(text, [&](size_t i)
+                                       { return patterns[i].matches(text); });
+        INFO(text);
+        CHECK(got == expected);
+    }
+}
@@ -212,6 +212,24 @@ TEST_CASE( "Basic marshalling/unmarshalling works correctly.", "[single-file]" )
         }
     }
 
+    SECTION ("Integers can be roundtripped.") {
+        const vector<int32_t> numbers = {
+            0, 1, -1, 255, 256, -256, 0x12345678, INT32_MIN, INT32_MAX
+        };
+
+        vector<unsigned char> buf;
+        auto w = writer(&buf);
+        for (int32_t number : numbers)
+            marshallInt(w, number);
+        REQUIRE(buf.size() == numbers.size() * 4);
+        REQUIRE(buf[24] == 0x12);
+
+        auto r = reader(buf);
+        for (int32_t number : numbers)
+            REQUIRE(unmarshallInt(r) == number);
+        REQUIRE(r.valid() == false);
+    }
+
     SECTION ("Map cells can be roundtripped.") {
         auto roundtrip_map_cell = [](const map_cell cell) {
             vector<unsigned char> buf;
@@ -245,3 +263,20 @@ TEST_CASE( "Basic marshalling/unmarshalling works correctly.", "[single-file]" )
         }
     }
 }
+
+TEST_CASE( "Readers can wrap a span of memory", "[single-file]" ) {
+
+    vector<unsigned char> buf;
+    auto w = writer(&buf);
+    marshallInt(w, 123456789);
+    marshallString(w, "plain and simple");
+    marshallUnsigned(w, 1ULL << 40);
+
+    auto r = reader(buf.data(), buf.size());
+    REQUIRE(r.read_span(0) == buf.data());
+    REQUIRE(unmarshallInt(r) == 123456789);
+    REQUIRE(unmarshallString(r) == "plain and simple");
+    REQUIRE(unmarshallUnsigned(r) == 1ULL << 40);
+    REQUIRE(r.valid() == false);
+    REQUIRE_THROWS_AS(unmarshallInt(r), short_read_exception);
+}
@@ -0,0 +1,99 @@
+#include "catch_amalgamated.hpp"
+
+#include "AppHdr.h"
+
+#ifdef USE_TILE_WEB
+
+#include <cstring>
+
+#include <sys/mman.h>
+
+#include "stringutil.h"
+#include "tileweb-ring.h"
+
+// Reads the ring as the webserver does: mapped read-only from the
+// descriptor it is sent, by the layout in tileweb-ring.h.
+class ring_reader
+{
+public:
+    ring_reader(const WebMessageRing &ring)
+        : size(64 + CAPACITY), seq(ring.seq())
+    {
+        map = static_cast<const char *>(
+            mmap(nullptr, size, PROT_READ, MAP_SHARED, ring.fd(), 0));
+        REQUIRE(map != MAP_FAILED);
+    }
+
+    ~ring_reader() { munmap(const_cast<char *>(map), size); }
+
+    string magic() const { return string(map, 8); }
+
+    template <typename T> T field(size_t offset) const
+    {
+        T value;
+        memcpy(&value, map + offset, sizeof(value));
+        return value;
+    }
+
+    string read()
+    {
+        const uint64_t write_seq = field<uint64_t>(24);
+        string data;
+        for (; seq < write_seq; ++seq)
+            data += map[64 + seq % CAPACITY];
+        return data;
+    }
+
+    static const size_t CAPACITY = 64;
+
+private:
+    size_t size;
+    const char *map;
+    uint64_t seq;
+};
+
+TEST_CASE( "The message ring's header is as documented", "[single-file]" ) {
+    WebMessageRing ring;
+    REQUIRE(ring.open(ring_reader::CAPACITY));
+    ring_reader reader(ring);
+
+    REQUIRE(reader.magic() == "crawlrng");
+    REQUIRE(reader.field<uint32_t>(8) == 3);
+    REQUIRE(reader.field<uint32_t>(12) == 64);
+    REQUIRE(reader.field<uint64_t>(16) == ring_reader::CAPACITY);
+    REQUIRE(reader.field<uint64_t>(24) == 0);
+    REQUIRE(reader.field<uint64_t>(32) == 0);
+}
+
+TEST_CASE( "Messages are read back in order across the ring's end",
+           "[single-file]" ) {
+    WebMessageRing ring;
+    REQUIRE(ring.open(ring_reader::CAPACITY));
+    ring_reader reader(ring);
+
+    for (int i = 0; i < 20; ++i)
+    {
+        const string msg = make_stringf("{\"msg\":\"m%d\"}\n", i);
+        REQUIRE(ring.write(msg.data(), msg.size()));
+        REQUIRE(reader.read() == msg);
+        REQUIRE(reader.field<uint64_t>(32) == reader.field<uint64_t>(24));
+    }
+    REQUIRE(ring.seq() > ring_reader::CAPACITY);
+}
+
+TEST_CASE( "Messages too large for the ring leave a marker",
+           "[single-file]" ) {
+    WebMessageRing ring;
+    REQUIRE(ring.open(ring_reader::CAPACITY));
+    ring_reader reader(ring);
+
+    const string big(ring_reader::CAPACITY + 1, 'x');
+    REQUIRE_FALSE(ring.write(big.data(), big.size()));
+    REQUIRE(reader.read() == RING_SOCKET_MARKER);
+
+    const string msg = "{\"msg\":\"after\"}\n";
+    REQUIRE(ring.write(msg.data(), msg.size()));
+    REQUIRE(reader.read() == msg);
+}
+
+#endif
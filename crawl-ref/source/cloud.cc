@@ -46,9 +46,77 @@
 #include "unwind.h"
 #include "xom.h"
 
+cloud_store::cloud_store()
+{
+    index.init(-1);
+}
+
+cloud_struct *cloud_store::find(const coord_def &pos)
+{
+    if (!map_bounds(pos) || index(pos) < 0)
+        return nullptr;
+    return &slots[index(pos)];
+}
+
+const cloud_struct *cloud_store::find(const coord_def &pos) const
+{
+    if (!map_bounds(pos) || index(pos) < 0)
+        return nullptr;
+    return &slots[index(pos)];
+}
+
+cloud_struct &cloud_store::operator[](const coord_def &pos)
+{
+    ASSERT_IN_BOUNDS(pos);
+    if (index(pos) >= 0)
+        return slots[index(pos)];
+
+    // A deque never moves what it already holds when it grows, so this
+    // doesn't disturb any other cloud.
+    if (free_slots.empty())
+    {
+        index(pos) = slots.size();
+        slots.emplace_back();
+    }
+    else
+    {
+        index(pos) = free_slots.back();
+        free_slots.pop_back();
+        slots[index(pos)] = cloud_struct();
+    }
+    slots[index(pos)].pos = pos;
+    return slots[index(pos)];
+}
+
+void cloud_store::erase(const coord_def &pos)
+{
+    if (!map_bounds(pos) || index(pos) < 0)
+        return;
+    free_slots.push_back(index(pos));
+    index(pos) = -1;
+}
+
+void cloud_store::clear()
+{
+    slots.clear();
+    free_slots.clear();
+    index.init(-1);
+}
+
+vector<coord_def> cloud_store::positions() const
+{
+    vector<coord_def> result;
+    result.reserve(size());
+    for (unsigned int i = 0; i < slots.size(); ++i)
+        if (index(slots[i].pos) == (int) i)
+            result.push_back(slots[i].pos);
+    sort(result.begin(), result.end());
+    return result;
+}
+
 cloud_struct* cloud_at(coord_def pos)
 {
-    return map_find(env.cloud, pos);
+    return env.cloud.find(pos);
 }
 
 /// damage = base + random2avg(random, random/15 + 1)
@@ -623,14 +691,13 @@ static void _handle_spectral_cloud(const cloud_struct& cloud)
 
 void manage_clouds()
 {
-    // We can't iterate over env.cloud directly because _dissipate_cloud
-    // will remove this cloud and invalidate our iterator.
-    vector<cloud_struct *> cloud_ptrs;
-    for (auto& entry : env.cloud)
-        cloud_ptrs.push_back(&entry.second);
-
-    for (auto ptr : cloud_ptrs)
+    // Clouds made while this runs, by spreading or otherwise, get their
+    // first turn the next time around.
+    for (const coord_def &pos : env.cloud.positions())
     {
+        cloud_struct *ptr = cloud_at(pos);
+        if (!ptr)
+            continue;
         cloud_struct& cloud = *ptr;
 
 #ifdef ASSERTS
@@ -680,13 +747,7 @@ void delete_cloud(coord_def p)
 
 void delete_all_clouds()
 {
-    // We can't iterate over env.cloud directly because delete_cloud
-    // will remove this cloud and invalidate our iterator.
-    vector<coord_def> cloud_locs;
-    for (auto& entry : env.cloud)
-        cloud_locs.push_back(entry.first);
-
-    for (auto pos : cloud_locs)
+    for (auto pos : env.cloud.positions())
         delete_cloud(pos);
 }
 
@@ -1754,12 +1815,13 @@ void remove_vortex_clouds(mid_t whose)
     // spell (excluding immobile and mindless casters).
     // XXX: this comment seems impossibly out of date? ^
 
-    // We can't iterate over env.cloud directly because delete_cloud
-    // will remove this cloud and invalidate our iterator.
     vector<coord_def> vortices;
-    for (auto& entry : env.cloud)
-        if (entry.second.type == CLOUD_VORTEX && entry.second.source == whose)
-            vortices.push_back(entry.first);
+    for (auto pos : env.cloud.positions())
+    {
+        const cloud_struct &cloud = *cloud_at(pos);
+        if (cloud.type == CLOUD_VORTEX && cloud.source == whose)
+            vortices.push_back(pos);
+    }
 
     for (auto pos : vortices)
         delete_cloud(pos);
@@ -5,6 +5,12 @@
 
 #pragma once
 
+#include <deque>
+#include <vector>
+
+#include "defines.h"
+#include "fixedarray.h"
+
 struct cloud_struct
 {
     coord_def     pos;
@@ -39,6 +45,37 @@ struct cloud_struct
     static killer_type   whose_to_killer(kill_category whose);
 };
 
+/**
+ * The clouds of a level. Each cloud lives in a slot that doesn't move while
+ * it exists, so pointers and references to it stay good until it's erased,
+ * as they did with a map; a grid of slot indices makes finding the cloud at
+ * a square a single lookup. Freed slots are reused before new ones are added.
+ */
+class cloud_store
+{
+public:
+    cloud_store();
+
+    cloud_struct *find(const coord_def &pos);
+    const cloud_struct *find(const coord_def &pos) const;
+    // The cloud at pos, made empty at pos if there wasn't one.
+    cloud_struct &operator[](const coord_def &pos);
+    void erase(const coord_def &pos);
+    void clear();
+
+    size_t size() const { return slots.size() - free_slots.size(); }
+    bool empty() const { return !size(); }
+
+    // Where all the clouds are, in the order they have always been visited
+    // (and saved) in: by x, then by y.
+    vector<coord_def> positions() const;
+
+private:
+    deque<cloud_struct> slots;
+    vector<short> free_slots;
+    FixedArray<short, GXM, GYM> index;
+};
+
 enum cloud_tile_variation
 {
     CTVARY_NONE,     ///< fixed tile (or special case)
@@ -7,11 +7,17 @@
 
 #include "dbg-maps.h"
 
+#ifdef UNIX
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 #include "branch.h"
 #include "chardump.h"
 #include "crash.h"
 #include "dbg-objstat.h"
 #include "dungeon.h"
+#include "end.h"
 #include "env.h"
 #include "initfile.h"
 #include "libutil.h"
@@ -19,7 +25,9 @@
 #include "message.h"
 #include "ng-init.h"
 #include "ng-setup.h"
+#include "options.h"
 #include "player.h"
+#include "random.h"
 #include "shopping.h"
 #include "state.h"
 #include "stringutil.h"
@@ -49,6 +57,10 @@ static int build_attempts = 0, level_vetoes = 0;
 // Map from message to counts.
 static map<string, int> veto_messages;
 
+// Iteration i is built from seed iteration_seed_base + i, so that a run split
+// between worker processes builds the same levels as one that isn't.
+static uint64_t iteration_seed_base = 0;
+
 void mapstat_report_map_build_start()
 {
     build_attempts++;
@@ -220,26 +232,9 @@ static bool _build_dungeon()
     return true;
 }
 
-/**
- * Build dungeon levels for mapstat or objstat.
- *
- * The exact branches/levels built and number of build iterations is set by the
- * command-line options for mapstat/objstat.
-
- * @returns True if all iterations built successfully. For mapstat, this can
- * return false if an iteration produced a disconnected level, since for
- * diagnostic purposes we record the map in detail to a file and exit. For
- * objstat, this only returns false if the primary dungeon generation function
- * builder() fails, as the level may be in an invalid state and any object
- * statistics erroneous.
-*/
-bool mapstat_build_levels()
+static bool _build_iterations(int first, int last)
 {
-    if (!generated_levels.size())
-        _dungeon_places();
-    printf("Iteration: ");
-    fflush(stdout);
-    for (int i = 0; i < SysEnv.map_gen_iters; ++i)
+    for (int i = first; i < last; ++i)
     {
         clear_messages();
         mprf("On %d of %d; %d g, %d fail, %u err%s, %u uniq, "
@@ -252,6 +247,7 @@ bool mapstat_build_levels()
         printf("%d..", i + 1);
         fflush(stdout);
 
+        rng::seed(iteration_seed_base + i);
         dgn_reset_player_data();
         initial_dungeon_setup();
 
@@ -260,6 +256,265 @@ bool mapstat_build_levels()
         if (crawl_state.obj_stat_gen)
             objstat_iteration_stats();
     }
+    return true;
+}
+
+#ifdef UNIX
+// Worker processes hand their counts back to the parent as a file of lines
+// of tab-separated fields, the first naming what is counted; see
+// _write_partial_stats(). Objstat adds its own lines to the same file.
+
+static string _escape_field(const string &field)
+{
+    string escaped;
+    for (char c : field)
+    {
+        if (c == '\\')
+            escaped += "\\\\";
+        else if (c == '\t')
+            escaped += "\\t";
+        else if (c == '\n')
+            escaped += "\\n";
+        else
+            escaped += c;
+    }
+    return escaped;
+}
+
+static string _unescape_field(const string &field)
+{
+    string unescaped;
+    for (size_t i = 0; i < field.size(); ++i)
+    {
+        if (field[i] != '\\' || i + 1 == field.size())
+        {
+            unescaped += field[i];
+            continue;
+        }
+        const char c = field[++i];
+        unescaped += c == 't' ? '\t' : c == 'n' ? '\n' : c;
+    }
+    return unescaped;
+}
+
+static void _write_partial_counts(FILE *outf, const char *kind,
+                                  const map<string, int> &counts)
+{
+    for (const auto &entry : counts)
+    {
+        fprintf(outf, "%s\t%s\t%d\n", kind,
+                _escape_field(entry.first).c_str(), entry.second);
+    }
+}
+
+static void _write_partial_stats(FILE *outf)
+{
+    fprintf(outf, "levels\t%d\t%d\t%d\t%d\n", levels_tried, levels_failed,
+            build_attempts, level_vetoes);
+    _write_partial_counts(outf, "try", try_count);
+    _write_partial_counts(outf, "use", use_count);
+    _write_partial_counts(outf, "success", success_count);
+    _write_partial_counts(outf, "veto", veto_messages);
+
+    for (const auto &entry : level_mapcounts)
+    {
+        fprintf(outf, "mapcount\t%d\t%d\t%d\n", entry.first.branch,
+                entry.first.depth, entry.second);
+    }
+    for (const auto &entry : map_builds)
+    {
+        fprintf(outf, "builds\t%d\t%d\t%d\t%d\n", entry.first.branch,
+                entry.first.depth, entry.second.first, entry.second.second);
+    }
+    // map_levelsused holds the same pairs the other way around.
+    for (const auto &entry : level_mapsused)
+        for (const string &name : entry.second)
+        {
+            fprintf(outf, "used\t%d\t%d\t%s\n", entry.first.branch,
+                    entry.first.depth, _escape_field(name).c_str());
+        }
+    for (const auto &entry : errors)
+    {
+        fprintf(outf, "error\t%s\t%s\n", _escape_field(entry.first).c_str(),
+                _escape_field(entry.second).c_str());
+    }
+
+    if (crawl_state.obj_stat_gen)
+        objstat_write_partial(outf);
+}
+
+static level_id _partial_level(const vector<string> &fields, int i)
+{
+    return level_id(static_cast<branch_type>(atoi(fields[i].c_str())),
+                    atoi(fields[i + 1].c_str()));
+}
+
+static bool _merge_partial_line(const vector<string> &fields)
+{
+    const string &kind = fields[0];
+    const size_t size = fields.size();
+    auto num = [&fields](int i) { return atoi(fields[i].c_str()); };
+
+    if (kind == "levels" && size == 5)
+    {
+        levels_tried += num(1);
+        levels_failed += num(2);
+        build_attempts += num(3);
+        level_vetoes += num(4);
+    }
+    else if (kind == "try" && size == 3)
+        try_count[_unescape_field(fields[1])] += num(2);
+    else if (kind == "use" && size == 3)
+        use_count[_unescape_field(fields[1])] += num(2);
+    else if (kind == "success" && size == 3)
+        success_count[_unescape_field(fields[1])] += num(2);
+    else if (kind == "veto" && size == 3)
+        veto_messages[_unescape_field(fields[1])] += num(2);
+    else if (kind == "mapcount" && size == 4)
+        level_mapcounts[_partial_level(fields, 1)] += num(3);
+    else if (kind == "builds" && size == 5)
+    {
+        pair<int, int> &builds = map_builds[_partial_level(fields, 1)];
+        builds.first += num(3);
+        builds.second += num(4);
+    }
+    else if (kind == "used" && size == 4)
+    {
+        const level_id lid = _partial_level(fields, 1);
+        const string name = _unescape_field(fields[3]);
+        level_mapsused[lid].insert(name);
+        map_levelsused[name].insert(lid);
+    }
+    else if (kind == "error" && size == 3)
+        errors[_unescape_field(fields[1])] = _unescape_field(fields[2]);
+    else if (crawl_state.obj_stat_gen)
+        return objstat_merge_partial(fields);
+    else
+        return false;
+    return true;
+}
+
+static bool _merge_partial_stats(const string &filename)
+{
+    FILE *inf = fopen_u(filename.c_str(), "r");
+    if (!inf)
+        return false;
+
+    string contents;
+    char buf[4096];
+    size_t got;
+    while ((got = fread(buf, 1, sizeof(buf), inf)) > 0)
+        contents.append(buf, got);
+    fclose(inf);
+
+    bool ok = true;
+    for (const string &line : split_string("\n", contents, false, false))
+    {
+        if (!_merge_partial_line(split_string("\t", line, false, true)))
+        {
+            fprintf(stderr, "Bad line in %s: %s\n", filename.c_str(),
+                    line.c_str());
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+static string _partial_stats_file(int worker)
+{
+    return make_stringf("%s.part%d",
+                        crawl_state.obj_stat_gen ? "objstat" : "mapstat",
+                        worker);
+}
+
+// Split the iterations between SysEnv.map_gen_jobs forked workers, then
+// merge their counts as if this process had built every level itself.
+static bool _build_iterations_in_workers()
+{
+    const int jobs = min(SysEnv.map_gen_jobs, SysEnv.map_gen_iters);
+    vector<pid_t> workers;
+
+    fflush(stdout);
+    fflush(stderr);
+    for (int w = 0; w < jobs; ++w)
+    {
+        const int first = SysEnv.map_gen_iters * w / jobs;
+        const int last = SysEnv.map_gen_iters * (w + 1) / jobs;
+        const pid_t pid = fork();
+        if (pid < 0)
+            end(1, true, "Unable to start a level building worker");
+        if (!pid)
+        {
+            bool ok = _build_iterations(first, last);
+            FILE *outf = fopen_u(_partial_stats_file(w).c_str(), "w");
+            if (outf)
+            {
+                _write_partial_stats(outf);
+                ok = !fclose(outf) && ok;
+            }
+            fflush(stdout);
+            _exit(ok && outf ? 0 : 1);
+        }
+        workers.push_back(pid);
+    }
+
+    bool ok = true;
+    for (int w = 0; w < jobs; ++w)
+    {
+        int status;
+        if (waitpid(workers[w], &status, 0) < 0
+            || !WIFEXITED(status) || WEXITSTATUS(status))
+        {
+            ok = false;
+        }
+        const string part = _partial_stats_file(w);
+        if (!_merge_partial_stats(part))
+            ok = false;
+        unlink_u(part.c_str());
+    }
+    return ok;
+}
+#endif
+
+/**
+ * Build dungeon levels for mapstat or objstat.
+ *
+ * The exact branches/levels built and number of build iterations is set by the
+ * command-line options for mapstat/objstat. With -jobs, the iterations are
+ * split between forked worker processes whose counts are merged back here.
+
+ * @returns True if all iterations built successfully. For mapstat, this can
+ * return false if an iteration produced a disconnected level, since for
+ * diagnostic purposes we record the map in detail to a file and exit. For
+ * objstat, this only returns false if the primary dungeon generation function
+ * builder() fails, as the level may be in an invalid state and any object
+ * statistics erroneous.
+*/
+bool mapstat_build_levels()
+{
+    if (!generated_levels.size())
+        _dungeon_places();
+
+    iteration_seed_base = Options.seed;
+    if (!iteration_seed_base)
+    {
+        rng::seed();
+        iteration_seed_base = rng::get_uint64();
+    }
+    printf("Seed: %" PRIu64 "\n", iteration_seed_base);
+
+    printf("Iteration: ");
+    fflush(stdout);
+#ifdef UNIX
+    const bool ok = SysEnv.map_gen_jobs > 1
+                    ? _build_iterations_in_workers()
+                    : _build_iterations(0, SysEnv.map_gen_iters);
+#else
+    const bool ok = _build_iterations(0, SysEnv.map_gen_iters);
+#endif
+    if (!ok)
+        return false;
+
     printf("Finished.\n");
     fflush(stdout);
     return true;
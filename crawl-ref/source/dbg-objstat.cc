@@ -1023,6 +1023,111 @@ void objstat_iteration_stats()
     }
 }
 
+// The lines objstat adds to a mapstat worker's partial counts: the table,
+// the level, the keys of the entry within the table, then the field and its
+// value. Brand counts have no field.
+
+template <typename K>
+static void _write_partial_table(FILE *outf, const char *table,
+        const map<level_id, map<K, map<string, int> > > &recs)
+{
+    for (const auto &lentry : recs)
+        for (const auto &entry : lentry.second)
+            for (const auto &stat : entry.second)
+            {
+                fprintf(outf, "%s\t%d\t%d\t%d\t%s\t%d\n", table,
+                        lentry.first.branch, lentry.first.depth,
+                        static_cast<int>(entry.first), stat.first.c_str(),
+                        stat.second);
+            }
+}
+
+void objstat_write_partial(FILE *outf)
+{
+    for (const auto &lentry : item_recs)
+        for (const auto &bentry : lentry.second)
+            for (const auto &sentry : bentry.second)
+                for (const auto &stat : sentry.second)
+                {
+                    fprintf(outf, "item\t%d\t%d\t%d\t%d\t%s\t%d\n",
+                            lentry.first.branch, lentry.first.depth,
+                            bentry.first, sentry.first, stat.first.c_str(),
+                            stat.second);
+                }
+
+    for (const auto &lentry : brand_recs)
+        for (const auto &bentry : lentry.second)
+            for (const auto &sentry : bentry.second)
+                for (const auto &centry : sentry.second)
+                    for (const auto &brand : centry.second)
+                    {
+                        fprintf(outf, "brand\t%d\t%d\t%d\t%d\t%d\t%d\t%d\n",
+                                lentry.first.branch, lentry.first.depth,
+                                bentry.first, sentry.first, centry.first,
+                                brand.first, brand.second);
+                    }
+
+    _write_partial_table(outf, "monster", monster_recs);
+    _write_partial_table(outf, "feature", feature_recs);
+    _write_partial_table(outf, "spell", spell_recs);
+}
+
+// Counts add up across workers, except the per-iteration extremes.
+static void _merge_stat(map<string, int> &stats, const string &field,
+                        int value)
+{
+    auto stat = stats.find(field);
+    if (stat == stats.end())
+        stats[field] = value;
+    else if (field == "NumMin")
+        stat->second = min(stat->second, value);
+    else if (field == "NumMax")
+        stat->second = max(stat->second, value);
+    else
+        stat->second += value;
+}
+
+bool objstat_merge_partial(const vector<string> &fields)
+{
+    const size_t size = fields.size();
+    if (size < 3)
+        return false;
+
+    auto num = [&fields](int i) { return atoi(fields[i].c_str()); };
+    const level_id lev(static_cast<branch_type>(num(1)), num(2));
+    const string &table = fields[0];
+
+    if (table == "item" && size == 7)
+    {
+        const auto base_type = static_cast<item_base_type>(num(3));
+        _merge_stat(item_recs[lev][base_type][num(4)], fields[5], num(6));
+    }
+    else if (table == "brand" && size == 8)
+    {
+        const auto base_type = static_cast<item_base_type>(num(3));
+        const auto cat = static_cast<stat_category_type>(num(5));
+        brand_recs[lev][base_type][num(4)][cat][num(6)] += num(7);
+    }
+    else if (table == "monster" && size == 6)
+    {
+        const auto mc = static_cast<monster_type>(num(3));
+        _merge_stat(monster_recs[lev][mc], fields[4], num(5));
+    }
+    else if (table == "feature" && size == 6)
+    {
+        const auto feat = static_cast<dungeon_feature_type>(num(3));
+        _merge_stat(feature_recs[lev][feat], fields[4], num(5));
+    }
+    else if (table == "spell" && size == 6)
+    {
+        const auto spell = static_cast<spell_type>(num(3));
+        _merge_stat(spell_recs[lev][spell], fields[4], num(5));
+    }
+    else
+        return false;
+    return true;
+}
+
 static FILE * _open_stat_file(string stat_file)
 {
     FILE *stat_fh = nullptr;
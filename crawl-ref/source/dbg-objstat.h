@@ -11,4 +11,6 @@ void objstat_generate_stats();
 void objstat_record_monster(const monster *mons);
 void objstat_record_feature(dungeon_feature_type feat_type, bool vault);
 void objstat_iteration_stats();
+void objstat_write_partial(FILE *outf);
+bool objstat_merge_partial(const vector<string> &fields);
 #endif
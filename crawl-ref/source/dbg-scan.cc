@@ -11,6 +11,7 @@
 #include <cmath>
 #include <sstream>
 
+#include "act-iter.h"
 #include "artefact.h"
 #include "branch.h"
 #include "chardump.h"
@@ -336,6 +337,15 @@ void debug_mons_scan()
                               m->type, pos.x, pos.y, i);
         }
 
+        if (!monster_index_current(*m))
+        {
+            _announce_level_prob(warned);
+            mprf(MSGCH_WARN, "Monster moved behind the index's back: %s at "
+                             "(%d,%d), midx = %d",
+                 m->full_name(DESC_PLAIN).c_str(), pos.x, pos.y, i);
+            warned = true;
+        }
+
         if (!in_bounds(pos))
         {
             mprf(MSGCH_ERROR, "Out of bounds monster: %s at (%d, %d), "
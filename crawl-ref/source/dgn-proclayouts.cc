@@ -126,13 +126,35 @@ WastesLayout::operator()(const coord_def &p, const uint32_t offset) const
     return ProceduralSample(p, feat, min(sample.changepoint(), changepoint));
 }
 
+void RiverLayout::_distort(const coord_def &p, double &x, double &y) const
+{
+    const int mask = (1 << DISTORT_CACHE_BITS) - 1;
+    if (distort_cache.empty())
+    {
+        // An impossible point, so that nothing is taken as already cached.
+        distort_cache.resize(1 << (2 * DISTORT_CACHE_BITS),
+                             { coord_def(INT_MIN, INT_MIN), 0, 0 });
+    }
+    distorted_point &cached = distort_cache[(p.x & mask)
+                                            | (p.y & mask) << DISTORT_CACHE_BITS];
+    if (cached.p != p)
+    {
+        const double scalar = 90.0;
+        cached.p = p;
+        cached.x = (p.x + perlin::fBM(p.x/4.0, p.y/4.0, seed, 5) * 3) / scalar;
+        cached.y = (p.y + perlin::fBM(p.x/4.0 + 3.7, p.y/4.0 + 1.9, seed + 4, 5) * 3) / scalar;
+    }
+    x = cached.x;
+    y = cached.y;
+}
+
 ProceduralSample
 RiverLayout::operator()(const coord_def &p, const uint32_t offset) const
 {
     const double scale = 10000;
     const double scalar = 90.0;
-    double x = (p.x + perlin::fBM(p.x/4.0, p.y/4.0, seed, 5) * 3) / scalar;
-    double y = (p.y + perlin::fBM(p.x/4.0 + 3.7, p.y/4.0 + 1.9, seed + 4, 5) * 3) / scalar;
+    double x, y;
+    _distort(p, x, y);
     worley::noise_datum n = worley::noise(x, y, offset / scale + seed);
     const uint32_t changepoint = offset + _get_changepoint(n, scale);
     if ((n.id[0] ^ n.id[1] ^ seed) % 4)
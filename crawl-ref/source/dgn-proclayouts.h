@@ -155,8 +155,20 @@ class RiverLayout : public ProceduralLayout
         ProceduralSample operator()(const coord_def &p,
             const uint32_t offset = 0) const override;
     private:
+        // Where p lands after the (depth invariant, and expensive) river
+        // distortion, for the last points sampled. Indexed by the low bits
+        // of p, so that a whole level's worth of points fits.
+        struct distorted_point
+        {
+            coord_def p;
+            double x, y;
+        };
+        static const int DISTORT_CACHE_BITS = 7;
+        void _distort(const coord_def &p, double &x, double &y) const;
+
         const uint32_t seed;
         const ProceduralLayout &layout;
+        mutable vector<distorted_point> distort_cache;
 };
 
 // A reimagining of the beloved newabyss layout.
@@ -19,6 +19,7 @@
 
 #include "abyss.h"
 #include "acquire.h"
+#include "act-iter.h"
 #include "artefact.h"
 #include "branch.h"
 #include "chardump.h"
@@ -775,6 +776,7 @@ void dgn_reset_player_data()
     you.octopus_king_rings = 0x00;
     you.item_description.init(255); // random names need reset after this, e.g.
                                     // via debug.dungeon_setup()
+    invalidate_item_names();
     you.attribute[ATTR_GOLD_GENERATED] = 0;
     // potentially relevant for item placement in e.g. troves:
     you.seen_weapon.init(0);
@@ -4695,6 +4697,7 @@ static int _dgn_item_corpse(const item_spec &ispec, const coord_def where)
         if (!mon)
             continue;
         mon->position = where;
+        monster_index_moved(*mon);
         corpse = place_monster_corpse(*mon, true);
         // Dismiss the monster we used to place the corpse.
         monster_die(*mon, KILL_RESET, NON_MONSTER, true);
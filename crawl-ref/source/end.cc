@@ -28,6 +28,7 @@
 #include "macro.h"
 #include "message.h"
 #include "misc.h"
+#include "pregen-worker.h"
 #include "prompt.h"
 #include "religion.h"
 #include "startup.h"
@@ -172,6 +173,7 @@ NORETURN void end(int exit_code, bool print_error, const char *format, ...)
         tiles.shutdown();
 #endif
 
+        stop_background_pregen();
         cio_cleanup();
         msg::deinitialise_mpr_streams();
         _clear_globals_on_exit();
@@ -210,6 +212,7 @@ NORETURN void end(int exit_code, bool print_error, const char *format, ...)
 void delete_files()
 {
     crawl_state.need_save = false;
+    stop_background_pregen();
     you.save->unlink();
     delete you.save;
     you.save = 0;
@@ -0,0 +1,65 @@
+/**
+ * @file
+ * @brief A queue of things waiting to act, by energy.
+**/
+
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "debug.h"
+
+using std::pair;
+using std::vector;
+
+// Items come out with the most energy first. Among items with the same
+// energy, the order is exactly that of a std::priority_queue comparing only
+// energy, since this runs the same heap operations on its storage: the
+// monster queue used to be such a priority_queue, and seeded games and
+// replays depend on its order. Unlike a priority_queue, the storage is kept
+// when the queue empties, so a queue that is reused (like the monster queue,
+// every turn) soon stops allocating.
+template <typename T>
+class energy_queue
+{
+public:
+    bool empty() const { return heap.empty(); }
+    size_t size() const { return heap.size(); }
+
+    void push(T item, int energy)
+    {
+        heap.emplace_back(item, energy);
+        std::push_heap(heap.begin(), heap.end(), less_energy());
+    }
+
+    void emplace(T item, int energy) { push(item, energy); }
+
+    // The next item and its energy.
+    const pair<T, int> &top() const
+    {
+        ASSERT(!heap.empty());
+        return heap.front();
+    }
+
+    void pop()
+    {
+        ASSERT(!heap.empty());
+        std::pop_heap(heap.begin(), heap.end(), less_energy());
+        heap.pop_back();
+    }
+
+    void clear() { heap.clear(); }
+
+private:
+    struct less_energy
+    {
+        bool operator()(const pair<T, int> &a, const pair<T, int> &b) const
+        {
+            return a.second < b.second;
+        }
+    };
+
+    vector<pair<T, int>> heap;
+};
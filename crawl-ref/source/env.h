@@ -70,7 +70,7 @@ struct crawl_environment
 
     vector<coord_def>                        travel_trail;
 
-    map<coord_def, cloud_struct> cloud;
+    cloud_store cloud;
 
     map<coord_def, shop_struct> shop; // shop list
     map<coord_def, trap_def> trap; // trap list
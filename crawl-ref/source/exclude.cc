@@ -195,6 +195,7 @@ void exclude_set::clear()
 {
     exclude_roots.clear();
     exclude_points.clear();
+    invalidate_travel_safety();
 }
 
 void exclude_set::erase(const coord_def &p)
@@ -226,6 +227,7 @@ void exclude_set::add_exclude(const coord_def &p, int radius,
 
 void exclude_set::add_exclude_points(travel_exclude& ex)
 {
+    invalidate_travel_safety();
     if (ex.radius == 0)
     {
         exclude_points.insert(ex.pos);
@@ -258,6 +260,7 @@ void exclude_set::update_excluded_points(bool recompute_los)
 void exclude_set::recompute_excluded_points(bool recompute_los)
 {
     exclude_points.clear();
+    invalidate_travel_safety();
     for (iterator it = exclude_roots.begin(); it != exclude_roots.end(); ++it)
     {
         travel_exclude &ex = it->second;
@@ -52,6 +52,7 @@
 #include "tile-env.h"
 #include "errors.h"
 #include "player-save-info.h"
+#include "pregen-worker.h"
 #include "fineff.h"
 #include "ghost.h"
 #include "god-abil.h"
@@ -1854,36 +1855,11 @@ static bool _branch_pregenerates(branch_type b)
 }
 
 /**
-* Generate dungeon branches in a stable order until the level `stopping_point`
-* is found; `stopping_point` will be generated if it doesn't already exist. If
-* it does exist, the function is a noop.
-*
-* If `stopping_point` is not in the generation order, it will be generated on
-* its own.
-*
-* To generate all generatable levels, pass a level_id with NUM_BRANCHES as the
-* branch.
-*
-* @return whether stopping_point generated; if stopping_point is NUM_BRANCHES,
-* whether the full pregen list completed. This will return false if all needed
-* levels are already generated, so the caller should check whether false is an
-* error case or trivial success (using the save chunk).
-*/
-bool pregen_dungeon(const level_id &stopping_point)
+ * The levels that pregen_dungeon(stopping_point) would build, in the order it
+ * would build them; see there.
+ */
+vector<level_id> pregen_levels(const level_id &stopping_point)
 {
-    // TODO: the is_valid() check here doesn't look quite right to me, but so
-    // far I can't get it to break anything...
-    if (stopping_point.is_valid()
-        || stopping_point.branch != NUM_BRANCHES &&
-           is_random_subbranch(stopping_point.branch) && you.wizard)
-    {
-        if (you.save->has_chunk(stopping_point.describe()))
-            return false;
-
-        if (!_branch_pregenerates(stopping_point.branch))
-            return generate_level(stopping_point);
-    }
-
     vector<level_id> to_generate;
     bool at_end = false;
     for (auto br : branch_generation_order)
@@ -1926,6 +1902,66 @@ bool pregen_dungeon(const level_id &stopping_point)
             break;
     }
 
+    return to_generate;
+}
+
+/**
+ * The levels that pregen_dungeon() would build if the player went down the
+ * stairs: the level below, along with any that have to be built before it.
+ * Empty if that level exists, or isn't pregenerated.
+ */
+vector<level_id> upcoming_pregen_levels()
+{
+    const level_id here = level_id::current();
+    if (here.branch == BRANCH_ZIGGURAT || here.branch == BRANCH_PANDEMONIUM
+        || !_branch_pregenerates(here.branch)
+        || here.depth >= brdepth[here.branch])
+    {
+        return {};
+    }
+
+    const level_id below(here.branch, here.depth + 1);
+    if (you.save->has_chunk(below.describe()))
+        return {};
+    return pregen_levels(below);
+}
+
+/**
+* Generate dungeon branches in a stable order until the level `stopping_point`
+* is found; `stopping_point` will be generated if it doesn't already exist. If
+* it does exist, the function is a noop.
+*
+* If `stopping_point` is not in the generation order, it will be generated on
+* its own.
+*
+* To generate all generatable levels, pass a level_id with NUM_BRANCHES as the
+* branch.
+*
+* @return whether stopping_point generated; if stopping_point is NUM_BRANCHES,
+* whether the full pregen list completed. This will return false if all needed
+* levels are already generated, so the caller should check whether false is an
+* error case or trivial success (using the save chunk).
+*/
+bool pregen_dungeon(const level_id &stopping_point)
+{
+    // TODO: the is_valid() check here doesn't look quite right to me, but so
+    // far I can't get it to break anything...
+    if (stopping_point.is_valid()
+        || stopping_point.branch != NUM_BRANCHES &&
+           is_random_subbranch(stopping_point.branch) && you.wizard)
+    {
+        if (you.save->has_chunk(stopping_point.describe()))
+            return false;
+
+        if (!_branch_pregenerates(stopping_point.branch))
+            return generate_level(stopping_point);
+    }
+
+    vector<level_id> to_generate = pregen_levels(stopping_point);
+    // A background worker may already have built some of them.
+    if (!to_generate.empty() && collect_background_pregen(to_generate))
+        to_generate = pregen_levels(stopping_point);
+
     if (to_generate.size() == 0)
     {
         dprf("levelgen: No valid levels to generate.");
@@ -2505,6 +2541,9 @@ bool load_level(dungeon_feature_type stair_taken, load_mode_type load_mode,
         _fixup_transmuters();
 #endif
 
+    if (load_mode != LOAD_VISITOR)
+        start_background_pregen();
+
     return just_created_level;
 }
 
@@ -2591,6 +2630,7 @@ static void _save_game_exit()
     tiles.send_exit_reason("saved");
 #endif
 
+    stop_background_pregen();
     delete you.save;
     you.save = 0;
 }
@@ -2635,7 +2675,8 @@ void save_game(bool leave_game, const char *farewellmsg)
 #endif
         if (!crawl_state.disables[DIS_SAVE_CHECKPOINTS])
         {
-            you.save->commit();
+            // Sync in the background, so slow disks don't stall the game.
+            you.save->commit(true);
             save_game_prefs();
         }
         return;
@@ -90,6 +90,8 @@ void trackers_init_new_level();
 void update_portal_entrances();
 void reset_portal_entrances();
 bool generate_level(const level_id &l);
+vector<level_id> pregen_levels(const level_id &stopping_point);
+vector<level_id> upcoming_pregen_levels();
 bool pregen_dungeon(const level_id &stopping_point);
 bool load_level(dungeon_feature_type stair_taken, load_mode_type load_mode,
                 const level_id& old_level);
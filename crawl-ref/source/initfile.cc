@@ -694,16 +694,20 @@ const vector<GameOption*> game_options::build_options_list()
              {"all", easy_confirm_type::all}}),
         new ListGameOption<text_pattern>(SIMPLE_NAME(drop_filter), {}, true),
         new ListGameOption<text_pattern>(SIMPLE_NAME(note_monsters), {}, true),
-        new ListGameOption<text_pattern>(SIMPLE_NAME(note_messages), {}, true),
+        new ListGameOption<text_pattern>(SIMPLE_NAME(note_messages), {}, true,
+            message_options_changed),
         new ListGameOption<text_pattern>(SIMPLE_NAME(note_items), {}, true),
         new ListGameOption<text_pattern>(SIMPLE_NAME(auto_exclude), {}, true),
         new ListGameOption<text_pattern>(SIMPLE_NAME(explore_stop_pickup_ignore), {}, true),
 
         // defaults handled in dat/defaults/messages.txt:
-        new ListGameOption<message_filter>(SIMPLE_NAME(force_more_message), {}, true),
-        new ListGameOption<message_filter>(SIMPLE_NAME(flash_screen_message), {}, true),
+        new ListGameOption<message_filter>(SIMPLE_NAME(force_more_message), {}, true,
+            message_options_changed),
+        new ListGameOption<message_filter>(SIMPLE_NAME(flash_screen_message), {}, true,
+            message_options_changed),
         new ListGameOption<message_colour_mapping>(message_colour_mappings,
-            {"message_colour", "message_color"}, {}, true),
+            {"message_colour", "message_color"}, {}, true,
+            message_options_changed),
         new ListGameOption<colour_mapping>(menu_colour_mappings,
             {"menu_colour", "menu_color"}, {}, true),
         new ListGameOption<pair<text_pattern,string>, OPTFUN(_slot_mapping)>(auto_item_letters,
@@ -769,6 +773,11 @@ const vector<GameOption*> game_options::build_options_list()
              {"classic", level_gen_type::classic},
              {"false", level_gen_type::classic}
             }, true),
+#ifdef DGAMELAUNCH
+        new BoolGameOption(SIMPLE_NAME(pregen_in_background), false),
+#else
+        new BoolGameOption(SIMPLE_NAME(pregen_in_background), true),
+#endif
         new BoolGameOption(SIMPLE_NAME(single_column_item_menus), true),
 
 #ifdef DGL_SIMPLE_MESSAGING
@@ -3083,6 +3092,7 @@ static int _get_feature_type(const string &feature)
 
 void game_options::update_travel_terrain()
 {
+    invalidate_travel_safety();
     travel_avoid_terrain.init(0);
     for (const string &t : travel_avoid_terrain_option)
     {
@@ -3633,7 +3643,10 @@ void base_game_options::set_from_defaults(const string &opt)
     if (constants.count(opt))
         constants.erase(opt);
 
-    (*this)[opt].set_from(defaults[opt]);
+    GameOption &option = (*this)[opt];
+    option.set_from(defaults[opt]);
+    if (option.on_set)
+        option.on_set();
 }
 
 /// Parse an option line. Meta-fields are handled directly in this function,
@@ -4585,6 +4598,7 @@ enum commandline_option_type
     CLO_OBJSTAT,
     CLO_ITERATIONS,
     CLO_FORCE_MAP,
+    CLO_MAP_GEN_JOBS,
     CLO_ARENA,
     CLO_DUMP_MAPS,
     CLO_TEST,
@@ -4664,7 +4678,7 @@ static const char *cmd_ops[] =
 {
     "scores", "name", "species", "background", "dir", "rc", "rcdir", "tscores",
     "vscores", "scorefile", "morgue", "macro", "mapstat", "dump-disconnect",
-    "objstat", "iters", "force-map", "arena", "dump-maps", "test", "script",
+    "objstat", "iters", "force-map", "jobs", "arena", "dump-maps", "test", "script",
     "builddb", "help", "version", "seed", "pregen", "save-version", "sprint",
     "extra-opt-first", "extra-opt-last", "sprint-map", "edit-save",
     "print-charset", "tutorial", "wizard", "explore", "no-save",
@@ -5496,6 +5510,7 @@ bool parse_args(int argc, char **argv, bool rc_only)
 
     SysEnv.rcdirs.clear();
     SysEnv.map_gen_iters = 0;
+    SysEnv.map_gen_jobs = 1;
 
     if (argc < 2)           // no args!
         return true;
@@ -5690,6 +5705,20 @@ bool parse_args(int argc, char **argv, bool rc_only)
 #endif
             break;
 
+        case CLO_MAP_GEN_JOBS:
+#ifdef DEBUG_STATISTICS
+            if (!next_is_param || !isadigit(*next_arg))
+                end(1, false, "Integer argument required for -%s\n", arg);
+            else
+            {
+                SysEnv.map_gen_jobs = max(1, min(atoi(next_arg), 256));
+                nextUsed = true;
+            }
+#else
+            end(1, false, "%s", dbg_stat_err);
+#endif
+            break;
+
         case CLO_ARENA:
             if (!rc_only)
             {
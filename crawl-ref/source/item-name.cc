@@ -11,6 +11,7 @@
 #include <cstring>
 #include <iomanip>
 #include <sstream>
+#include <unordered_map>
 
 #include "areas.h"
 #include "artefact.h"
@@ -132,12 +133,120 @@ static string _item_inscription(const item_def &item)
                                              ", ").c_str());
 }
 
+// Everything an item's name can depend on, for items whose names depend
+// only on the item itself and on which item types are known.
+struct item_name_key
+{
+    object_class_type base_type;
+    uint8_t sub_type;
+    short plus;
+    short plus2;
+    int special;
+    uint8_t rnd;
+    short quantity;
+    iflags_t flags;
+    short orig_monnum;
+    string inscription;
+
+    description_level_type descrip;
+    bool terse;
+    bool ident;
+    bool with_inscription;
+    bool quantity_in_words;
+
+    char_set_type char_set;
+    maybe_bool show_god_gift;
+
+    bool operator==(const item_name_key &o) const
+    {
+        return base_type == o.base_type && sub_type == o.sub_type
+               && plus == o.plus && plus2 == o.plus2
+               && special == o.special && rnd == o.rnd
+               && quantity == o.quantity && flags == o.flags
+               && orig_monnum == o.orig_monnum
+               && inscription == o.inscription
+               && descrip == o.descrip && terse == o.terse
+               && ident == o.ident && with_inscription == o.with_inscription
+               && quantity_in_words == o.quantity_in_words
+               && char_set == o.char_set
+               && show_god_gift == o.show_god_gift;
+    }
+};
+
+struct item_name_key_hash
+{
+    size_t operator()(const item_name_key &k) const
+    {
+        size_t h = hash<string>()(k.inscription);
+        for (const uint64_t x : { (uint64_t) k.base_type,
+                                  (uint64_t) k.sub_type,
+                                  (uint64_t) (uint16_t) k.plus,
+                                  (uint64_t) (uint16_t) k.plus2,
+                                  (uint64_t) (uint32_t) k.special,
+                                  (uint64_t) k.rnd,
+                                  (uint64_t) (uint16_t) k.quantity,
+                                  (uint64_t) k.flags,
+                                  (uint64_t) (uint16_t) k.orig_monnum,
+                                  (uint64_t) k.descrip })
+        {
+            h = h * 1000003 ^ hash<uint64_t>()(x);
+        }
+        return h;
+    }
+};
+
+typedef unordered_map<item_name_key, string, item_name_key_hash>
+    item_name_memo_map;
+
+#define MAX_MEMOIZED_ITEM_NAMES 4096
+
+// Function-local so that it is constructed before the player's constructor
+// can invalidate it.
+static item_name_memo_map &_item_name_memo()
+{
+    static item_name_memo_map memo;
+    return memo;
+}
+
+void invalidate_item_names()
+{
+    _item_name_memo().clear();
+}
+
+// Can the name of this item be remembered? Artefacts, items with props
+// (named corpses, titled books...) and miscellany (with their charges and
+// ziggurat counts) have names that depend on more than the item's basic
+// fields, and the inventory descriptions depend on where the item is and
+// how it's used.
+static bool _name_is_memoizable(const item_def &item,
+                                description_level_type descrip)
+{
+    return item.props.empty()
+           && !is_artefact(item)
+           && item.base_type != OBJ_MISCELLANY
+           && descrip != DESC_INVENTORY
+           && descrip != DESC_INVENTORY_EQUIP;
+}
+
 string item_def::name(description_level_type descrip, bool terse, bool ident,
                       bool with_inscription, bool quantity_in_words) const
 {
     if (descrip == DESC_NONE)
         return "";
 
+    const bool memoizable = _name_is_memoizable(*this, descrip);
+    item_name_key key;
+    if (memoizable)
+    {
+        key = { base_type, sub_type, plus, plus2, special, rnd, quantity,
+                flags, orig_monnum, inscription,
+                descrip, terse, ident, with_inscription, quantity_in_words,
+                Options.char_set, Options.show_god_gift };
+        const auto it = _item_name_memo().find(key);
+        if (it != _item_name_memo().end())
+            return it->second;
+    }
+
     ostringstream buff;
 
     const string auxname = name_aux(descrip, terse, ident, with_inscription);
@@ -303,6 +412,14 @@ string item_def::name(description_level_type descrip, bool terse, bool ident,
         buff << " (curse)";
     }
 
+    if (memoizable)
+    {
+        item_name_memo_map &memo = _item_name_memo();
+        if (memo.size() >= MAX_MEMOIZED_ITEM_NAMES)
+            memo.clear();
+        memo.emplace(move(key), buff.str());
+    }
+
     return buff.str();
 }
 
@@ -1998,6 +2115,7 @@ bool identify_item_type(object_class_type basetype, int subtype)
         return false;
 
     you.type_ids[basetype][subtype] = true;
+    invalidate_item_names();
     maybe_mark_set_known(basetype, subtype);
     request_autoinscribe();
 
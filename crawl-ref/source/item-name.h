@@ -144,6 +144,9 @@ void check_if_everything_is_identified();
 bool type_is_identified(const item_def &item);
 bool type_is_identified(object_class_type basetype, int subtype);
 bool identify_item_type(object_class_type basetype, int subtype);
+// Forget remembered item names; call whenever which item types are known
+// changes other than through identify_item_type().
+void invalidate_item_names();
 
 string item_prefix(const item_def &item, bool temp = true);
 string menu_colour_item_name(const item_def &item,
@@ -5,15 +5,21 @@
 
 #include "l-libs.h"
 
+#include "abyss.h"
 #include "act-iter.h"
+#include "beam.h"
 #include "branch.h"
 #include "chardump.h"
+#include "cloud.h"
 #include "cluautil.h"
 #include "coordit.h"
 #include "dbg-util.h"
 #include "dungeon.h"
 #include "files.h"
 #include "god-wrath.h"
+#include "initfile.h"
+#include "item-name.h"
+#include "item-status-flag-type.h"
 #include "los.h"
 #include "maps.h"
 #include "message.h"
@@ -21,11 +27,17 @@
 #include "mon-cast.h"
 #include "mon-death.h"
 #include "mon-poly.h"
+#include "newgame-def.h"
+#include "ng-init.h"
 #include "ng-setup.h"
+#include "options.h"
+#include "pregen-worker.h"
 #include "religion.h"
+#include "shout.h"
 #include "stairs.h"
 #include "state.h"
 #include "stringutil.h"
+#include "tags.h"
 #include "tileview.h"
 #include "unique-creature-list-type.h"
 #include "unwind.h"
@@ -467,6 +479,229 @@ LUAFN(debug_check_moncasts)
     return 1;
 }
 
+static vector<unsigned char> marshalled_level;
+
+// Usage: marshall_level(reps)
+// Marshalls the current level's terrain and map data reps times, for
+// benchmarks, and returns its size in bytes.
+LUAFN(debug_marshall_level)
+{
+    const int reps = luaL_safe_checkint(ls, 1);
+    for (int i = 0; i < reps; ++i)
+        tag_write_level_grids(marshalled_level);
+    PLUARET(number, marshalled_level.size());
+}
+
+// Usage: unmarshall_level(reps)
+// Reads the data from the last marshall_level() back reps times.
+LUAFN(debug_unmarshall_level)
+{
+    const int reps = luaL_safe_checkint(ls, 1);
+    if (marshalled_level.empty())
+        return luaL_error(ls, "No level has been marshalled");
+    for (int i = 0; i < reps; ++i)
+        tag_read_level_grids(marshalled_level);
+    return 0;
+}
+
+// Usage: apply_noises()
+// Propagates the noises made so far (e.g. by dgn.noisy()) now, rather than
+// at the end of the turn.
+LUAFN(debug_apply_noises)
+{
+    UNUSED(ls);
+    apply_noises();
+    return 0;
+}
+
+// Usage: manage_clouds(reps)
+// Runs reps turns' worth of cloud spreading and dissipation, as if each turn
+// took a normal move, and returns how many clouds are left.
+LUAFN(debug_manage_clouds)
+{
+    const int reps = luaL_safe_checkint(ls, 1);
+    unwind_var<int> time_taken(you.time_taken, BASELINE_DELAY);
+    for (int i = 0; i < reps; ++i)
+        manage_clouds();
+    PLUARET(number, env.cloud.size());
+}
+
+// Usage: abyss_morph(reps)
+// Lets the Abyss shift its terrain reps times, as if each turn took a normal
+// move.
+LUAFN(debug_abyss_morph)
+{
+    const int reps = luaL_safe_checkint(ls, 1);
+    if (!player_in_branch(BRANCH_ABYSS))
+        return luaL_error(ls, "Not in the Abyss");
+    unwind_var<int> time_taken(you.time_taken, BASELINE_DELAY);
+    for (int i = 0; i < reps; ++i)
+        abyss_morph();
+    return 0;
+}
+
+// Usage: filter_messages(log, reps)
+// Runs each line of log through the message options reps times, and returns
+// the total number of matches. A line may start with a channel name and a
+// colon, as in "warn:It looks very dangerous."; other lines are plain.
+LUAFN(debug_filter_messages)
+{
+    const string log = luaL_checkstring(ls, 1);
+    const int reps = luaL_safe_checkint(ls, 2);
+
+    vector<pair<string, msg_channel_type>> lines;
+    for (const string &line : split_string("\n", log))
+    {
+        const string::size_type pos = line.find(':');
+        const int ch = pos == string::npos ? -1
+                                           : str_to_channel(line.substr(0, pos));
+        if (ch == -1)
+            lines.emplace_back(line, MSGCH_PLAIN);
+        else
+        {
+            lines.emplace_back(trimmed_string(line.substr(pos + 1)),
+                               static_cast<msg_channel_type>(ch));
+        }
+    }
+
+    int matches = 0;
+    for (int i = 0; i < reps; ++i)
+        for (const auto &line : lines)
+            matches += message_filter_matches(line.first, line.second);
+    PLUARET(number, matches);
+}
+
+static bool _same_tracer_info(const tracer_info &a, const tracer_info &b)
+{
+    return a.count == b.count && a.power == b.power && a.hurt == b.hurt
+           && a.helped == b.helped;
+}
+
+static bool _same_tracer(const bolt &a, const bolt &b)
+{
+    return _same_tracer_info(a.foe_info, b.foe_info)
+           && _same_tracer_info(a.friend_info, b.friend_info)
+           && a.path_taken == b.path_taken;
+}
+
+// Usage: refire_tracer(x1, y1, x2, y2)
+// Has the monster at (x1, y1) fire a tracer at (x2, y2), then fire the same
+// beam twice more while caching tracers, as while choosing a spell. Returns
+// whether all three tracers agree, and how many came from the cache.
+LUAFN(debug_refire_tracer)
+{
+    COORDS(source, 1, 2);
+    COORDS(target, 3, 4);
+    const monster *mons = monster_at(source);
+    if (!mons)
+        return luaL_error(ls, "No monster at (%d, %d)", source.x, source.y);
+
+    bolt beam;
+    beam.name    = "debug tracer";
+    beam.flavour = BEAM_FIRE;
+    beam.range   = LOS_RADIUS;
+    beam.damage  = dice_def(3, 10);
+    beam.hit     = AUTOMATIC_HIT;
+    beam.target  = target;
+    beam.pierce  = true;
+
+    fire_tracer(mons, beam);
+    const bolt fresh = beam;
+
+    tracer_cache_scope cached_tracers;
+    fire_tracer(mons, beam);
+    bool agree = _same_tracer(beam, fresh);
+    fire_tracer(mons, beam);
+    agree = agree && _same_tracer(beam, fresh);
+
+    lua_pushboolean(ls, agree);
+    lua_pushnumber(ls, cached_tracers.hits());
+    return 2;
+}
+
+// Usage: start_seeded_game(seed)
+// Starts a custom seed game as a human fighter on D:1, building levels as
+// they are needed. Unlike you.init(), this keeps the game's save, so that
+// levels can be left and built; call end_seeded_game() to throw it away.
+LUAFN(debug_start_seeded_game)
+{
+    Options.seed = (uint64_t) luaL_safe_checkint(ls, 1);
+    Options.pregen_dungeon = level_gen_type::incremental;
+    newgame_def ng;
+    ng.type = GAME_TYPE_CUSTOM_SEED;
+    ng.species = SP_HUMAN;
+    ng.job = JOB_FIGHTER;
+    ng.weapon = WPN_MACE;
+    setup_game(ng);
+    return 0;
+}
+
+LUAFN(debug_end_seeded_game)
+{
+    UNUSED(ls);
+    stop_background_pregen();
+    if (you.save)
+    {
+        you.save->unlink();
+        you.save = nullptr;
+    }
+    return 0;
+}
+
+void world_reacts(); // in main.cc
+
+// Usage: pass_turns(n)
+// Lets n turns go by as if the player waited, with monsters acting and
+// everything else that happens at the end of a turn.
+LUAFN(debug_pass_turns)
+{
+    for (int i = luaL_safe_checkint(ls, 1); i > 0; --i)
+    {
+        you.time_taken = player_speed();
+        you.turn_is_over = true;
+        world_reacts();
+    }
+    return 0;
+}
+
+// Usage: start_background_pregen()
+// Starts building the levels below in the background, as a game does on
+// arriving at a level, although tests otherwise don't. Returns whether a
+// worker is building them: not in builds that can't.
+LUAFN(debug_start_background_pregen)
+{
+    {
+        unwind_bool not_test(crawl_state.test, false);
+        unwind_bool in_background(Options.pregen_in_background, true);
+        start_background_pregen();
+    }
+    PLUARET(boolean, background_pregen_running());
+}
+
+LUARET1(debug_background_pregen_taken, number, background_pregen_taken())
+
+// Usage: set_item_type_known(item, known)
+// Identifies the type of the item, as using one would, or forgets it and
+// that the item was identified, as the wizard command does.
+LUAFN(debug_set_item_type_known)
+{
+    item_def *item = clua_get_item(ls, 1);
+    if (!item)
+        return luaL_argerror(ls, 1, "expected an item");
+
+    if (lua_toboolean(ls, 2))
+        identify_item_type(item->base_type, item->sub_type);
+    else
+    {
+        item->flags &= ~ISFLAG_IDENTIFIED;
+        you.type_ids[item->base_type][item->sub_type] = false;
+        invalidate_item_names();
+    }
+    return 0;
+}
+
+LUAWRAP(debug_initialise_item_descriptions, initialise_item_descriptions())
+
 const struct luaL_reg debug_dlib[] =
 {
 { "goto_place", debug_goto_place },
@@ -499,5 +734,19 @@ const struct luaL_reg debug_dlib[] =
 { "reset_rng", debug_reset_rng },
 { "get_rng_state", debug_get_rng_state },
 { "check_moncasts", debug_check_moncasts },
+{ "marshall_level", debug_marshall_level },
+{ "unmarshall_level", debug_unmarshall_level },
+{ "apply_noises", debug_apply_noises },
+{ "manage_clouds", debug_manage_clouds },
+{ "abyss_morph", debug_abyss_morph },
+{ "filter_messages", debug_filter_messages },
+{ "refire_tracer", debug_refire_tracer },
+{ "start_seeded_game", debug_start_seeded_game },
+{ "end_seeded_game", debug_end_seeded_game },
+{ "pass_turns", debug_pass_turns },
+{ "start_background_pregen", debug_start_background_pregen },
+{ "background_pregen_taken", debug_background_pregen_taken },
+{ "set_item_type_known", debug_set_item_type_known },
+{ "initialise_item_descriptions", debug_initialise_item_descriptions },
 { nullptr, nullptr }
 };
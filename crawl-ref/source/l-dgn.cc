@@ -88,7 +88,11 @@ static int dgn_depth_proc(lua_State *ls, depth_ranges &dr, int s)
 static int dgn_depth(lua_State *ls)
 {
     MAP(ls, 1, map);
-    return dgn_depth_proc(ls, map->depths, 2);
+    const bool setting = lua_gettop(ls) >= 2;
+    const int ret = dgn_depth_proc(ls, map->depths, 2);
+    if (setting)
+        map_selectors_changed(*map);
+    return ret;
 }
 
 static int dgn_place(lua_State *ls)
@@ -109,6 +113,7 @@ static int dgn_place(lua_State *ls)
                 luaL_error(ls, err.what());
             }
         }
+        map_selectors_changed(*map);
     }
     PLUARET(string, map->place.describe().c_str());
 }
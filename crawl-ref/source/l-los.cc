@@ -57,11 +57,91 @@ LUAFN(los_cell_see_cell)
     PLUARET(number, cell_see_cell(p, q, LOS_DEFAULT));
 }
 
+static int _count_visible(const los_grid &sh)
+{
+    int count = 0;
+    for (int x = -LOS_MAX_RANGE; x <= LOS_MAX_RANGE; ++x)
+        for (int y = -LOS_MAX_RANGE; y <= LOS_MAX_RANGE; ++y)
+            if (sh(coord_def(x, y)))
+                ++count;
+    return count;
+}
+
+/*** Calculate LOS around a cell with default opacity.
+ * @tparam int x
+ * @tparam int y
+ * @tparam[opt] boolean reference use the original bit_vector kernel
+ * @treturn int the number of visible cells
+ * @function losight
+ */
+LUAFN(los_losight)
+{
+    GETCOORD(c, 1, 2, map_bounds);
+    los_grid sh;
+    if (lua_toboolean(ls, 3))
+        losight_reference(sh, c);
+    else
+        losight(sh, c);
+    PLUARET(number, _count_visible(sh));
+}
+
+/*** Check that both LOS kernels agree on every cell around a center.
+ * @tparam int x
+ * @tparam int y
+ * @treturn boolean
+ * @function kernels_agree
+ */
+LUAFN(los_kernels_agree)
+{
+    GETCOORD(c, 1, 2, map_bounds);
+    los_grid fast, reference;
+    losight(fast, c);
+    losight_reference(reference, c);
+    for (int x = -LOS_MAX_RANGE; x <= LOS_MAX_RANGE; ++x)
+        for (int y = -LOS_MAX_RANGE; y <= LOS_MAX_RANGE; ++y)
+            if (fast(coord_def(x, y)) != reference(coord_def(x, y)))
+                PLUARET(boolean, false);
+    PLUARET(boolean, true);
+}
+
+/*** Check the loaded LOS ray tables against freshly cast rays.
+ * @treturn boolean true if they match, or if no tables were compiled in
+ * @function verify_tables
+ */
+LUAFN(los_verify_tables)
+{
+    PLUARET(boolean, check_los_tables());
+}
+
+/*** Statistics of the global LOS cache.
+ * @tparam[opt] boolean reset if true, reset the counters afterwards
+ * @treturn table lookups, recomputes, invalidations, pairs_invalidated and
+ *                pairs_kept (the last is only counted in debug builds)
+ * @function cache_stats
+ */
+LUAFN(los_get_cache_stats)
+{
+    const los_cache_stats &stats = get_los_cache_stats();
+    lua_newtable(ls);
+    LUA_PUSHINT("lookups", stats.lookups);
+    LUA_PUSHINT("recomputes", stats.recomputes);
+    LUA_PUSHINT("invalidations", stats.invalidations);
+    LUA_PUSHINT("pairs_invalidated", stats.pairs_invalidated);
+    LUA_PUSHINT("pairs_kept", stats.pairs_kept);
+    if (lua_toboolean(ls, 1))
+        reset_los_cache_stats();
+    return 1;
+}
+
 const struct luaL_reg los_dlib[] =
 {
     { "findray", los_find_ray },
     { "make_ray", los_make_ray },
     { "cell_see_cell", los_cell_see_cell },
+    { "cache_stats", los_get_cache_stats },
+    { "losight", los_losight },
+    { "kernels_agree", los_kernels_agree },
+    { "verify_tables", los_verify_tables },
     { nullptr, nullptr }
 };
 
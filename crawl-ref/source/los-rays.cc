@@ -0,0 +1,461 @@
+/**
+ * @file
+ * @brief Precomputed rays for the line-of-sight algorithm.
+**/
+
+#include "AppHdr.h"
+
+#include "los-rays.h"
+
+#include <algorithm>
+#include <list>
+
+vector<los_ray> fullrays;
+vector<coord_def> ray_coords;
+FixedArray<vector<cellray>, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1> min_cellrays;
+
+// The layout of the tables written by write_los_tables.
+struct los_table_ray
+{
+    double start_x, start_y;
+    double dir_x, dir_y;
+    unsigned short start, length;
+};
+
+struct los_table_cellray
+{
+    unsigned short ray, end;
+    short imbalance;
+    bool first_diag;
+};
+
+#ifdef USE_LOS_TABLES
+#include "los-tables.h"
+#endif
+
+// Check if the passed rays have identical footprint.
+static bool _is_same_ray(los_ray ray, vector<coord_def> newray)
+{
+    if (ray.length != newray.size())
+        return false;
+    for (unsigned int i = 0; i < ray.length; i++)
+        if (ray[i] != newray[i])
+            return false;
+    return true;
+}
+
+// Check if the passed ray has already been created.
+static bool _is_duplicate_ray(vector<coord_def> newray)
+{
+    for (los_ray lray : fullrays)
+        if (_is_same_ray(lray, newray))
+            return true;
+    return false;
+}
+
+// Compare two cellrays to the same target.
+// This determines which ray is considered better by find_ray,
+// used with list::sort.
+// Returns true if a is strictly better than b, false else.
+static bool _is_better(const cellray& a, const cellray& b)
+{
+    // Only compare cellrays with equal target.
+    ASSERT(a.target() == b.target());
+    // calc_params() has been called.
+    ASSERT(a.imbalance >= 0);
+    ASSERT(b.imbalance >= 0);
+    if (a.imbalance < b.imbalance)
+        return true;
+    else if (a.imbalance > b.imbalance)
+        return false;
+    else
+        return a.first_diag && !b.first_diag;
+}
+
+enum class compare_type
+{
+    neither,
+    subray,
+    superray,
+};
+
+// Check whether one of the passed cellrays is a subray of the
+// other in terms of footprint.
+static compare_type _compare_cellrays(const cellray& a, const cellray& b)
+{
+    if (a.target() != b.target())
+        return compare_type::neither;
+
+    int cura = a.ray.start;
+    int curb = b.ray.start;
+    int enda = cura + a.end;
+    int endb = curb + b.end;
+    bool maybe_sub = true;
+    bool maybe_super = true;
+
+    while (cura < enda && curb < endb && (maybe_sub || maybe_super))
+    {
+        coord_def pa = ray_coords[cura];
+        coord_def pb = ray_coords[curb];
+        if (pa.x > pb.x || pa.y > pb.y)
+        {
+            maybe_super = false;
+            curb++;
+        }
+        if (pa.x < pb.x || pa.y < pb.y)
+        {
+            maybe_sub = false;
+            cura++;
+        }
+        if (pa == pb)
+        {
+            cura++;
+            curb++;
+        }
+    }
+    maybe_sub = maybe_sub && cura == enda;
+    maybe_super = maybe_super && curb == endb;
+
+    if (maybe_sub)
+        return compare_type::subray;    // includes equality
+    else if (maybe_super)
+        return compare_type::superray;
+    else
+        return compare_type::neither;
+}
+
+// Determine all minimal cellrays.
+// They're stored globally by target in min_cellrays,
+// and returned as a list of indices into ray_coords.
+static vector<int> _find_minimal_cellrays()
+{
+    FixedArray<list<cellray>, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1> minima;
+    list<cellray>::iterator min_it;
+
+    for (los_ray ray : fullrays)
+    {
+        for (unsigned int i = 0; i < ray.length; ++i)
+        {
+            // Is the cellray ray[0..i] duplicated so far?
+            bool dup = false;
+            cellray c(ray, i);
+            list<cellray>& min = minima(c.target());
+
+            bool erased = false;
+            for (min_it = min.begin();
+                 min_it != min.end() && !dup;)
+            {
+                switch (_compare_cellrays(*min_it, c))
+                {
+                case compare_type::subray:
+                    dup = true;
+                    break;
+                case compare_type::superray:
+                    min_it = min.erase(min_it);
+                    erased = true;
+                    // clear this should be added, but might have
+                    // to erase more
+                    break;
+                case compare_type::neither:
+                default:
+                    break;
+                }
+                if (!erased)
+                    ++min_it;
+                else
+                    erased = false;
+            }
+            if (!dup)
+                min.push_back(c);
+        }
+    }
+
+    vector<int> result;
+    for (int y = 0; y <= LOS_MAX_RANGE; ++y)
+        for (int x = 0; x <= LOS_MAX_RANGE; ++x)
+        {
+            list<cellray>& min = minima(coord_def(x, y));
+            for (min_it = min.begin(); min_it != min.end(); ++min_it)
+            {
+                // Calculate imbalance and slope difference for sorting.
+                min_it->calc_params();
+                result.push_back(min_it->index());
+            }
+            min.sort(_is_better);
+            min_cellrays(coord_def(x, y)) = vector<cellray>(min.begin(), min.end());
+        }
+    return result;
+}
+
+// Create and register the ray defined by the arguments.
+static void _register_ray(geom::ray r)
+{
+    los_ray ray = los_ray(r);
+    vector<coord_def> coords = ray.footprint();
+
+    if (coords.empty() || _is_duplicate_ray(coords))
+        return;
+
+    ray.start = ray_coords.size();
+    ray.length = coords.size();
+    for (coord_def c : coords)
+        ray_coords.push_back(c);
+    fullrays.push_back(ray);
+}
+
+static int _gcd(int x, int y)
+{
+    int tmp;
+    while (y != 0)
+    {
+        x %= y;
+        tmp = x;
+        x = y;
+        y = tmp;
+    }
+    return x;
+}
+
+static bool _complexity_lt(const pair<int,int>& lhs, const pair<int,int>& rhs)
+{
+    return lhs.first * lhs.second < rhs.first * rhs.second;
+}
+
+// Cast all rays, and find the minimal cellrays among them.
+vector<int> calculate_los_rays()
+{
+    fullrays.clear();
+    ray_coords.clear();
+
+    // Creating all rays for first quadrant
+    // We have a considerable amount of overkill.
+
+    // register perpendiculars FIRST, to make them top choice
+    // when selecting beams
+    _register_ray(geom::ray(0.5, 0.5, 0.0, 1.0));
+    _register_ray(geom::ray(0.5, 0.5, 1.0, 0.0));
+
+    // For a slope of M = y/x, every x we move on the X axis means
+    // that we move y on the y axis. We want to look at the resolution
+    // of x/y: in that case, every step on the X axis means an increase
+    // of 1 in the Y axis at the intercept point. We can assume gcd(x,y)=1,
+    // so we look at steps of 1/y.
+
+    // Changing the order a bit. We want to order by the complexity
+    // of the beam, which is log(x) + log(y) ~ xy.
+    vector<pair<int,int> > xyangles;
+    for (int xangle = 1; xangle <= LOS_MAX_ANGLE; ++xangle)
+        for (int yangle = 1; yangle <= LOS_MAX_ANGLE; ++yangle)
+        {
+            if (_gcd(xangle, yangle) == 1)
+                xyangles.emplace_back(xangle, yangle);
+        }
+
+    sort(xyangles.begin(), xyangles.end(), _complexity_lt);
+    for (auto xyangle : xyangles)
+    {
+        const int xangle = xyangle.first;
+        const int yangle = xyangle.second;
+
+        for (int intercept = 1; intercept < LOS_INTERCEPT_MULT*yangle; ++intercept)
+        {
+            double xstart = ((double)intercept) / (LOS_INTERCEPT_MULT*yangle);
+            double ystart = 0.5;
+
+            _register_ray(geom::ray(xstart, ystart, xangle, yangle));
+            // also draw the identical ray in octant 2
+            _register_ray(geom::ray(ystart, xstart, yangle, xangle));
+        }
+    }
+
+    return _find_minimal_cellrays();
+}
+
+static int _imbalance(ray_def ray, const coord_def& target)
+{
+    int imb = 0;
+    int diags = 0, straights = 0;
+    while (ray.pos() != target)
+    {
+        coord_def old = ray.pos();
+        if (!ray.advance())
+            die("can't advance ray");
+        switch ((ray.pos() - old).abs())
+        {
+        case 1:
+            diags = 0;
+            if (++straights > imb)
+                imb = straights;
+            break;
+        case 2:
+            straights = 0;
+            if (++diags > imb)
+                imb = diags;
+            break;
+        default:
+            die("ray imbalance out of range");
+        }
+    }
+    return imb;
+}
+
+void cellray::calc_params()
+{
+    coord_def trg = target();
+    imbalance = _imbalance(ray, trg);
+    first_diag = ((*this)[0].abs() == 2);
+}
+
+/**
+ * Fill the ray data from the tables generated at build time.
+ *
+ * @return  The indices of the ends of the minimal cellrays, or an empty
+ *          vector if this build has no tables.
+ */
+vector<int> load_los_rays()
+{
+#ifdef USE_LOS_TABLES
+    fullrays.clear();
+    ray_coords.clear();
+
+    for (const los_table_ray &t : los_table_fullrays)
+    {
+        los_ray ray(geom::ray(t.start_x, t.start_y, t.dir_x, t.dir_y));
+        ray.start = t.start;
+        ray.length = t.length;
+        fullrays.push_back(ray);
+    }
+
+    for (const auto &c : los_table_coords)
+        ray_coords.emplace_back(c[0], c[1]);
+
+    const los_table_cellray *t = los_table_cellrays;
+    for (int y = 0; y <= LOS_MAX_RANGE; ++y)
+        for (int x = 0; x <= LOS_MAX_RANGE; ++x)
+        {
+            vector<cellray> &min = min_cellrays(coord_def(x, y));
+            min.clear();
+            const int count = los_table_cellray_counts[y][x];
+            for (int i = 0; i < count; ++i, ++t)
+            {
+                min.emplace_back(fullrays[t->ray], t->end);
+                min.back().imbalance = t->imbalance;
+                min.back().first_diag = t->first_diag;
+            }
+        }
+
+    return vector<int>(begin(los_table_min_indices),
+                       end(los_table_min_indices));
+#else
+    return vector<int>();
+#endif
+}
+
+static bool _same_ray(const los_ray &a, const los_ray &b)
+{
+    return a.r.start.x == b.r.start.x && a.r.start.y == b.r.start.y
+           && a.r.dir.x == b.r.dir.x && a.r.dir.y == b.r.dir.y
+           && a.start == b.start && a.length == b.length;
+}
+
+static bool _same_cellray(const cellray &a, const cellray &b)
+{
+    return _same_ray(a.ray, b.ray) && a.end == b.end
+           && a.imbalance == b.imbalance && a.first_diag == b.first_diag;
+}
+
+/**
+ * Recalculate all rays and compare them to the ones in use, which are
+ * kept either way.
+ *
+ * @param min_indices  The minimal cellray ends that came with the rays
+ *                     in use.
+ * @return             Whether the recalculated rays are identical.
+ */
+bool verify_los_rays(const vector<int> &min_indices)
+{
+    const vector<los_ray> old_fullrays = fullrays;
+    const vector<coord_def> old_coords = ray_coords;
+    const FixedArray<vector<cellray>, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1>
+        old_min_cellrays = min_cellrays;
+
+    const vector<int> new_indices = calculate_los_rays();
+
+    bool same = new_indices == min_indices
+                && ray_coords == old_coords
+                && fullrays.size() == old_fullrays.size();
+    for (unsigned int i = 0; same && i < fullrays.size(); ++i)
+        same = _same_ray(fullrays[i], old_fullrays[i]);
+    for (int y = 0; same && y <= LOS_MAX_RANGE; ++y)
+        for (int x = 0; same && x <= LOS_MAX_RANGE; ++x)
+        {
+            const vector<cellray> &a = min_cellrays(coord_def(x, y));
+            const vector<cellray> &b = old_min_cellrays(coord_def(x, y));
+            same = a.size() == b.size();
+            for (unsigned int i = 0; same && i < a.size(); ++i)
+                same = _same_cellray(a[i], b[i]);
+        }
+
+    fullrays = old_fullrays;
+    ray_coords = old_coords;
+    min_cellrays = old_min_cellrays;
+    return same;
+}
+
+/**
+ * Write the ray data in use as C++ tables for load_los_rays.
+ * %.17g keeps every double exact.
+ *
+ * @param out          Where to write los-tables.h.
+ * @param min_indices  The minimal cellray ends that came with the rays.
+ */
+void write_los_tables(FILE *out, const vector<int> &min_indices)
+{
+    fprintf(out, "// Generated by util/gen-los-tables from los-rays.cc. "
+                 "Do not edit.\n\n");
+    fprintf(out, "COMPILE_CHECK(LOS_MAX_RANGE == %d);\n", LOS_MAX_RANGE);
+    fprintf(out, "COMPILE_CHECK(LOS_RADIUS == %d);\n\n", LOS_RADIUS);
+
+    fprintf(out, "static const los_table_ray los_table_fullrays[] =\n{\n");
+    for (const los_ray &ray : fullrays)
+    {
+        fprintf(out, "    { %.17g, %.17g, %.17g, %.17g, %u, %u },\n",
+                ray.r.start.x, ray.r.start.y, ray.r.dir.x, ray.r.dir.y,
+                ray.start, ray.length);
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static const signed char los_table_coords[][2] =\n{\n");
+    for (const coord_def &c : ray_coords)
+        fprintf(out, "    { %d, %d },\n", c.x, c.y);
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static const unsigned short los_table_min_indices[] =\n{\n");
+    for (int index : min_indices)
+        fprintf(out, "    %d,\n", index);
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static const unsigned short los_table_cellray_counts"
+                 "[LOS_MAX_RANGE+1][LOS_MAX_RANGE+1] =\n{\n");
+    for (int y = 0; y <= LOS_MAX_RANGE; ++y)
+    {
+        fprintf(out, "    {");
+        for (int x = 0; x <= LOS_MAX_RANGE; ++x)
+            fprintf(out, " %u,", (unsigned int)min_cellrays(coord_def(x, y)).size());
+        fprintf(out, " },\n");
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "static const los_table_cellray los_table_cellrays[] =\n{\n");
+    for (int y = 0; y <= LOS_MAX_RANGE; ++y)
+        for (int x = 0; x <= LOS_MAX_RANGE; ++x)
+            for (const cellray &c : min_cellrays(coord_def(x, y)))
+            {
+                unsigned int ray = 0;
+                while (fullrays[ray].start != c.ray.start)
+                    ++ray;
+                fprintf(out, "    { %u, %u, %d, %s },\n", ray, c.end,
+                        c.imbalance, c.first_diag ? "true" : "false");
+            }
+    fprintf(out, "};\n");
+}
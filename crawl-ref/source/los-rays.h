@@ -0,0 +1,129 @@
+/**
+ * @file
+ * @brief Precomputed rays for the line-of-sight algorithm.
+ *
+ * Computing the rays is deterministic but slow, so normal builds bake
+ * the results into los-tables.h with the build-time tool
+ * util/gen-los-tables. Calculating them at run time is still possible,
+ * for builds without the tables and to verify them.
+**/
+
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+#include "coord-def.h"
+#include "fixedarray.h"
+#include "ray.h"
+
+using std::vector;
+
+// These determine what rays are cast in the precomputation,
+// and affect start-up time significantly.
+// XXX: Argue that these values are sufficient.
+#define LOS_MAX_ANGLE (2*LOS_MAX_RANGE-2)
+#define LOS_INTERCEPT_MULT (2)
+
+// These store all unique (in terms of footprint) full rays.
+// The footprint of ray=fullray[i] consists of ray.length cells,
+// stored in ray_coords[ray.start..ray.length-1].
+// These are filled during precomputation (_register_ray).
+// XXX: fullrays is not needed anymore after precomputation.
+struct los_ray;
+extern vector<los_ray> fullrays;
+extern vector<coord_def> ray_coords;
+
+struct los_ray : public ray_def
+{
+    // The footprint of this ray is stored in
+    // ray_coords[start..start+length-1].
+    unsigned int start;
+    unsigned int length;
+
+    los_ray(geom::ray _r)
+        : ray_def(_r), start(0), length(0)
+    {
+    }
+
+    // Shoot a ray from the given start point (accx, accy) with the given
+    // slope, bounded by the pre-calc bounds shape.
+    // Returns the cells it travels through, excluding the origin.
+    // Returns an empty vector if this was a bad ray.
+    vector<coord_def> footprint()
+    {
+        vector<coord_def> cs;
+        los_ray copy = *this;
+        coord_def c;
+        coord_def old;
+        while (true)
+        {
+            old = c;
+            if (!copy.advance())
+            {
+//                dprf("discarding corner ray (%f,%f) + t*(%f,%f)",
+//                     r.start.x, r.start.y, r.dir.x, r.dir.y);
+                cs.clear();
+                break;
+            }
+            c = copy.pos();
+            if (c.rdist() > LOS_RADIUS)
+                break;
+            cs.push_back(c);
+            ASSERT((c - old).rdist() == 1);
+        }
+        return cs;
+    }
+
+    coord_def operator[](unsigned int i)
+    {
+        ASSERT(i < length);
+        return ray_coords[start+i];
+    }
+};
+
+// A cellray given by fullray and index of end-point.
+struct cellray
+{
+    // A cellray passes through cells ray_coords[ray.start..ray.start+end].
+    los_ray ray;
+    unsigned int end; // Relative index (inside ray) of end cell.
+
+    cellray(const los_ray& r, unsigned int e)
+        : ray(r), end(e), imbalance(-1), first_diag(false)
+    {
+    }
+
+    // The end-point's index inside ray_coord.
+    int index() const { return ray.start + end; }
+
+    // The end-point.
+    coord_def target() const { return ray_coords[index()]; }
+
+    // XXX: Currently ray/cellray[0] is the first point outside the origin.
+    coord_def operator[](unsigned int i)
+    {
+        ASSERT(i <= end);
+        return ray_coords[ray.start+i];
+    }
+
+    // Parameters used in find_ray. These need to be calculated
+    // only for the minimal cellrays.
+    int imbalance;
+    bool first_diag;
+
+    void calc_params();
+};
+
+// We also store the minimal cellrays by target position
+// for efficient retrieval by find_ray.
+// XXX: Consider condensing this representation.
+extern FixedArray<vector<cellray>, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1> min_cellrays;
+
+// Each of these fills fullrays, ray_coords and min_cellrays, and returns
+// the indices into ray_coords of the ends of all minimal cellrays.
+vector<int> calculate_los_rays();
+vector<int> load_los_rays();
+
+bool verify_los_rays(const vector<int> &min_indices);
+void write_los_tables(FILE *out, const vector<int> &min_indices);
@@ -46,30 +46,22 @@
 
 #include <algorithm>
 #include <cmath>
+#if defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || _M_IX86_FP >= 2
+# include <emmintrin.h>
+# define LOS_SSE2
+#endif
 
 #include "areas.h"
 #include "coord.h"
 #include "coordit.h"
 #include "env.h"
+#include "los-rays.h"
 #include "losglobal.h"
 #include "mon-act.h"
 #include "mpr.h"
 
-// These determine what rays are cast in the precomputation,
-// and affect start-up time significantly.
-// XXX: Argue that these values are sufficient.
-#define LOS_MAX_ANGLE (2*LOS_MAX_RANGE-2)
-#define LOS_INTERCEPT_MULT (2)
-
-// These store all unique (in terms of footprint) full rays.
-// The footprint of ray=fullray[i] consists of ray.length cells,
-// stored in ray_coords[ray.start..ray.length-1].
-// These are filled during precomputation (_register_ray).
-// XXX: fullrays is not needed anymore after precomputation.
-struct los_ray;
-static vector<los_ray> fullrays;
-static vector<coord_def> ray_coords;
-
 // These store all unique minimal cellrays. For each i,
 // cellray i ends in cellray_ends[i] and passes through
 // those cells p that have blockrays(p)[i] set. In other
@@ -79,13 +71,19 @@ static vector<coord_def> cellray_ends;
 typedef FixedArray<bit_vector*, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1> blockrays_t;
 static blockrays_t blockrays;
 
-// We also store the minimal cellrays by target position
-// for efficient retrieval by find_ray.
-// XXX: Consider condensing this representation.
-struct cellray;
-static FixedArray<vector<cellray>, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1> min_cellrays;
+// The same blocking information with a fixed layout, for the word-parallel
+// kernel in _losight_quadrant. Bits past the last minimal cellray are
+// always clear.
+#define LOS_MAX_CELLRAYS 512
+typedef FixedBitWords<LOS_MAX_CELLRAYS> cellray_set;
+static FixedArray<cellray_set, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1> blockray_sets;
+
+// For each cell p, the distinct end cells of the minimal cellrays
+// that p blocks. If the opacity of p changes, visibility can change
+// only between the origin and these cells.
+static FixedArray<vector<coord_def>, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1> blocked_ends;
 
-// Temporary arrays used in losight() to track which rays
+// Temporary arrays used in losight_reference() to track which rays
 // are blocked or have seen a smoke cloud.
 // Allocated when doing the precomputations.
 static bit_vector *dead_rays     = nullptr;
@@ -132,257 +130,7 @@ bool double_is_zero(const double x)
     return x > -EPSILON_VALUE && x < EPSILON_VALUE;
 }
 
-struct los_ray : public ray_def
-{
-    // The footprint of this ray is stored in
-    // ray_coords[start..start+length-1].
-    unsigned int start;
-    unsigned int length;
-
-    los_ray(geom::ray _r)
-        : ray_def(_r), start(0), length(0)
-    {
-    }
-
-    // Shoot a ray from the given start point (accx, accy) with the given
-    // slope, bounded by the pre-calc bounds shape.
-    // Returns the cells it travels through, excluding the origin.
-    // Returns an empty vector if this was a bad ray.
-    vector<coord_def> footprint()
-    {
-        vector<coord_def> cs;
-        los_ray copy = *this;
-        coord_def c;
-        coord_def old;
-        while (true)
-        {
-            old = c;
-            if (!copy.advance())
-            {
-//                dprf("discarding corner ray (%f,%f) + t*(%f,%f)",
-//                     r.start.x, r.start.y, r.dir.x, r.dir.y);
-                cs.clear();
-                break;
-            }
-            c = copy.pos();
-            if (c.rdist() > LOS_RADIUS)
-                break;
-            cs.push_back(c);
-            ASSERT((c - old).rdist() == 1);
-        }
-        return cs;
-    }
-
-    coord_def operator[](unsigned int i)
-    {
-        ASSERT(i < length);
-        return ray_coords[start+i];
-    }
-};
-
-// Check if the passed rays have identical footprint.
-static bool _is_same_ray(los_ray ray, vector<coord_def> newray)
-{
-    if (ray.length != newray.size())
-        return false;
-    for (unsigned int i = 0; i < ray.length; i++)
-        if (ray[i] != newray[i])
-            return false;
-    return true;
-}
-
-// Check if the passed ray has already been created.
-static bool _is_duplicate_ray(vector<coord_def> newray)
-{
-    for (los_ray lray : fullrays)
-        if (_is_same_ray(lray, newray))
-            return true;
-    return false;
-}
-
-// A cellray given by fullray and index of end-point.
-struct cellray
-{
-    // A cellray passes through cells ray_coords[ray.start..ray.start+end].
-    los_ray ray;
-    unsigned int end; // Relative index (inside ray) of end cell.
-
-    cellray(const los_ray& r, unsigned int e)
-        : ray(r), end(e), imbalance(-1), first_diag(false)
-    {
-    }
-
-    // The end-point's index inside ray_coord.
-    int index() const { return ray.start + end; }
-
-    // The end-point.
-    coord_def target() const { return ray_coords[index()]; }
-
-    // XXX: Currently ray/cellray[0] is the first point outside the origin.
-    coord_def operator[](unsigned int i)
-    {
-        ASSERT(i <= end);
-        return ray_coords[ray.start+i];
-    }
-
-    // Parameters used in find_ray. These need to be calculated
-    // only for the minimal cellrays.
-    int imbalance;
-    bool first_diag;
-
-    void calc_params();
-};
-
-// Compare two cellrays to the same target.
-// This determines which ray is considered better by find_ray,
-// used with list::sort.
-// Returns true if a is strictly better than b, false else.
-static bool _is_better(const cellray& a, const cellray& b)
-{
-    // Only compare cellrays with equal target.
-    ASSERT(a.target() == b.target());
-    // calc_params() has been called.
-    ASSERT(a.imbalance >= 0);
-    ASSERT(b.imbalance >= 0);
-    if (a.imbalance < b.imbalance)
-        return true;
-    else if (a.imbalance > b.imbalance)
-        return false;
-    else
-        return a.first_diag && !b.first_diag;
-}
-
-enum class compare_type
-{
-    neither,
-    subray,
-    superray,
-};
-
-// Check whether one of the passed cellrays is a subray of the
-// other in terms of footprint.
-static compare_type _compare_cellrays(const cellray& a, const cellray& b)
-{
-    if (a.target() != b.target())
-        return compare_type::neither;
-
-    int cura = a.ray.start;
-    int curb = b.ray.start;
-    int enda = cura + a.end;
-    int endb = curb + b.end;
-    bool maybe_sub = true;
-    bool maybe_super = true;
-
-    while (cura < enda && curb < endb && (maybe_sub || maybe_super))
-    {
-        coord_def pa = ray_coords[cura];
-        coord_def pb = ray_coords[curb];
-        if (pa.x > pb.x || pa.y > pb.y)
-        {
-            maybe_super = false;
-            curb++;
-        }
-        if (pa.x < pb.x || pa.y < pb.y)
-        {
-            maybe_sub = false;
-            cura++;
-        }
-        if (pa == pb)
-        {
-            cura++;
-            curb++;
-        }
-    }
-    maybe_sub = maybe_sub && cura == enda;
-    maybe_super = maybe_super && curb == endb;
-
-    if (maybe_sub)
-        return compare_type::subray;    // includes equality
-    else if (maybe_super)
-        return compare_type::superray;
-    else
-        return compare_type::neither;
-}
-
-// Determine all minimal cellrays.
-// They're stored globally by target in min_cellrays,
-// and returned as a list of indices into ray_coords.
-static vector<int> _find_minimal_cellrays()
-{
-    FixedArray<list<cellray>, LOS_MAX_RANGE+1, LOS_MAX_RANGE+1> minima;
-    list<cellray>::iterator min_it;
-
-    for (los_ray ray : fullrays)
-    {
-        for (unsigned int i = 0; i < ray.length; ++i)
-        {
-            // Is the cellray ray[0..i] duplicated so far?
-            bool dup = false;
-            cellray c(ray, i);
-            list<cellray>& min = minima(c.target());
-
-            bool erased = false;
-            for (min_it = min.begin();
-                 min_it != min.end() && !dup;)
-            {
-                switch (_compare_cellrays(*min_it, c))
-                {
-                case compare_type::subray:
-                    dup = true;
-                    break;
-                case compare_type::superray:
-                    min_it = min.erase(min_it);
-                    erased = true;
-                    // clear this should be added, but might have
-                    // to erase more
-                    break;
-                case compare_type::neither:
-                default:
-                    break;
-                }
-                if (!erased)
-                    ++min_it;
-                else
-                    erased = false;
-            }
-            if (!dup)
-                min.push_back(c);
-        }
-    }
-
-    vector<int> result;
-    for (quadrant_iterator qi; qi; ++qi)
-    {
-        list<cellray>& min = minima(*qi);
-        for (min_it = min.begin(); min_it != min.end(); ++min_it)
-        {
-            // Calculate imbalance and slope difference for sorting.
-            min_it->calc_params();
-            result.push_back(min_it->index());
-        }
-        min.sort(_is_better);
-        min_cellrays(*qi) = vector<cellray>(min.begin(), min.end());
-    }
-    return result;
-}
-
-// Create and register the ray defined by the arguments.
-static void _register_ray(geom::ray r)
-{
-    los_ray ray = los_ray(r);
-    vector<coord_def> coords = ray.footprint();
-
-    if (coords.empty() || _is_duplicate_ray(coords))
-        return;
-
-    ray.start = ray_coords.size();
-    ray.length = coords.size();
-    for (coord_def c : coords)
-        ray_coords.push_back(c);
-    fullrays.push_back(ray);
-}
-
-static void _create_blockrays()
+static void _create_blockrays(const vector<int> &min_indices)
 {
     // First, we calculate blocking information for all cell rays.
     // Cellrays are numbered according to the index of their end
@@ -406,8 +154,7 @@ static void _create_blockrays()
     // We've built the basic blockray array; now compress it, keeping
     // only the nonduplicated cellrays.
 
-    // Determine minimal cellrays and store their indices in ray_coords.
-    vector<int> min_indices = _find_minimal_cellrays();
+    // The minimal cellrays are given by their indices in ray_coords.
     const int n_min_rays    = min_indices.size();
     cellray_ends.resize(n_min_rays);
     for (int i = 0; i < n_min_rays; ++i)
@@ -428,6 +175,23 @@ static void _create_blockrays()
     for (quadrant_iterator qi; qi; ++qi)
         delete all_blockrays(*qi);
 
+    if (n_min_rays > LOS_MAX_CELLRAYS)
+        die("%d minimal cellrays exceed LOS_MAX_CELLRAYS", n_min_rays);
+    for (quadrant_iterator qi; qi; ++qi)
+        for (int i = 0; i < n_min_rays; ++i)
+            blockray_sets(*qi).set(i, blockrays(*qi)->get(i));
+
+    // Collect the targets each cell can hide, for invalidate_los_around.
+    for (quadrant_iterator qi; qi; ++qi)
+    {
+        vector<coord_def> &ends = blocked_ends(*qi);
+        for (int i = 0; i < n_min_rays; ++i)
+            if (blockrays(*qi)->get(i))
+                ends.push_back(cellray_ends[i]);
+        sort(ends.begin(), ends.end());
+        ends.erase(unique(ends.begin(), ends.end()), ends.end());
+    }
+
     dead_rays  = new bit_vector(n_min_rays);
     smoke_rays = new bit_vector(n_min_rays);
 
@@ -435,110 +199,50 @@ static void _create_blockrays()
           n_cellrays, (unsigned int)fullrays.size(), n_min_rays);
 }
 
-static int _gcd(int x, int y)
-{
-    int tmp;
-    while (y != 0)
-    {
-        x %= y;
-        tmp = x;
-        x = y;
-        y = tmp;
-    }
-    return x;
-}
-
-static bool _complexity_lt(const pair<int,int>& lhs, const pair<int,int>& rhs)
-{
-    return lhs.first * lhs.second < rhs.first * rhs.second;
-}
+static vector<int> los_min_indices;
 
-// Cast all rays
+// Set up all rays: from the tables generated at build time if we have
+// them, else by casting them now.
 static void raycast()
 {
     static bool done_raycast = false;
     if (done_raycast)
         return;
-
-    // Creating all rays for first quadrant
-    // We have a considerable amount of overkill.
     done_raycast = true;
 
-    // register perpendiculars FIRST, to make them top choice
-    // when selecting beams
-    _register_ray(geom::ray(0.5, 0.5, 0.0, 1.0));
-    _register_ray(geom::ray(0.5, 0.5, 1.0, 0.0));
-
-    // For a slope of M = y/x, every x we move on the X axis means
-    // that we move y on the y axis. We want to look at the resolution
-    // of x/y: in that case, every step on the X axis means an increase
-    // of 1 in the Y axis at the intercept point. We can assume gcd(x,y)=1,
-    // so we look at steps of 1/y.
-
-    // Changing the order a bit. We want to order by the complexity
-    // of the beam, which is log(x) + log(y) ~ xy.
-    vector<pair<int,int> > xyangles;
-    for (int xangle = 1; xangle <= LOS_MAX_ANGLE; ++xangle)
-        for (int yangle = 1; yangle <= LOS_MAX_ANGLE; ++yangle)
-        {
-            if (_gcd(xangle, yangle) == 1)
-                xyangles.emplace_back(xangle, yangle);
-        }
-
-    sort(xyangles.begin(), xyangles.end(), _complexity_lt);
-    for (auto xyangle : xyangles)
-    {
-        const int xangle = xyangle.first;
-        const int yangle = xyangle.second;
-
-        for (int intercept = 1; intercept < LOS_INTERCEPT_MULT*yangle; ++intercept)
-        {
-            double xstart = ((double)intercept) / (LOS_INTERCEPT_MULT*yangle);
-            double ystart = 0.5;
-
-            _register_ray(geom::ray(xstart, ystart, xangle, yangle));
-            // also draw the identical ray in octant 2
-            _register_ray(geom::ray(ystart, xstart, yangle, xangle));
-        }
-    }
+    los_min_indices = load_los_rays();
+    if (los_min_indices.empty())
+        los_min_indices = calculate_los_rays();
 
-    // Now create the appropriate blockrays array
-    _create_blockrays();
+    _create_blockrays(los_min_indices);
 }
 
-static int _imbalance(ray_def ray, const coord_def& target)
+/**
+ * Check the rays in use (normally baked in at build time) against a
+ * fresh calculation.
+ */
+bool check_los_tables()
 {
-    int imb = 0;
-    int diags = 0, straights = 0;
-    while (ray.pos() != target)
-    {
-        coord_def old = ray.pos();
-        if (!ray.advance())
-            die("can't advance ray");
-        switch ((ray.pos() - old).abs())
-        {
-        case 1:
-            diags = 0;
-            if (++straights > imb)
-                imb = straights;
-            break;
-        case 2:
-            straights = 0;
-            if (++diags > imb)
-                imb = diags;
-            break;
-        default:
-            die("ray imbalance out of range");
-        }
-    }
-    return imb;
+    raycast();
+    return verify_los_rays(los_min_indices);
 }
 
-void cellray::calc_params()
+/**
+ * The cells whose visibility from the origin can depend on the
+ * opacity of a given cell.
+ *
+ * @param p  A cell relative to the origin, in the positive quadrant.
+ * @return   The distinct end points (relative, positive quadrant) of
+ *           all minimal cellrays passing through p.
+ */
+const vector<coord_def>& los_cells_behind(const coord_def& p)
 {
-    coord_def trg = target();
-    imbalance = _imbalance(ray, trg);
-    first_diag = ((*this)[0].abs() == 2);
+    ASSERT(p.x >= 0);
+    ASSERT(p.y >= 0);
+    ASSERT(p.rdist() <= LOS_MAX_RANGE);
+
+    raycast();
+    return blocked_ends(p);
 }
 
 // Find ray in positive quadrant.
@@ -732,7 +436,8 @@ bool cell_see_cell_nocache(const coord_def& p1, const coord_def& p2)
 // Smoke will now only block LOS after two cells of smoke. This is
 // done by updating with a second array.
 
-static void _losight_quadrant(los_grid& sh, const los_param& dat, int sx, int sy)
+static void _losight_quadrant_reference(los_grid& sh, const los_param& dat,
+                                        int sx, int sy)
 {
     const unsigned int num_cellrays = cellray_ends.size();
 
@@ -777,6 +482,130 @@ static void _losight_quadrant(los_grid& sh, const los_param& dat, int sx, int sy
     }
 }
 
+// dst |= src
+static inline void _rays_or(cellray_set& dst, const cellray_set& src)
+{
+#if defined(__AVX2__)
+    COMPILE_CHECK(cellray_set::NWORDS % 4 == 0);
+    for (int w = 0; w < cellray_set::NWORDS; w += 4)
+    {
+        __m256i *d = reinterpret_cast<__m256i*>(&dst.words[w]);
+        const __m256i s = _mm256_load_si256(
+            reinterpret_cast<const __m256i*>(&src.words[w]));
+        _mm256_store_si256(d, _mm256_or_si256(_mm256_load_si256(d), s));
+    }
+#elif defined(LOS_SSE2)
+    COMPILE_CHECK(cellray_set::NWORDS % 2 == 0);
+    for (int w = 0; w < cellray_set::NWORDS; w += 2)
+    {
+        __m128i *d = reinterpret_cast<__m128i*>(&dst.words[w]);
+        const __m128i s = _mm_load_si128(
+            reinterpret_cast<const __m128i*>(&src.words[w]));
+        _mm_store_si128(d, _mm_or_si128(_mm_load_si128(d), s));
+    }
+#else
+    for (int w = 0; w < cellray_set::NWORDS; ++w)
+        dst.words[w] |= src.words[w];
+#endif
+}
+
+// dst |= a & b
+static inline void _rays_or_and(cellray_set& dst, const cellray_set& a,
+                                const cellray_set& b)
+{
+#if defined(__AVX2__)
+    for (int w = 0; w < cellray_set::NWORDS; w += 4)
+    {
+        __m256i *d = reinterpret_cast<__m256i*>(&dst.words[w]);
+        const __m256i x = _mm256_load_si256(
+            reinterpret_cast<const __m256i*>(&a.words[w]));
+        const __m256i y = _mm256_load_si256(
+            reinterpret_cast<const __m256i*>(&b.words[w]));
+        _mm256_store_si256(d, _mm256_or_si256(_mm256_load_si256(d),
+                                              _mm256_and_si256(x, y)));
+    }
+#elif defined(LOS_SSE2)
+    for (int w = 0; w < cellray_set::NWORDS; w += 2)
+    {
+        __m128i *d = reinterpret_cast<__m128i*>(&dst.words[w]);
+        const __m128i x = _mm_load_si128(
+            reinterpret_cast<const __m128i*>(&a.words[w]));
+        const __m128i y = _mm_load_si128(
+            reinterpret_cast<const __m128i*>(&b.words[w]));
+        _mm_store_si128(d, _mm_or_si128(_mm_load_si128(d),
+                                        _mm_and_si128(x, y)));
+    }
+#else
+    for (int w = 0; w < cellray_set::NWORDS; ++w)
+        dst.words[w] |= a.words[w] & b.words[w];
+#endif
+}
+
+// Index of the lowest set bit of a nonzero word.
+static inline int _lowest_bit(uint64_t word)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(word);
+#else
+    int i = 0;
+    while (!(word & 1))
+    {
+        word >>= 1;
+        ++i;
+    }
+    return i;
+#endif
+}
+
+// The same as _losight_quadrant_reference, but working on whole words
+// of the ray sets: each opaque or half-opaque cell costs a few wide ORs,
+// and the surviving rays are found with an and-not per word.
+static void _losight_quadrant(los_grid& sh, const los_param& dat, int sx, int sy)
+{
+    const unsigned int num_cellrays = cellray_ends.size();
+
+    cellray_set dead;
+    cellray_set smoke;
+
+    for (quadrant_iterator qi; qi; ++qi)
+    {
+        coord_def p = coord_def(sx*(qi->x), sy*(qi->y));
+        if (!dat.los_bounds(p))
+            continue;
+
+        switch (dat.opacity(p))
+        {
+        case OPC_OPAQUE:
+            _rays_or(dead, blockray_sets(*qi));
+            break;
+        case OPC_HALF:
+            _rays_or_and(dead, smoke, blockray_sets(*qi));
+            _rays_or(smoke, blockray_sets(*qi));
+            break;
+        default:
+            break;
+        }
+    }
+
+    for (unsigned int w = 0; w * 64 < num_cellrays; ++w)
+    {
+        uint64_t alive = ~dead.words[w];
+        if (num_cellrays - w * 64 < 64)
+            alive &= (uint64_t(1) << (num_cellrays - w * 64)) - 1;
+
+        while (alive)
+        {
+            const unsigned int rayidx = w * 64 + _lowest_bit(alive);
+            alive &= alive - 1;
+
+            const coord_def p = coord_def(sx * cellray_ends[rayidx].x,
+                                          sy * cellray_ends[rayidx].y);
+            if (dat.los_bounds(p))
+                sh(p) = true;
+        }
+    }
+}
+
 struct los_param_funcs : public los_param
 {
     coord_def center;
@@ -820,6 +649,24 @@ void losight(los_grid& sh, const coord_def& center,
     sh(o) = true;
 }
 
+// losight() using the original bit_vector kernel. Only used to check
+// and benchmark the word-parallel one.
+void losight_reference(los_grid& sh, const coord_def& center,
+                       const opacity_func& opc, const circle_def& bounds)
+{
+    const los_param& dat = los_param_funcs(center, opc, bounds);
+
+    sh.init(false);
+    raycast();
+
+    const int quadrant_x[4] = {  1, -1, -1,  1 };
+    const int quadrant_y[4] = {  1,  1, -1, -1 };
+    for (int q = 0; q < 4; ++q)
+        _losight_quadrant_reference(sh, dat, quadrant_x[q], quadrant_y[q]);
+
+    sh(coord_def(0, 0)) = true;
+}
+
 opacity_type mons_opacity(const monster* mon, los_type how)
 {
     // no regard for LOS_ARENA
@@ -34,12 +34,18 @@ void fallback_ray(const coord_def& source, const coord_def& target,
 
 bool cell_see_cell_nocache(const coord_def& p1, const coord_def& p2);
 
+const vector<coord_def>& los_cells_behind(const coord_def& p);
+bool check_los_tables();
+
 typedef SquareArray<bool, LOS_MAX_RANGE> los_grid;
 
 void clear_rays_on_exit();
 void losight(los_grid& sh, const coord_def& center,
              const opacity_func &opc = opc_default,
              const circle_def &bds = BDS_DEFAULT);
+void losight_reference(los_grid& sh, const coord_def& center,
+                       const opacity_func &opc = opc_default,
+                       const circle_def &bds = BDS_DEFAULT);
 
 void los_actor_moved(const actor* act, const coord_def& oldpos);
 void los_monster_died(const monster* mon);
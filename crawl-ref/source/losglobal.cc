@@ -6,6 +6,7 @@
 #include "coordit.h"
 #include "libutil.h"
 #include "los-def.h"
+#include "los.h"
 
 #define LOS_KNOWN 4
 
@@ -58,16 +59,89 @@ static void _save_los(los_def* los, los_type l)
         }
 }
 
-// Opacity at p has changed.
-void invalidate_los_around(const coord_def& p)
+static los_cache_stats los_stats;
+
+const los_cache_stats& get_los_cache_stats()
+{
+    return los_stats;
+}
+
+void reset_los_cache_stats()
 {
+    los_stats = los_cache_stats();
+}
+
+#ifdef DEBUG
+// How many known pairs a full invalidation of the window around p would
+// have thrown away. Only used for statistics.
+static unsigned int _count_known_around(const coord_def& p)
+{
+    unsigned int known = 0;
     int x1 = max(p.x - LOS_MAX_RANGE, 0);
     int y1 = max(p.y - LOS_MAX_RANGE, 0);
     int x2 = min(p.x, GXM - 1);
     int y2 = min(p.y + LOS_MAX_RANGE, GYM - 1);
     for (int y = y1; y <= y2; y++)
         for (int x = x1; x <= x2; x++)
-            memset(globallos[x][y], 0, sizeof(halflos_t));
+            for (const auto &row : globallos[x][y])
+                for (losfield_t flags : row)
+                    if (flags)
+                        known++;
+    return known;
+}
+#endif
+
+// Opacity at p has changed. Visibility between o and q can only change
+// if some minimal cellray from o to q passes through p, so we forget
+// just those pairs instead of everything around p.
+void invalidate_los_around(const coord_def& p)
+{
+    los_stats.invalidations++;
+#ifdef DEBUG
+    const unsigned int known_before = _count_known_around(p);
+    unsigned int cleared = 0;
+#endif
+
+    for (rectangle_iterator ri(p, LOS_MAX_RANGE); ri; ++ri)
+    {
+        const coord_def o = *ri;
+        if (o == p || !map_bounds(o))
+            continue;
+
+        const coord_def d = p - o;
+        const coord_def rel(abs(d.x), abs(d.y));
+        const vector<coord_def> &ends = los_cells_behind(rel);
+        if (ends.empty())
+            continue;
+
+        // Cells on an axis belong to both adjacent quadrants.
+        for (int sx = -1; sx <= 1; sx += 2)
+        {
+            if (d.x * sx < 0)
+                continue;
+            for (int sy = -1; sy <= 1; sy += 2)
+            {
+                if (d.y * sy < 0)
+                    continue;
+                for (const coord_def &e : ends)
+                {
+                    losfield_t* flags =
+                        _lookup_globallos(o, o + coord_def(sx * e.x, sy * e.y));
+                    if (!flags || !*flags)
+                        continue;
+                    *flags = 0;
+                    los_stats.pairs_invalidated++;
+#ifdef DEBUG
+                    cleared++;
+#endif
+                }
+            }
+        }
+    }
+
+#ifdef DEBUG
+    los_stats.pairs_kept += known_before - min(cleared, known_before);
+#endif
 }
 
 void invalidate_los()
@@ -78,6 +152,7 @@ void invalidate_los()
 
 static void _update_globallos_at(const coord_def& p, los_type l)
 {
+    los_stats.recomputes++;
     switch (l)
     {
     case LOS_DEFAULT:
@@ -123,6 +198,8 @@ bool cell_see_cell(const coord_def& p, const coord_def& q, los_type l)
     if (!flags)
         return false; // outside range
 
+    los_stats.lookups++;
+
     if (!(*flags & (l << LOS_KNOWN)))
         _update_globallos_at(p, l);
 
@@ -2,6 +2,24 @@
 
 #include "los-type.h"
 
+struct los_cache_stats
+{
+    // cell_see_cell queries answered from (or filled into) the cache.
+    unsigned int lookups = 0;
+    // Full LOS calculations done to fill the cache.
+    unsigned int recomputes = 0;
+    // Calls to invalidate_los_around.
+    unsigned int invalidations = 0;
+    // Known pairs forgotten by those calls.
+    unsigned int pairs_invalidated = 0;
+    // Known pairs that a whole-window invalidation would have forgotten,
+    // but that were kept. Only counted in debug builds.
+    unsigned int pairs_kept = 0;
+};
+
+const los_cache_stats& get_los_cache_stats();
+void reset_los_cache_stats();
+
 void invalidate_los_around(const coord_def& p);
 void invalidate_los();
 
@@ -0,0 +1,173 @@
+/**
+ * @file
+ * @brief A small, fast LZ77 codec for save file chunks.
+**/
+
+#include "AppHdr.h"
+
+#include "lzcodec.h"
+
+#include <cstdint>
+#include <cstring>
+
+#define LZ_MIN_MATCH    4
+#define LZ_MAX_OFFSET   65535
+// The format requires the last match to start at least this many bytes
+// before the end, and the last this many bytes to be literals.
+#define LZ_MFLIMIT      12
+#define LZ_LAST_LITERALS 5
+#define LZ_HASH_BITS    12
+// Skip ahead faster in data that doesn't compress.
+#define LZ_SKIP_SHIFT   6
+
+typedef unsigned char byte;
+
+static inline uint32_t _read32(const byte *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline unsigned int _hash(uint32_t v)
+{
+    return (v * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+static void _put_length(vector<char> &out, size_t len)
+{
+    for (; len >= 255; len -= 255)
+        out.push_back((char)255);
+    out.push_back((char)len);
+}
+
+static void _put_sequence(vector<char> &out, const byte *lit, size_t lit_len,
+                          size_t offset, size_t match_len)
+{
+    const size_t ml = match_len ? match_len - LZ_MIN_MATCH : 0;
+    out.push_back((char)(((lit_len < 15 ? lit_len : 15) << 4)
+                         | (ml < 15 ? ml : 15)));
+    if (lit_len >= 15)
+        _put_length(out, lit_len - 15);
+    out.insert(out.end(), lit, lit + lit_len);
+    if (!match_len)
+        return;
+    out.push_back((char)(offset & 0xff));
+    out.push_back((char)(offset >> 8));
+    if (ml >= 15)
+        _put_length(out, ml - 15);
+}
+
+size_t lz_compress_bound(size_t len)
+{
+    return len + len / 255 + 16;
+}
+
+void lz_compress(const void *src, size_t len, vector<char> &out)
+{
+    const byte *in = (const byte *)src;
+    const byte *end = in + len;
+    const byte *ip = in;
+    const byte *anchor = in;
+
+    out.reserve(out.size() + lz_compress_bound(len));
+
+    if (len > LZ_MFLIMIT)
+    {
+        const byte *mflimit = end - LZ_MFLIMIT;
+        const byte *mlimit = end - LZ_LAST_LITERALS;
+        uint32_t table[1 << LZ_HASH_BITS];
+        memset(table, 0, sizeof(table));
+
+        while (ip <= mflimit)
+        {
+            const uint32_t seq = _read32(ip);
+            const unsigned int h = _hash(seq);
+            const byte *ref = in + table[h];
+            table[h] = ip - in;
+
+            if (ref >= ip || ip - ref > LZ_MAX_OFFSET || _read32(ref) != seq)
+            {
+                ip += 1 + ((ip - anchor) >> LZ_SKIP_SHIFT);
+                continue;
+            }
+
+            const byte *m = ip + LZ_MIN_MATCH;
+            const byte *r = ref + LZ_MIN_MATCH;
+            while (m < mlimit && *m == *r)
+                ++m, ++r;
+
+            _put_sequence(out, anchor, ip - anchor, ip - ref, m - ip);
+            ip = anchor = m;
+        }
+    }
+
+    _put_sequence(out, anchor, end - anchor, 0, 0);
+}
+
+static bool _get_length(const byte *&ip, const byte *iend, size_t &len)
+{
+    byte b;
+    do
+    {
+        if (ip >= iend)
+            return false;
+        b = *ip++;
+        len += b;
+    }
+    while (b == 255);
+    return true;
+}
+
+bool lz_decompress(const void *src, size_t len, void *dst, size_t dst_len)
+{
+    const byte *ip = (const byte *)src;
+    const byte *iend = ip + len;
+    byte *out = (byte *)dst;
+    byte *op = out;
+    byte *oend = out + dst_len;
+
+    while (ip < iend)
+    {
+        const byte token = *ip++;
+
+        size_t lit_len = token >> 4;
+        if (lit_len == 15 && !_get_length(ip, iend, lit_len))
+            return false;
+        if (lit_len > (size_t)(iend - ip) || lit_len > (size_t)(oend - op))
+            return false;
+        memcpy(op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+
+        // The last sequence has no match.
+        if (ip == iend)
+            return op == oend;
+
+        if (iend - ip < 2)
+            return false;
+        const size_t offset = ip[0] | ip[1] << 8;
+        ip += 2;
+        if (!offset || offset > (size_t)(op - out))
+            return false;
+
+        size_t match_len = token & 15;
+        if (match_len == 15 && !_get_length(ip, iend, match_len))
+            return false;
+        match_len += LZ_MIN_MATCH;
+        if (match_len > (size_t)(oend - op))
+            return false;
+
+        const byte *m = op - offset;
+        if (offset >= match_len)
+        {
+            memcpy(op, m, match_len);
+            op += match_len;
+        }
+        else // overlapping, i.e. a repeated pattern
+            while (match_len--)
+                *op++ = *m++;
+    }
+
+    return false;
+}
@@ -0,0 +1,25 @@
+/**
+ * @file
+ * @brief A small, fast LZ77 codec for save file chunks.
+**/
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+using std::vector;
+
+// The output uses the LZ4 block format, so the data can also be inspected
+// with standard tools; the compressor is a simple greedy one that favours
+// speed over ratio.
+
+// An upper bound on the compressed size of len bytes.
+size_t lz_compress_bound(size_t len);
+
+// Appends the compressed form of src to out.
+void lz_compress(const void *src, size_t len, vector<char> &out);
+
+// Decompresses exactly dst_len bytes into dst. Returns false if src is not
+// a well-formed block of that size.
+bool lz_decompress(const void *src, size_t len, void *dst, size_t dst_len);
@@ -586,6 +586,9 @@ static void _show_commandline_options_help()
          "iterations");
     puts("  -force-map <map>    For -mapstat and -objstat, always choose the "
          "      given map on every level.");
+    puts("  -jobs <num>         For -mapstat and -objstat, split the "
+         "iterations between");
+    puts("      <num> worker processes");
 #endif
     puts("");
     puts("Miscellaneous options:");
@@ -786,6 +789,7 @@ static void _set_removed_types_as_identified()
     for (auto entry : removed_items)
         if (item_type_has_ids(entry.first))
             you.type_ids(entry) = true;
+    invalidate_item_names();
 }
 
 // Set up the running variables for the current run.
@@ -71,6 +71,7 @@ void clear_map(bool clear_items, bool clear_mons)
         tile_reset_fg(p);
 #endif
     }
+    invalidate_travel_safety();
 }
 
 void clear_map_or_travel_trail()
@@ -2183,6 +2183,14 @@ bool depth_ranges::is_usable_in(const level_id &lid) const
     return any_matched;
 }
 
+bool depth_ranges::allows_branch(branch_type br) const
+{
+    for (const level_range &lr : depths)
+        if (!lr.deny && (lr.branch == br || lr.branch == NUM_BRANCHES))
+            return true;
+    return false;
+}
+
 void depth_ranges::add_depths(const depth_ranges &other_depths)
 {
     depths.insert(depths.end(),
@@ -2385,13 +2393,9 @@ void map_def::write_full(writer& outf) const
 
 void map_def::read_full(reader& inf)
 {
-    // There's a potential race-condition here:
-    // - If someone modifies a .des file while there are games in progress,
-    // - a new Crawl process will overwrite the .dsc.
-    // - older Crawl processes trying to reading the new .dsc will be hosed.
-    // We could try to recover from the condition (by locking and
-    // reloading the index), but it's easier to save the game at this
-    // point and let the player reload.
+    // If someone modifies a .des file while there are games in progress,
+    // a new Crawl process will replace the .dsc, but older processes keep
+    // reading the copy that they loaded along with their index.
 
     const auto version = get_save_version(inf);
     const auto major = version.major, minor = version.minor;
@@ -2469,17 +2473,16 @@ void map_def::load()
     if (!index_only)
         return;
 
-    const string descache_base = get_descache_path(cache_name, "");
-    file_lock deslock(descache_base + ".lk", "rb", false);
-    const string loadfile = descache_base + ".dsc";
-
-    reader inf(loadfile, TAG_MINOR_VERSION);
-    if (!inf.valid())
+    size_t cache_size;
+    const unsigned char *cache = des_cache_contents(cache_name, cache_size);
+    if (!cache || cache_offset < 0 || (size_t)cache_offset >= cache_size)
     {
         throw map_load_exception(
                 make_stringf("Map inf is invalid: %s", name.c_str()));
     }
-    inf.advance(cache_offset);
+
+    reader inf(cache + cache_offset, cache_size - cache_offset,
+               TAG_MINOR_VERSION);
     read_full(inf);
 
     index_only = false;
@@ -3003,6 +3006,7 @@ void map_def::update_cached_tags()
     cache_minivault = has_tag("minivault");
     cache_overwritable = has_tag("overwritable");
     cache_extra = has_tag("extra");
+    map_selectors_changed(*this);
 }
 
 bool map_def::is_minivault() const
@@ -10,7 +10,10 @@
 #include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <unordered_map>
+#include <fcntl.h>
 #include <sys/param.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #if defined(UNIX) || defined(TARGET_COMPILER_MINGW)
 #include <unistd.h>
@@ -32,6 +35,11 @@
 #include "tag-version.h"
 #include "terrain.h"
 
+#ifdef UNIX
+#define USE_MMAP
+#include <sys/mman.h>
+#endif
+
 #ifndef BYTE_ORDER
 # error BYTE_ORDER is not defined
 #endif
@@ -68,6 +76,33 @@ point_vector map_anchor_points;
 
 static map_vector vdefs;
 
+typedef vector<unsigned> vault_indices;
+
+// vdefs indexed by what map selectors look for, so that a selection only
+// has to test maps it could accept. Every list is in vdefs order, which
+// keeps the outcome of a selection (and so seeded dungeons) the same as
+// with a scan of all maps. Map Lua can change the tags, DEPTH and PLACE of
+// a loaded map; it is then indexed again (see map_selectors_changed()).
+// What it lost stays in the lists, which is harmless since selectors still
+// test every map they are given.
+struct map_index
+{
+    // Maps whose DEPTH or PLACE allows some level in each branch.
+    vault_indices by_depth[NUM_BRANCHES];
+    vault_indices by_place[NUM_BRANCHES];
+    unordered_map<string, vault_indices> by_tag;
+    // How many maps at the start of vdefs have been indexed.
+    unsigned indexed = 0;
+    // Indexed maps to index again.
+    vault_indices changed;
+
+    void update();
+    void index_map(unsigned i);
+    const vault_indices *with_tags(const unordered_set<string> &tags) const;
+};
+
+static map_index vindex;
+
 // Parameter array that vault code can use.
 string_vector map_parameters;
 
@@ -769,8 +804,14 @@ mapref_vector find_maps_for_tag(const string &tag,
     level_id place = level_id::current();
     unordered_set<string> tag_set = parse_tags(tag);
 
-    for (const map_def &mapdef : vdefs)
+    vindex.update();
+    const vault_indices *candidates = vindex.with_tags(tag_set);
+    if (!candidates)
+        return maps; // maps never have all of no tags
+
+    for (unsigned i : *candidates)
     {
+        const map_def &mapdef = vdefs[i];
         if (mapdef.has_all_tags(tag_set.begin(), tag_set.end())
             && !mapdef.has_tag("dummy")
             && (!check_depth || _debug_ignore_depth
@@ -798,6 +839,7 @@ private:
 public:
     bool accept(const map_def &md) const;
     void announce(const map_def *map) const;
+    const vault_indices *candidates() const;
 
     bool valid() const
     {
@@ -992,7 +1034,86 @@ string vault_chance_tag(const map_def &map)
     return "";
 }
 
-typedef vector<unsigned> vault_indices;
+// Indexes the maps added to vdefs since the last update.
+static void _add_to_index(vault_indices &maps, unsigned i)
+{
+    auto pos = lower_bound(maps.begin(), maps.end(), i);
+    if (pos == maps.end() || *pos != i)
+        maps.insert(pos, i);
+}
+
+void map_index::index_map(unsigned i)
+{
+    const map_def &map = vdefs[i];
+    for (int br = 0; br < NUM_BRANCHES; ++br)
+    {
+        if (map.depths.allows_branch(static_cast<branch_type>(br)))
+            _add_to_index(by_depth[br], i);
+        if (map.place.allows_branch(static_cast<branch_type>(br)))
+            _add_to_index(by_place[br], i);
+    }
+    for (const string &tag : map.get_tags_unsorted())
+        _add_to_index(by_tag[tag], i);
+}
+
+void map_index::update()
+{
+    for (unsigned i : changed)
+        index_map(i);
+    changed.clear();
+    for (; indexed < vdefs.size(); ++indexed)
+        index_map(indexed);
+}
+
+void map_selectors_changed(const map_def &map)
+{
+    // Only maps in vdefs are indexed, not the copies that get placed.
+    const less<const map_def *> before;
+    if (vdefs.empty() || before(&map, &vdefs.front())
+        || !before(&map, &vdefs.front() + vdefs.size()))
+    {
+        return;
+    }
+    const unsigned i = &map - &vdefs.front();
+    if (i < vindex.indexed)
+        vindex.changed.push_back(i);
+}
+
+// The shortest list of maps with one of the given tags, which includes all
+// maps that have every one of them; nullptr if no tags are given.
+const vault_indices *
+map_index::with_tags(const unordered_set<string> &tags) const
+{
+    static const vault_indices none;
+    const vault_indices *shortest = nullptr;
+    for (const string &tag : tags)
+    {
+        auto found = by_tag.find(tag);
+        if (found == by_tag.end())
+            return &none;
+        if (!shortest || found->second.size() < shortest->size())
+            shortest = &found->second;
+    }
+    return shortest;
+}
+
+// The maps that the selector could accept, or nullptr if all of them
+// have to be checked.
+const vault_indices *map_selector::candidates() const
+{
+    switch (sel)
+    {
+    case PLACE:
+        return &vindex.by_place[place.branch];
+    case DEPTH:
+    case DEPTH_AND_CHANCE:
+        return &vindex.by_depth[place.branch];
+    case TAG:
+        return vindex.with_tags(parse_tags(tag));
+    default:
+        return nullptr;
+    }
+}
 
 static vault_indices _eligible_maps_for_selector(const map_selector &sel)
 {
@@ -1000,9 +1121,19 @@ static vault_indices _eligible_maps_for_selector(const map_selector &sel)
 
     if (sel.valid())
     {
-        for (unsigned i = 0, size = vdefs.size(); i < size; ++i)
-            if (sel.accept(vdefs[i]))
-                eligible.push_back(i);
+        vindex.update();
+        if (const vault_indices *candidates = sel.candidates())
+        {
+            for (unsigned i : *candidates)
+                if (sel.accept(vdefs[i]))
+                    eligible.push_back(i);
+        }
+        else
+        {
+            for (unsigned i = 0, size = vdefs.size(); i < size; ++i)
+                if (sel.accept(vdefs[i]))
+                    eligible.push_back(i);
+        }
     }
 
     return eligible;
@@ -1278,6 +1409,91 @@ string get_descache_path(const string &file, const string &ext)
     return _des_cache_dir(basename);
 }
 
+// A des cache file, mapped read-only where possible so that all the games
+// on a server share one copy of it, and read into memory otherwise.
+class des_cache_file
+{
+public:
+    des_cache_file(const string &path);
+    ~des_cache_file();
+    des_cache_file(const des_cache_file &) = delete;
+    des_cache_file &operator=(const des_cache_file &) = delete;
+
+    const unsigned char *data;
+    size_t size;
+
+private:
+    bool mapped;
+    vector<unsigned char> contents;
+};
+
+des_cache_file::des_cache_file(const string &path)
+    : data(nullptr), size(0), mapped(false)
+{
+#ifdef USE_MMAP
+    int fd = open_u(path.c_str(), O_RDONLY, 0);
+    if (fd == -1)
+        return;
+    struct stat st;
+    if (!fstat(fd, &st) && st.st_size > 0)
+    {
+        void *m = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (m != MAP_FAILED)
+        {
+            data = (const unsigned char *)m;
+            size = st.st_size;
+            mapped = true;
+        }
+    }
+    close(fd);
+    if (mapped)
+        return;
+#endif
+
+    FILE *fp = fopen_u(path.c_str(), "rb");
+    if (!fp)
+        return;
+    unsigned char buf[16384];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+        contents.insert(contents.end(), buf, buf + len);
+    fclose(fp);
+    data = contents.data();
+    size = contents.size();
+}
+
+des_cache_file::~des_cache_file()
+{
+#ifdef USE_MMAP
+    if (mapped)
+        munmap((void *)data, size);
+#endif
+}
+
+// The .dsc files holding the full definitions of cached maps, by cache
+// name. Each is loaded along with its index and kept, even if a newer
+// cache replaces it on disk, so the offsets in that index stay valid.
+static map<string, unique_ptr<des_cache_file>> des_cache_files;
+
+static const des_cache_file &_load_des_cache_full(const string &cache,
+                                                  const string &base)
+{
+    unique_ptr<des_cache_file> &file = des_cache_files[cache];
+    file = make_unique<des_cache_file>(base + ".dsc");
+    return *file;
+}
+
+const unsigned char *des_cache_contents(const string &cache, size_t &size)
+{
+    auto found = des_cache_files.find(cache);
+    const des_cache_file &file =
+        found != des_cache_files.end()
+            ? *found->second
+            : _load_des_cache_full(cache, get_descache_path(cache, ""));
+    size = file.size;
+    return file.size ? file.data : nullptr;
+}
+
 static bool verify_file_version(const string &file, time_t mtime)
 {
     FILE *fp = fopen_u(file.c_str(), "rb");
@@ -1336,11 +1552,11 @@ static bool _load_map_index(const string& cache, const string &base,
         global_preludes.push_back(lc_global_prelude);
     }
 
-    FILE* fp = fopen_u((base + ".idx").c_str(), "rb");
-    if (!fp)
+    const des_cache_file idx(base + ".idx");
+    if (!idx.data)
         end(1, true, "Unable to read %s", (base + ".idx").c_str());
 
-    reader inf(fp, TAG_MINOR_VERSION);
+    reader inf(idx.data, idx.size, TAG_MINOR_VERSION);
     // Re-check version, might have been modified in the meantime.
     const auto version = get_save_version(inf);
     const auto major = version.major, minor = version.minor;
@@ -1372,8 +1588,8 @@ static bool _load_map_index(const string& cache, const string &base,
         lc_loaded_maps[vdef.name] = vdef.place_loaded_from;
         vdef.place_loaded_from.clear();
     }
-    fclose(fp);
 
+    _load_des_cache_full(cache, base);
     return true;
 }
 
@@ -1422,18 +1638,24 @@ static void _write_map_prelude(const string &filebase, time_t mtime)
 static void _write_map_full(const string &filebase, size_t vs, size_t ve,
                             time_t mtime)
 {
+    // Games that have the old file mapped keep using it, so it is replaced
+    // rather than overwritten.
     const string cfile = filebase + ".dsc";
-    FILE *fp = fopen_u(cfile.c_str(), "wb");
+    const string tmpfile = cfile + ".tmp";
+    FILE *fp = fopen_u(tmpfile.c_str(), "wb");
     if (!fp)
-        end(1, true, "Unable to open %s for writing", cfile.c_str());
+        end(1, true, "Unable to open %s for writing", tmpfile.c_str());
 
-    writer outf(cfile, fp);
+    writer outf(tmpfile, fp);
     write_save_version(outf, save_version::current());
     marshallByte(outf, WORD_LEN);
     marshallSigned(outf, mtime);
     for (size_t i = vs; i < ve; ++i)
         vdefs[i].write_full(outf);
     fclose(fp);
+
+    if (rename_u(tmpfile.c_str(), cfile.c_str()))
+        end(1, true, "Unable to replace %s", cfile.c_str());
 }
 
 static void _write_map_index(const string &filebase, size_t vs, size_t ve,
@@ -1472,6 +1694,7 @@ static void _write_map_cache(const string &filename, size_t vs, size_t ve,
     _write_map_prelude(descache_base, mtime);
     _write_map_full(descache_base, vs, ve, mtime);
     _write_map_index(descache_base, vs, ve, mtime);
+    _load_des_cache_full(filename, descache_base);
 }
 
 static void _parse_maps(const string &s)
@@ -1533,6 +1756,8 @@ void read_maps()
             brdepth[it->id] = it->numlevels;
         dlua.execfile("dlua/sanity.lua", true, true);
     }
+
+    vindex.update();
 }
 
 // If a .dsc file has been changed under the running Crawl, discard
@@ -1547,6 +1772,7 @@ void reread_maps()
 
     // BOOM!
     vdefs.clear();
+    vindex = map_index();
     map_files_read.clear();
     read_maps();
 }
@@ -1566,6 +1792,7 @@ void add_parsed_map(const map_def &md)
 
     map.fixup();
     vdefs.push_back(map);
+    vindex.update();
 }
 
 void run_map_global_preludes()
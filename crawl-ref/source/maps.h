@@ -48,6 +48,8 @@ void dgn_ignore_depth(bool b);
 
 void dump_map(const map_def &map);
 void add_parsed_map(const map_def &md);
+// Call after the tags, DEPTH or PLACE of a map change.
+void map_selectors_changed(const map_def &map);
 
 vector<string> find_map_matches(const string &name);
 
@@ -61,6 +63,7 @@ void read_map(const string &file);
 void run_map_global_preludes();
 void run_map_local_preludes();
 string get_descache_path(const string &file, const string &ext);
+const unsigned char *des_cache_contents(const string &cache, size_t &size);
 
 typedef map<string, map_file_place> map_load_info_t;
 
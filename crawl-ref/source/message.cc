@@ -1363,15 +1363,77 @@ void dprf(diag_type param, const char *format, ...)
 
 static bool _updating_view = false;
 
+static const text_pattern &_pattern_of(const text_pattern &pat)
+{
+    return pat;
+}
+
+static const text_pattern &_pattern_of(const message_filter &mf)
+{
+    return mf.pattern;
+}
+
+static const text_pattern &_pattern_of(const message_colour_mapping &mcm)
+{
+    return mcm.message.pattern;
+}
+
+// All the patterns of one message option, combined so that a message only
+// has to be tried against the patterns that could possibly match it. Built
+// from the option on first use, and again after message_options_changed().
+template <typename T>
+class option_patterns
+{
+public:
+    // The index of the first entry of option for which check() is true,
+    // or -1 if there is none.
+    int find(const vector<T> &option, const string &line,
+             const function<bool(const T&)> &check)
+    {
+        if (option.empty())
+            return -1;
+        if (stale || matcher.size() != option.size())
+        {
+            matcher.clear();
+            for (const T &entry : option)
+                matcher.add(_pattern_of(entry).tostring());
+            stale = false;
+        }
+        return matcher.find(line, [&](size_t i) { return check(option[i]); });
+    }
+
+    void invalidate()
+    {
+        stale = true;
+    }
+
+private:
+    bool stale = true;
+    text_pattern_set matcher;
+};
+
+static option_patterns<message_filter> more_patterns;
+static option_patterns<message_filter> flash_patterns;
+static option_patterns<text_pattern> note_patterns;
+static option_patterns<message_colour_mapping> colour_patterns;
+
+void message_options_changed()
+{
+    more_patterns.invalidate();
+    flash_patterns.invalidate();
+    note_patterns.invalidate();
+    colour_patterns.invalidate();
+}
+
 static bool _check_option(const string& line, msg_channel_type channel,
-                          const vector<message_filter>& option)
+                          const vector<message_filter>& option,
+                          option_patterns<message_filter>& patterns)
 {
     if (crawl_state.generating_level)
         return false;
-    return any_of(begin(option),
-                  end(option),
-                  bind(mem_fn(&message_filter::is_filtered),
-                       placeholders::_1, channel, line));
+    return patterns.find(option, line, [&](const message_filter &mf)
+                                       { return mf.is_filtered(channel, line); })
+           != -1;
 }
 
 static bool _check_more(const string& line, msg_channel_type channel)
@@ -1381,7 +1443,8 @@ static bool _check_more(const string& line, msg_channel_type channel)
     // crash here in order to find the real bug?
     if (!you.on_current_level)
         return false;
-    return _check_option(line, channel, Options.force_more_message);
+    return _check_option(line, channel, Options.force_more_message,
+                         more_patterns);
 }
 
 static bool _check_flash_screen(const string& line, msg_channel_type channel)
@@ -1391,7 +1454,8 @@ static bool _check_flash_screen(const string& line, msg_channel_type channel)
     // crash here in order to find the real bug?
     if (!you.on_current_level)
         return false;
-    return _check_option(line, channel, Options.flash_screen_message);
+    return _check_option(line, channel, Options.flash_screen_message,
+                         flash_patterns);
 }
 
 static bool _check_join(const string& /*line*/, msg_channel_type channel)
@@ -1775,21 +1839,15 @@ static void mpr_check_patterns(const string& message,
 {
     if (crawl_state.generating_level)
         return;
-    for (const text_pattern &pat : Options.note_messages)
+    if (channel != MSGCH_EQUIPMENT && channel != MSGCH_FLOOR_ITEMS
+        && channel != MSGCH_MULTITURN_ACTION
+        && channel != MSGCH_EXAMINE && channel != MSGCH_EXAMINE_FILTER
+        && channel != MSGCH_TUTORIAL && channel != MSGCH_DGL_MESSAGE
+        && note_patterns.find(Options.note_messages, message,
+                              [&](const text_pattern &pat)
+                              { return pat.matches(message); }) != -1)
     {
-        if (channel == MSGCH_EQUIPMENT || channel == MSGCH_FLOOR_ITEMS
-            || channel == MSGCH_MULTITURN_ACTION
-            || channel == MSGCH_EXAMINE || channel == MSGCH_EXAMINE_FILTER
-            || channel == MSGCH_TUTORIAL || channel == MSGCH_DGL_MESSAGE)
-        {
-            continue;
-        }
-
-        if (pat.matches(message))
-        {
-            take_note(Note(NOTE_MESSAGE, channel, param, message));
-            break;
-        }
+        take_note(Note(NOTE_MESSAGE, channel, param, message));
     }
 
     if (channel != MSGCH_DIAGNOSTICS && channel != MSGCH_EQUIPMENT)
@@ -1835,19 +1893,53 @@ static msg_colour_type prepare_message(const string& imsg,
 
     if (!crawl_state.generating_level)
     {
-        for (const message_colour_mapping &mcm : Options.message_colour_mappings)
-        {
-            if (mcm.valid() && mcm.message.is_filtered(channel, imsg))
+        const auto &mappings = Options.message_colour_mappings;
+        const int i = colour_patterns.find(mappings, imsg,
+            [&](const message_colour_mapping &mcm)
             {
-                colour = mcm.colour;
-                break;
-            }
-        }
+                return mcm.valid() && mcm.message.is_filtered(channel, imsg);
+            });
+        if (i != -1)
+            colour = mappings[i].colour;
     }
 
     return colour;
 }
 
+int message_filter_matches(const string& line, msg_channel_type channel)
+{
+    int matches = 0;
+    if (more_patterns.find(Options.force_more_message, line,
+                           [&](const message_filter &mf)
+                           { return mf.is_filtered(channel, line); }) != -1)
+    {
+        ++matches;
+    }
+    if (flash_patterns.find(Options.flash_screen_message, line,
+                            [&](const message_filter &mf)
+                            { return mf.is_filtered(channel, line); }) != -1)
+    {
+        ++matches;
+    }
+    if (note_patterns.find(Options.note_messages, line,
+                           [&](const text_pattern &pat)
+                           { return pat.matches(line); }) != -1)
+    {
+        ++matches;
+    }
+    if (colour_patterns.find(Options.message_colour_mappings, line,
+                             [&](const message_colour_mapping &mcm)
+                             {
+                                 return mcm.valid()
+                                        && mcm.message.is_filtered(channel,
+                                                                   line);
+                             }) != -1)
+    {
+        ++matches;
+    }
+    return matches;
+}
+
 void flush_prev_message()
 {
     buffer.flush_prev();
@@ -173,6 +173,12 @@ bool recent_error_messages();
 int channel_to_colour(msg_channel_type channel, int param = 0);
 bool strip_channel_prefix(string &text, msg_channel_type &channel,
                           bool silence = false);
+// How many of the message options (force_more_message, flash_screen_message,
+// note_messages and message_colour_mappings) match line, without acting on
+// any of them.
+int message_filter_matches(const string& line, msg_channel_type channel);
+// Call after any of those options changes.
+void message_options_changed();
 
 namespace msg
 {
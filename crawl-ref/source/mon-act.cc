@@ -20,6 +20,7 @@
 #include "delay.h"
 #include "directn.h" // feature_description_at
 #include "dungeon.h"
+#include "energy-queue.h"
 #include "english.h" // apostrophise
 #include "fight.h"
 #include "fineff.h"
@@ -2554,9 +2555,9 @@ static void _post_monster_move(monster* mons)
         monster_die(*mons, KILL_NON_ACTOR, NON_MONSTER);
 }
 
-priority_queue<pair<monster *, int>,
-               vector<pair<monster *, int> >,
-               MonsterActionQueueCompare> monster_queue;
+// Monsters with energy to act this turn, most energy first. The order of
+// those with the same energy is the old priority_queue's; see energy_queue.
+static energy_queue<monster *> monster_queue;
 
 // Inserts a monster into the monster queue (needed to ensure that any monsters
 // given energy or an action by a effect can actually make use of that energy
@@ -2566,6 +2567,15 @@ void queue_monster_for_action(monster* mons)
     monster_queue.emplace(mons, mons->speed_increment);
 }
 
+// A monster's upkeep at the start of a turn. Once that has settled its
+// energy, it joins the queue if it has enough to act.
+static void _start_monster_turn(monster& mons)
+{
+    _pre_monster_move(mons);
+    if (!invalid_monster(&mons) && mons.alive() && mons.has_action_energy())
+        queue_monster_for_action(&mons);
+}
+
 void clear_monster_flags()
 {
     // Clear any summoning flags so that lower indiced monsters get their
@@ -2642,11 +2652,12 @@ static void _display_just_seen()
  */
 void handle_monsters(bool with_noise)
 {
+    // Every monster's per-turn upkeep (energy, enchantments...) draws from
+    // the RNG, so it has to happen for each of them, in index order. This
+    // also settles their energy for the turn, and queues those that can act.
     for (monster_iterator mi; mi; ++mi)
     {
-        _pre_monster_move(**mi);
-        if (!invalid_monster(*mi) && mi->alive() && mi->has_action_energy())
-            monster_queue.emplace(*mi, mi->speed_increment);
+        _start_monster_turn(**mi);
         fire_final_effects();
     }
 
@@ -14,15 +14,6 @@ using std::pair;
 class monster;
 struct bolt;
 
-class MonsterActionQueueCompare
-{
-public:
-    bool operator() (pair<monster*, int> m1, pair<monster*, int> m2)
-    {
-        return m1.second < m2.second;
-    }
-};
-
 void mons_set_just_seen(monster *mon);
 void mons_reset_just_seen();
 
@@ -1635,11 +1635,36 @@ static bool _monster_will_buff(const monster &caster, const monster &targ)
 }
 
 /// Find an allied monster to cast a beneficial beam spell at.
-static monster* _get_allied_target(const monster &caster, bolt &tracer)
+/**
+ * Of the given (distance, monster) candidates, find the nearest one that a
+ * tracer can reach without hitting anything it shouldn't, taking the first
+ * one listed among equally near ones. Tracers are only fired until one is
+ * found, nearest first.
+ */
+static monster* _first_clear_target(const monster* caster, bolt &tracer,
+                                    vector<pair<int, monster*>> &candidates)
 {
-    monster* selected_target = nullptr;
-    int min_distance = tracer.range;
+    stable_sort(candidates.begin(), candidates.end(),
+                [](const pair<int, monster*> &a, const pair<int, monster*> &b)
+                { return a.first < b.first; });
+
+    for (const auto &candidate : candidates)
+    {
+        // Make sure we won't hit someone other than we're aiming at.
+        tracer.target = candidate.second->pos();
+        fire_tracer(caster, tracer);
+        if (mons_should_fire(tracer)
+            && tracer.path_taken.back() == tracer.target)
+        {
+            return candidate.second;
+        }
+    }
+    return nullptr;
+}
 
+static monster* _get_allied_target(const monster &caster, bolt &tracer)
+{
+    vector<pair<int, monster*>> candidates;
     for (monster_near_iterator targ(&caster, LOS_NO_TRANS); targ; ++targ)
     {
         if (*targ == &caster
@@ -1649,38 +1674,24 @@ static monster* _get_allied_target(const monster &caster, bolt &tracer)
             continue;
         }
 
-        // prefer the closest ally we can find (why?)
         const int targ_distance = grid_distance(targ->pos(), caster.pos());
-        if (targ_distance < min_distance)
-        {
-            // Make sure we won't hit someone other than we're aiming at.
-            tracer.target = targ->pos();
-            fire_tracer(&caster, tracer);
-            if (!mons_should_fire(tracer)
-                || tracer.path_taken.back() != tracer.target)
-            {
-                continue;
-            }
-
-            min_distance = targ_distance;
-            selected_target = *targ;
-        }
+        if (targ_distance < tracer.range)
+            candidates.emplace_back(targ_distance, *targ);
     }
 
-    return selected_target;
+    // prefer the closest ally we can find (why?)
+    return _first_clear_target(&caster, tracer, candidates);
 }
 
 // Find an ally of the target to cast a hex at.
 // Note that this deliberately does not target the player.
 static bool _set_hex_target(monster* caster, bolt& pbolt)
 {
-    monster* selected_target = nullptr;
-    int min_distance = INT_MAX;
-
     const actor *foe = caster->get_foe();
     if (!foe)
         return false;
 
+    vector<pair<int, monster*>> candidates;
     for (monster_near_iterator targ(caster, LOS_NO_TRANS); targ; ++targ)
     {
         if (*targ == caster)
@@ -1688,34 +1699,18 @@ static bool _set_hex_target(monster* caster, bolt& pbolt)
 
         const int targ_distance = grid_distance(targ->pos(), foe->pos());
 
-        bool got_target = false;
-
         if (mons_aligned(*targ, foe)
             && !targ->has_ench(ENCH_CHARM)
             && !targ->has_ench(ENCH_HEXED)
             && !targ->is_firewood()
-            && !_flavour_benefits_monster(pbolt.flavour, **targ))
-        {
-            got_target = true;
-        }
-
-        if (got_target && targ_distance < min_distance
+            && !_flavour_benefits_monster(pbolt.flavour, **targ)
             && targ_distance < pbolt.range)
         {
-            // Make sure we won't hit an invalid target with this aim.
-            pbolt.target = targ->pos();
-            fire_tracer(caster, pbolt);
-            if (!mons_should_fire(pbolt)
-                || pbolt.path_taken.back() != pbolt.target)
-            {
-                continue;
-            }
-
-            min_distance = targ_distance;
-            selected_target = *targ;
+            candidates.emplace_back(targ_distance, *targ);
         }
     }
 
+    monster* selected_target = _first_clear_target(caster, pbolt, candidates);
     if (selected_target)
     {
         pbolt.target = selected_target->pos();
@@ -2842,7 +2837,7 @@ static int _tension_door_closed(set<coord_def> door,
 {
     // this unwind is a bit heavy, but because out-of-los clouds dissipate
     // instantly, they can be wiped out by these door tests.
-    unwind_var<map<coord_def, cloud_struct>> cloud_state(env.cloud);
+    unwind_var<cloud_store> cloud_state(env.cloud);
     _set_door(door, DNGN_CLOSED_DOOR);
     const int new_tension = get_tension(GOD_NO_GOD);
     _set_door(door, old_feat);
@@ -4803,6 +4798,11 @@ bool handle_mon_spell(monster* mons)
         return false;
     }
 
+    // Nothing moves until the monster has picked its spell, so the same
+    // tracer fired twice meanwhile (e.g. first to find an ally to buff, then
+    // to check the buff) only needs walking once.
+    unique_ptr<tracer_cache_scope> cached_tracers(new tracer_cache_scope);
+
     const monster_spells hspell_pass = _find_usable_spells(*mons);
 
     // If no useful spells... cast no spell.
@@ -4855,6 +4855,7 @@ bool handle_mon_spell(monster* mons)
             {
                 mprf(MSGCH_GOD, "You redirect %s's attack!",
                      mons->name(DESC_THE).c_str());
+                cached_tracers->forget();
             }
         }
     }
@@ -4891,6 +4892,9 @@ bool handle_mon_spell(monster* mons)
         return false;
     }
 
+    // From here on things start happening.
+    cached_tracers.reset();
+
     // Check for antimagic if casting a spell spell.
     if (mons->has_ench(ENCH_ANTIMAGIC) && flags & MON_SPELL_ANTIMAGIC_MASK
         && !x_chance_in_y(4 * BASELINE_DELAY,
@@ -154,6 +154,7 @@ void monster::reset()
     mons_remove_from_grid(*this);
     target.reset();
     position.reset();
+    monster_index_moved(*this);
     firing_pos.reset();
     patrol_point.reset();
     travel_target = MTRAV_NONE;
@@ -186,6 +187,7 @@ void monster::init_with(const monster& mon)
     speed             = mon.speed;
     speed_increment   = mon.speed_increment;
     position          = mon.position;
+    monster_index_moved(*this);
     target            = mon.target;
     firing_pos        = mon.firing_pos;
     patrol_point      = mon.patrol_point;
@@ -2531,6 +2533,7 @@ void monster::set_position(const coord_def &c)
     }
 
     actor::set_position(c);
+    monster_index_moved(*this);
 }
 
 void monster::moveto(const coord_def& c, bool clear_net, bool clear_constrict)
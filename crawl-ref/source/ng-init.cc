@@ -424,6 +424,9 @@ void initialise_item_descriptions()
             }
         }
     }
+
+    // Names remembered with the old descriptions are no longer right.
+    invalidate_item_names();
 }
 
 void fix_up_jiyva_name()
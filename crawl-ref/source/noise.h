@@ -77,6 +77,10 @@ struct noise_cell
     int noise_intensity_millis;
     int noise_travel_distance;
 
+    // The noise_grid generation this cell was last written in. Cells from
+    // older generations are silent, whatever else they hold.
+    uint32_t generation;
+
     noise_cell();
     bool can_apply_noise(int noise_intensity_millis) const;
     bool apply_noise(int noise_intensity_millis,
@@ -140,8 +144,17 @@ private:
                                        const coord_def &affected_position,
                                        const noise_t &noise) const;
 
+    noise_cell &cell_at(const coord_def &p);
+    const noise_cell &cell_at(const coord_def &p) const;
+
 private:
+    // Only cells stamped with the current generation hold noise, so that
+    // reset() doesn't have to touch the whole grid.
     FixedArray<noise_cell, GXM, GYM> cells;
+    uint32_t generation;
     vector<noise_t> noises;
     int affected_actor_count;
+
+    // Kept between propagations so that their storage is reused.
+    vector<coord_def> noise_perimeter[2];
 };
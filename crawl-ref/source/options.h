@@ -451,6 +451,7 @@ public:
     string game_seed; // string version of the rc option
     uint64_t    seed_from_rc;
     level_gen_type pregen_dungeon;
+    bool        pregen_in_background; // Build the next level while playing.
 
 #ifdef DGL_SIMPLE_MESSAGING
     bool        messaging;      // Check for messages.
@@ -16,6 +16,16 @@ Notes:
 * Readers always get the last complete (but not necessarily committed) write
   (ie, READ_UNCOMMITTED) at the time they started; it is safe to continue
   reading even if the chunk has been changed since.
+* Chunks are written as a codec byte followed by frames of at most
+  CHUNK_FRAME_SIZE bytes, each compressed on its own. Frames are handed to
+  worker threads as they fill up, and written out in order as they come
+  back; a writer waits only for its last frames when it is closed.
+* Where possible, chunks are read from a read-only mapping of the file, and
+  frames that don't straddle blocks are decompressed straight from it.
+* commit(true) writes the directory, then leaves syncing and updating the
+  header to a background thread. Until that is joined (by the next commit,
+  abort, closing the package or exiting), the old header is the one that
+  counts, so no block it may still use is freed.
 */
 
 #include "AppHdr.h"
@@ -36,9 +46,17 @@ Notes:
 #include "end.h"
 #include "endianness.h"
 #include "errors.h"
+#include "lzcodec.h"
 #include "syscalls.h"
 #include "libutil.h" // map_find
 
+#ifdef UNIX
+#define PACKAGE_THREADS
+#include "threads.h"
+#define USE_MMAP
+#include <sys/mman.h>
+#endif
+
 // debugging defines
 #undef  FSCK_VERBOSE
 #undef  COSTLY_ASSERTS
@@ -59,7 +77,7 @@ static plen_t htole(plen_t x)
 #define dprintf(...) do {} while (0)
 #endif
 
-#define PACKAGE_VERSION 1
+#define PACKAGE_VERSION 2
 #define PACKAGE_MAGIC   0x53534344 /* "DCSS" */
 
 struct file_header
@@ -82,7 +100,8 @@ typedef map<plen_t, bm_p> bm_t;
 typedef map<plen_t, plen_t> fb_t;
 
 package::package(const char* file, bool writeable, bool empty)
-  : n_users(0), dirty(false), aborted(false)
+  : n_users(0), dirty(false), aborted(false), codec(DEFAULT_CHUNK_CODEC),
+    map_base(nullptr), map_len(0), map_failed(false)
 #ifdef DO_FSYNC
     , tmp(false)
 #endif
@@ -132,7 +151,9 @@ package::package(const char* file, bool writeable, bool empty)
 }
 
 package::package()
-  : rw(true), n_users(0), dirty(false), aborted(false)
+  : rw(true), n_users(0), dirty(false), aborted(false),
+    codec(DEFAULT_CHUNK_CODEC), map_base(nullptr), map_len(0),
+    map_failed(false)
 #ifdef DO_FSYNC
     , tmp(true)
 #endif
@@ -214,6 +235,7 @@ package::~package()
         // catching missing manual deletes. The C++ exit handler is the
         // only place that can be legitimately call things in wrong order.
 
+    unmap();
     if (rw && !aborted)
     {
         commit();
@@ -231,9 +253,81 @@ package::~package()
     dprintf("package: closed\n");
 }
 
-void package::commit()
+// Point the header at a new directory, whose chunks have all been written.
+// Returns an error message, or nullptr on success.
+static const char *_write_header(int fd, const file_header &head, bool sync)
+{
+#ifdef DO_FSYNC
+    // We need a barrier before updating the link to point at the new directory.
+    if (sync && fdatasync(fd))
+        return "flush error while saving";
+#else
+    UNUSED(sync);
+#endif
+#ifdef PACKAGE_THREADS
+    // Doesn't disturb the file offset, which the game may be using.
+    if (pwrite(fd, &head, sizeof(head), 0) != sizeof(head))
+        return "write error while saving";
+#else
+    if (lseek(fd, 0, SEEK_SET) != 0)
+        return "failed to seek inside the save file";
+    if (write(fd, &head, sizeof(head)) != sizeof(head))
+        return "write error while saving";
+#endif
+#ifdef DO_FSYNC
+    if (sync && fdatasync(fd))
+        return "flush error while saving";
+#endif
+    return nullptr;
+}
+
+struct async_commit
+{
+    async_commit(int _fd, const file_header &_head, bool _sync)
+        : fd(_fd), head(_head), sync(_sync), error(nullptr), error_no(0) {}
+    int fd;
+    file_header head;
+    bool sync;
+    const char *error;
+    int error_no;
+#ifdef PACKAGE_THREADS
+    thread_t thread;
+#endif
+};
+
+#ifdef PACKAGE_THREADS
+static set<package*> async_packages;
+
+static void *_async_commit_thread(void *arg)
+{
+    async_commit *ac = (async_commit *)arg;
+    ac->error = _write_header(ac->fd, ac->head, ac->sync);
+    if (ac->error)
+        ac->error_no = errno;
+    return nullptr;
+}
+
+// Don't let a commit that is under way be cut short by a normal exit.
+static void _finish_async_commits()
+{
+    const set<package*> pkgs = async_packages;
+    for (package *pkg : pkgs)
+    {
+        try
+        {
+            pkg->finish_commit();
+        }
+        catch (const ext_fail_exception &)
+        {
+        }
+    }
+}
+#endif
+
+void package::commit(bool async)
 {
     ASSERT(rw);
+    finish_commit();
     if (!dirty)
         return;
     ASSERT(!aborted);
@@ -248,18 +342,42 @@ void package::commit()
     memset(&head.padding, 0, sizeof(head.padding));
     head.start = htole(write_directory());
 #ifdef DO_FSYNC
-    // We need a barrier before updating the link to point at the new directory.
-    if (!tmp && fdatasync(fd))
-        sysfail("flush error while saving");
+    const bool sync = !tmp;
+#else
+    const bool sync = false;
 #endif
-    seek(0);
-    if (write(fd, &head, sizeof(head)) != sizeof(head))
-        sysfail("write error while saving");
-#ifdef DO_FSYNC
-    if (!tmp && fdatasync(fd))
-        sysfail("flush error while saving");
+
+#ifdef PACKAGE_THREADS
+    if (async)
+    {
+        unique_ptr<async_commit> ac(new async_commit(fd, head, sync));
+        if (!thread_create_joinable(&ac->thread, _async_commit_thread,
+                                    ac.get()))
+        {
+            static bool registered = false;
+            if (!registered)
+                atexit(_finish_async_commits);
+            registered = true;
+            async_packages.insert(this);
+
+            pending_commit = move(ac);
+            // Blocks unlinked so far are freed once the header is on disk;
+            // chunks written from now on are referenced by it, so can't be
+            // freed before the next commit.
+            committing_blocks.swap(unlinked_blocks);
+            new_chunks.clear();
+            dirty = false;
+            return;
+        }
+        // No thread to be had, just do it here.
+    }
+#else
+    UNUSED(async);
 #endif
 
+    if (const char *error = _write_header(fd, head, sync))
+        sysfail("%s", error);
+
     new_chunks.clear();
     collect_blocks();
     dirty = false;
@@ -269,6 +387,43 @@ void package::commit()
 #endif
 }
 
+// Wait for a commit running in the background, if any.
+void package::finish_commit()
+{
+    if (!pending_commit)
+        return;
+
+#ifdef PACKAGE_THREADS
+    thread_join(pending_commit->thread);
+    async_packages.erase(this);
+#endif
+    unique_ptr<async_commit> ac = move(pending_commit);
+
+    if (aborted)
+        return;
+
+    if (ac->error)
+    {
+        // The old header still stands; keep everything it uses.
+        unlinked_blocks.insert(unlinked_blocks.end(), committing_blocks.begin(),
+                               committing_blocks.end());
+        committing_blocks.clear();
+        dirty = true;
+        errno = ac->error_no;
+        sysfail("%s", ac->error);
+    }
+
+    vector<plen_t> later;
+    later.swap(unlinked_blocks);
+    unlinked_blocks.swap(committing_blocks);
+    collect_blocks();
+    unlinked_blocks.insert(unlinked_blocks.end(), later.begin(), later.end());
+
+#ifdef COSTLY_ASSERTS
+    fsck();
+#endif
+}
+
 void package::seek(plen_t to)
 {
     ASSERT(!aborted);
@@ -279,6 +434,69 @@ void package::seek(plen_t to)
         sysfail("failed to seek inside the save file");
 }
 
+// A pointer to [at, at+len) of the file, if it can be mapped. The file is
+// mapped again if it has grown, so the pointer is good only until the next
+// call.
+const char *package::map_range(plen_t at, plen_t len)
+{
+#ifdef USE_MMAP
+    if (at + len <= map_len)
+        return map_base + at;
+    if (map_failed)
+        return nullptr;
+
+    struct stat st;
+    if (fstat(fd, &st))
+    {
+        map_failed = true;
+        return nullptr;
+    }
+    if ((off_t)(at + len) > st.st_size)
+        return nullptr;
+
+    unmap();
+    void *m = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED)
+    {
+        dprintf("package: can't map the file, using read()\n");
+        map_failed = true;
+        return nullptr;
+    }
+    map_base = (const char*)m;
+    map_len = st.st_size;
+    return map_base + at;
+#else
+    UNUSED(at, len);
+    return nullptr;
+#endif
+}
+
+void package::unmap()
+{
+#ifdef USE_MMAP
+    if (map_base)
+        munmap((void*)map_base, map_len);
+#endif
+    map_base = nullptr;
+    map_len = 0;
+}
+
+// Returns false if the file is too short.
+bool package::read_at(plen_t at, void *data, plen_t len)
+{
+    if (const char *src = map_range(at, len))
+    {
+        memcpy(data, src, len);
+        return true;
+    }
+
+    seek(at);
+    ssize_t res = ::read(fd, data, len);
+    if (res < 0)
+        sysfail("error reading the save file");
+    return (plen_t)res == len;
+}
+
 chunk_writer* package::writer(const string &name)
 {
     return new chunk_writer(this, name);
@@ -540,6 +758,7 @@ void package::read_directory(plen_t start, uint8_t version)
         }
         break;
     case 1:
+    case 2: // only chunk encodings changed
         uint8_t name_len;
         plen_t bstart;
         while (plen_t res = rd.read(&name_len, sizeof(name_len)))
@@ -620,11 +839,13 @@ void package::abort()
     // this point are ignored (assuming we already failed). All writes since
     // the last commit() are lost.
     aborted = true;
+    finish_commit();
 }
 
 void package::unlink()
 {
     abort();
+    unmap();
     close(fd);
     fd = -1;
     ::unlink_u(filename.c_str());
@@ -673,6 +894,219 @@ plen_t package::get_chunk_compressed_length(const string &name)
     return len;
 }
 
+struct frame_header
+{
+    plen_t len;         // uncompressed
+    plen_t packed_len;  // as stored; equal to len if stored uncompressed
+};
+
+enum frame_state
+{
+    FRAME_QUEUED,
+    FRAME_WORKING,
+    FRAME_DONE,
+};
+
+// A chunk's first byte is either one of these or a zlib header.
+COMPILE_CHECK((uint8_t)chunk_codec::NUM_CODECS <= 8);
+
+struct chunk_frame
+{
+    chunk_frame(chunk_codec c) : codec(c), state(FRAME_DONE), failed(false) {}
+    chunk_codec codec;
+    // The raw data, replaced by the frame as it is to be written.
+    vector<char> data;
+    frame_state state;
+    bool failed;
+};
+
+static void _encode_frame(chunk_frame &f)
+{
+    const plen_t len = f.data.size();
+    vector<char> out(sizeof(frame_header));
+    switch (f.codec)
+    {
+    case chunk_codec::store:
+        break;
+#ifdef USE_ZLIB
+    case chunk_codec::zlib:
+    {
+        uLongf packed_len = compressBound(len);
+        out.resize(sizeof(frame_header) + packed_len);
+        if (compress2((Bytef*)&out[sizeof(frame_header)], &packed_len,
+                      (Bytef*)&f.data[0], len, Z_DEFAULT_COMPRESSION) != Z_OK)
+        {
+            f.failed = true;
+            return;
+        }
+        out.resize(sizeof(frame_header) + packed_len);
+        break;
+    }
+#endif
+    case chunk_codec::lz:
+        lz_compress(&f.data[0], len, out);
+        break;
+    default:
+        f.failed = true;
+        return;
+    }
+
+    // Don't bother with frames that don't shrink.
+    if (out.size() == sizeof(frame_header)
+        || out.size() >= sizeof(frame_header) + len)
+    {
+        out.resize(sizeof(frame_header));
+        out.insert(out.end(), f.data.begin(), f.data.end());
+    }
+
+    frame_header head;
+    head.len = htole(len);
+    head.packed_len = htole(out.size() - sizeof(frame_header));
+    memcpy(&out[0], &head, sizeof(head));
+    f.data.swap(out);
+}
+
+// Runs on the worker threads, so errors are reported back rather than
+// thrown.
+static void _encode_frame_safely(chunk_frame &f)
+{
+    try
+    {
+        _encode_frame(f);
+    }
+    catch (const bad_alloc&)
+    {
+        f.failed = true;
+    }
+}
+
+#ifdef PACKAGE_THREADS
+// A few worker threads shared by all packages. Without any (on a single
+// core, or if they can't be started), frames are compressed in place.
+#define MAX_FRAME_WORKERS 3
+
+static mutex_t frame_mutex;
+static cond_t frame_queued, frame_done;
+static deque<chunk_frame*> frame_queue;
+static int n_frame_workers = -1;
+
+static void *_frame_worker(void*)
+{
+    mutex_lock(frame_mutex);
+    while (true)
+    {
+        while (frame_queue.empty())
+            cond_wait(frame_queued, frame_mutex);
+        chunk_frame *f = frame_queue.front();
+        frame_queue.pop_front();
+        f->state = FRAME_WORKING;
+        mutex_unlock(frame_mutex);
+
+        _encode_frame_safely(*f);
+
+        mutex_lock(frame_mutex);
+        f->state = FRAME_DONE;
+        cond_wake(frame_done);
+    }
+    return nullptr;
+}
+
+static void _start_frame_workers()
+{
+    if (n_frame_workers >= 0)
+        return;
+
+    mutex_init(frame_mutex);
+    cond_init(frame_queued);
+    cond_init(frame_done);
+
+    // Leave one core for the game itself.
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+    if (cpus > MAX_FRAME_WORKERS)
+        cpus = MAX_FRAME_WORKERS;
+    n_frame_workers = 0;
+    for (long i = 0; i < cpus; i++)
+    {
+        thread_t th;
+        if (thread_create_joinable(&th, _frame_worker, nullptr))
+            break;
+        n_frame_workers++;
+    }
+    dprintf("package: %d compression workers\n", n_frame_workers);
+}
+#endif
+
+void package_after_fork()
+{
+#ifdef PACKAGE_THREADS
+    // Whatever the parent's threads were doing, including holding
+    // frame_mutex, didn't come along; never wait for them.
+    n_frame_workers = 0;
+    async_packages.clear();
+#endif
+}
+
+static void _queue_frame(chunk_frame &f)
+{
+#ifdef PACKAGE_THREADS
+    _start_frame_workers();
+    if (n_frame_workers)
+    {
+        mutex_lock(frame_mutex);
+        f.state = FRAME_QUEUED;
+        frame_queue.push_back(&f);
+        cond_wake(frame_queued);
+        mutex_unlock(frame_mutex);
+        return;
+    }
+#endif
+    _encode_frame(f);
+}
+
+static bool _frame_done(chunk_frame &f)
+{
+#ifdef PACKAGE_THREADS
+    if (n_frame_workers)
+    {
+        mutex_lock(frame_mutex);
+        const bool done = f.state == FRAME_DONE;
+        mutex_unlock(frame_mutex);
+        return done;
+    }
+#endif
+    return f.state == FRAME_DONE;
+}
+
+static void _wait_for_frame(chunk_frame &f)
+{
+#ifdef PACKAGE_THREADS
+    if (!n_frame_workers)
+        return;
+
+    mutex_lock(frame_mutex);
+    if (f.state == FRAME_QUEUED)
+    {
+        // Rather than wait for a worker, do it ourselves.
+        for (auto i = frame_queue.begin(); i != frame_queue.end(); ++i)
+            if (*i == &f)
+            {
+                frame_queue.erase(i);
+                break;
+            }
+        f.state = FRAME_WORKING;
+        mutex_unlock(frame_mutex);
+        _encode_frame_safely(f);
+        mutex_lock(frame_mutex);
+        f.state = FRAME_DONE;
+    }
+    while (f.state != FRAME_DONE)
+        cond_wait(frame_done, frame_mutex);
+    mutex_unlock(frame_mutex);
+#else
+    UNUSED(f);
+#endif
+}
+
 chunk_writer::chunk_writer(package *parent, const string &_name)
     : first_block(0), cur_block(0), block_len(0)
 {
@@ -687,18 +1121,11 @@ chunk_writer::chunk_writer(package *parent, const string &_name)
     pkg = parent;
     pkg->n_users++;
     name = _name;
+    codec = pkg->codec;
 
-#ifdef USE_ZLIB
-    zs.data_type = Z_BINARY;
-    zs.zalloc    = 0;
-    zs.zfree     = 0;
-    zs.opaque    = Z_NULL;
-    if (deflateInit(&zs, Z_DEFAULT_COMPRESSION))
-        fail("save file compression failed during init: %s", zs.msg);
-#define ZB_SIZE 32768
-    zs.next_out  = z_buffer = (Bytef*)malloc(ZB_SIZE);
-    zs.avail_out = ZB_SIZE;
-#endif
+    const uint8_t codec_byte = (uint8_t)codec;
+    raw_write(&codec_byte, sizeof(codec_byte));
+    frame.reserve(CHUNK_FRAME_SIZE);
 }
 
 chunk_writer::~chunk_writer()
@@ -709,35 +1136,48 @@ chunk_writer::~chunk_writer()
     pkg->n_users--;
     if (pkg->aborted)
     {
-#ifdef USE_ZLIB
-        // ignore errors, they're not relevant anymore
-        deflateEnd(&zs);
-        free(z_buffer);
-#endif
+        // The workers may still be busy with our frames; ignore the results.
+        for (auto &f : frames)
+            _wait_for_frame(*f);
         return;
     }
 
-#ifdef USE_ZLIB
-    zs.avail_in = 0;
-    int res;
-    do
-    {
-        res = deflate(&zs, Z_FINISH);
-        if (res != Z_STREAM_END && res != Z_OK && res != Z_BUF_ERROR)
-            fail("save file compression failed: %s", zs.msg);
-        raw_write(z_buffer, zs.next_out - z_buffer);
-        zs.next_out = z_buffer;
-        zs.avail_out = ZB_SIZE;
-    } while (res != Z_STREAM_END);
-    if (deflateEnd(&zs) != Z_OK)
-        fail("save file compression failed during clean-up: %s", zs.msg);
-    free(z_buffer);
-#endif
+    if (!frame.empty())
+        flush_frame();
+    write_frames(true);
     if (cur_block)
         finish_block(0);
     pkg->finish_chunk(name, first_block);
 }
 
+void chunk_writer::flush_frame()
+{
+    unique_ptr<chunk_frame> f(new chunk_frame(codec));
+    f->data.swap(frame);
+    frame.reserve(CHUNK_FRAME_SIZE);
+    _queue_frame(*f);
+    frames.push_back(move(f));
+    write_frames(false);
+}
+
+// Write out the frames that are ready, in order. If wait is set, write out
+// all of them.
+void chunk_writer::write_frames(bool wait)
+{
+    while (!frames.empty())
+    {
+        chunk_frame &f = *frames.front();
+        if (wait)
+            _wait_for_frame(f);
+        else if (!_frame_done(f))
+            return;
+        if (f.failed)
+            fail("save file compression failed");
+        raw_write(&f.data[0], f.data.size());
+        frames.pop_front();
+    }
+}
+
 void chunk_writer::raw_write(const void *data, plen_t len)
 {
     while (len > 0)
@@ -782,24 +1222,18 @@ void chunk_writer::write(const void *data, plen_t len)
     ASSERT(data);
     ASSERT(!pkg->aborted);
 
-#ifdef USE_ZLIB
-    zs.next_in  = (Bytef*)data;
-    zs.avail_in = len;
-    while (zs.avail_in)
+    while (len)
     {
-        if (!zs.avail_out)
-        {
-            raw_write(z_buffer, zs.next_out - z_buffer);
-            zs.next_out  = z_buffer;
-            zs.avail_out = ZB_SIZE;
-        }
-        // we don't allow Z_BUF_ERROR, so it's fatal for us
-        if (deflate(&zs, Z_NO_FLUSH) != Z_OK)
-            fail("save file compression failed: %s", zs.msg);
+        plen_t space = CHUNK_FRAME_SIZE - frame.size();
+        if (space > len)
+            space = len;
+        frame.insert(frame.end(), (const char*)data,
+                     (const char*)data + space);
+        data = (const char*)data + space;
+        len -= space;
+        if (frame.size() == CHUNK_FRAME_SIZE)
+            flush_frame();
     }
-#else
-    raw_write(data, len);
-#endif
 }
 
 void chunk_reader::init(plen_t start)
@@ -809,20 +1243,31 @@ void chunk_reader::init(plen_t start)
     pkg->reader_count[start]++;
     first_block = next_block = start;
     block_left = 0;
+    frame_pos = 0;
 
-#ifdef USE_ZLIB
-    if (!start)
-        corrupted("save file corrupted -- zlib header missing");
+    uint8_t codec_byte;
+    if (!start || raw_read(&codec_byte, sizeof(codec_byte)) != 1)
+        corrupted("save file corrupted -- chunk header missing");
 
-    zs.zalloc    = 0;
-    zs.zfree     = 0;
-    zs.opaque    = Z_NULL;
-    zs.next_in   = Z_NULL;
-    zs.avail_in  = 0;
-    if (inflateInit(&zs))
-        fail("save file decompression failed during init: %s", zs.msg);
-    eof = false;
+#ifdef USE_ZLIB
+    legacy = (codec_byte & 0x0f) == Z_DEFLATED;
+    if (legacy)
+    {
+        zs.zalloc    = 0;
+        zs.zfree     = 0;
+        zs.opaque    = Z_NULL;
+        z_buffer[0]  = codec_byte;
+        zs.next_in   = z_buffer;
+        zs.avail_in  = 1;
+        if (inflateInit(&zs))
+            fail("save file decompression failed during init: %s", zs.msg);
+        eof = false;
+        return;
+    }
 #endif
+    if (codec_byte >= (uint8_t)chunk_codec::NUM_CODECS)
+        corrupted("save file corrupted -- unknown compression %u", codec_byte);
+    codec = (chunk_codec)codec_byte;
 }
 
 chunk_reader::chunk_reader(package *parent, plen_t start)
@@ -848,7 +1293,7 @@ chunk_reader::~chunk_reader()
     dprintf("chunk_reader: closing\n");
 
 #ifdef USE_ZLIB
-    if (inflateEnd(&zs) != Z_OK)
+    if (legacy && inflateEnd(&zs) != Z_OK)
         fail("save file decompression failed during clean-up: %s", zs.msg);
 #endif
     ASSERT(pkg->reader_count[first_block] > 0);
@@ -858,41 +1303,37 @@ chunk_reader::~chunk_reader()
     pkg->n_users--;
 }
 
+// Move on to the next block once the current one is used up. Returns false
+// at the end of the chunk.
+bool chunk_reader::next_block_header()
+{
+    if (block_left)
+        return true;
+    if (!next_block)
+        return false;
+
+    block_header bl;
+    if (!pkg->read_at(next_block, &bl, sizeof(block_header)))
+        corrupted("save file corrupted -- block past eof");
+
+    off = next_block + sizeof(block_header);
+    block_left = htole(bl.len);
+    next_block = htole(bl.next);
+    // This reeks of on-disk corruption (zeroed data).
+    if (!block_left)
+        corrupted("save file corrupted -- empty block");
+    return true;
+}
+
 plen_t chunk_reader::raw_read(void *data, plen_t len)
 {
     void *buf = data;
-    while (len)
+    while (len && next_block_header())
     {
-        if (!block_left)
-        {
-            if (!next_block)
-                return (char*)buf - (char*)data;
-
-            block_header bl;
-            pkg->seek(next_block);
-            ssize_t res = ::read(pkg->fd, &bl, sizeof(block_header));
-            if (res < 0)
-                sysfail("error reading the save file");
-            if (res != sizeof(block_header))
-                corrupted("save file corrupted -- block past eof");
-
-            off = next_block + sizeof(block_header);
-            block_left = htole(bl.len);
-            next_block = htole(bl.next);
-            // This reeks of on-disk corruption (zeroed data).
-            if (!block_left)
-                corrupted("save file corrupted -- empty block");
-        }
-        else
-            pkg->seek(off);
-
         plen_t s = len;
         if (s > block_left)
             s = block_left;
-        ssize_t res = ::read(pkg->fd, buf, s);
-        if (res < 0)
-            sysfail("error reading the save file");
-        if ((plen_t)res != s)
+        if (!pkg->read_at(off, buf, s))
             corrupted("save file corrupted -- block past eof");
 
         buf = (char*)buf + s;
@@ -904,12 +1345,112 @@ plen_t chunk_reader::raw_read(void *data, plen_t len)
     return (char*)buf - (char*)data;
 }
 
+// Returns false at the end of the chunk.
+bool chunk_reader::read_frame_header(plen_t &len, plen_t &packed_len)
+{
+    frame_header head;
+    plen_t res = raw_read(&head, sizeof(head));
+    if (!res)
+        return false;
+    if (res != sizeof(head))
+        corrupted("save file corrupted -- frame header truncated");
+
+    len = htole(head.len);
+    packed_len = htole(head.packed_len);
+    if (!len || len > CHUNK_FRAME_SIZE || packed_len > len)
+        corrupted("save file corrupted -- bad frame header");
+    return true;
+}
+
+// Decompress the frame into data, which has room for len bytes.
+void chunk_reader::read_frame(char *data, plen_t len, plen_t packed_len)
+{
+    // Try to use the frame right where it is in the file.
+    const char *src = nullptr;
+    if (packed_len && next_block_header() && block_left >= packed_len)
+        src = pkg->map_range(off, packed_len);
+    if (src)
+    {
+        off += packed_len;
+        block_left -= packed_len;
+    }
+    else
+    {
+        if (packed_len == len)
+        {
+            if (raw_read(data, len) != len)
+                corrupted("save file corrupted -- frame truncated");
+            return;
+        }
+        packed.resize(packed_len);
+        if (packed_len && raw_read(packed.data(), packed_len) != packed_len)
+            corrupted("save file corrupted -- frame truncated");
+        src = packed.data();
+    }
+
+    if (packed_len == len)
+    {
+        memcpy(data, src, len);
+        return;
+    }
+
+    switch (codec)
+    {
+#ifdef USE_ZLIB
+    case chunk_codec::zlib:
+    {
+        uLongf out_len = len;
+        if (uncompress((Bytef*)data, &out_len, (const Bytef*)src,
+                       packed_len) != Z_OK
+            || out_len != len)
+        {
+            corrupted("save file decompression failed");
+        }
+        break;
+    }
+#endif
+    case chunk_codec::lz:
+        if (!lz_decompress(src, packed_len, data, len))
+            corrupted("save file decompression failed");
+        break;
+    default:
+        corrupted("save file corrupted -- unsupported compression");
+    }
+}
+
 plen_t chunk_reader::read(void *data, plen_t len)
 {
     ASSERT(data);
     if (pkg->aborted)
         return 0;
 
+#ifdef USE_ZLIB
+    if (!legacy)
+#endif
+    {
+        char *out = (char*)data;
+        while (len)
+        {
+            if (frame_pos == frame.size())
+            {
+                plen_t frame_len, packed_len;
+                if (!read_frame_header(frame_len, packed_len))
+                    break;
+                frame.resize(frame_len);
+                read_frame(frame.data(), frame_len, packed_len);
+                frame_pos = 0;
+            }
+            plen_t s = frame.size() - frame_pos;
+            if (s > len)
+                s = len;
+            memcpy(out, &frame[frame_pos], s);
+            frame_pos += s;
+            out += s;
+            len -= s;
+        }
+        return out - (char*)data;
+    }
+
 #ifdef USE_ZLIB
     if (!len)
         return 0;
@@ -937,13 +1478,30 @@ plen_t chunk_reader::read(void *data, plen_t len)
             corrupted("save file decompression failed: %s", zs.msg);
     }
     return zs.next_out - (Bytef*)data;
-#else
-    return raw_read(data, len);
 #endif
 }
 
 void chunk_reader::read_all(vector<char> &data)
 {
+#ifdef USE_ZLIB
+    if (!legacy)
+#endif
+    {
+        if (pkg->aborted)
+            return;
+        // Whatever read() left over, then whole frames straight into data.
+        data.insert(data.end(), frame.begin() + frame_pos, frame.end());
+        frame_pos = frame.size();
+        plen_t len, packed_len;
+        while (read_frame_header(len, packed_len))
+        {
+            const size_t at = data.size();
+            data.resize(at + len);
+            read_frame(&data[at], len, packed_len);
+        }
+        return;
+    }
+
 #define SPACE 1024
     plen_t s, at;
     do
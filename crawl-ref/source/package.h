@@ -2,7 +2,9 @@
 
 #define USE_ZLIB
 
+#include <deque>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -11,10 +13,12 @@
 #include <zlib.h>
 #endif
 
+using std::deque;
 using std::map;
 using std::pair;
 using std::set;
 using std::string;
+using std::unique_ptr;
 using std::vector;
 
 #if !defined(DGAMELAUNCH) && !defined(DEBUG_DIAGNOSTICS)
@@ -25,7 +29,28 @@ using std::vector;
 
 typedef uint32_t plen_t;
 
+// How the frames of a chunk are compressed; stored as the chunk's first
+// byte. Chunks written by older versions are instead a single zlib stream,
+// whose first byte always has a low nibble of 8 -- none of these do.
+enum class chunk_codec : uint8_t
+{
+    store,
+    zlib,
+    lz,     // see lzcodec.h
+    NUM_CODECS
+};
+
+#ifndef DEFAULT_CHUNK_CODEC
+#define DEFAULT_CHUNK_CODEC chunk_codec::lz
+#endif
+
+// Chunks are compressed in independent frames of at most this size, so
+// that several can be compressed at once.
+#define CHUNK_FRAME_SIZE 65536
+
 class package;
+struct chunk_frame;
+struct async_commit;
 
 class chunk_writer
 {
@@ -35,12 +60,13 @@ private:
     plen_t first_block;
     plen_t cur_block;
     plen_t block_len;
-#ifdef USE_ZLIB
-    z_stream zs;
-    Bytef *z_buffer;
-#endif
+    chunk_codec codec;
+    vector<char> frame;
+    deque<unique_ptr<chunk_frame>> frames;
     void raw_write(const void *data, plen_t len);
     void finish_block(plen_t next);
+    void flush_frame();
+    void write_frames(bool wait);
 public:
     chunk_writer(package *parent, const string &_name);
     ~chunk_writer();
@@ -56,12 +82,19 @@ private:
     package *pkg;
     plen_t first_block, next_block;
     plen_t off, block_left;
+    chunk_codec codec;
+    vector<char> frame, packed;
+    plen_t frame_pos;
 #ifdef USE_ZLIB
+    bool legacy;
     bool eof;
     z_stream zs;
     Bytef z_buffer[32768];
 #endif
     plen_t raw_read(void *data, plen_t len);
+    bool next_block_header();
+    bool read_frame_header(plen_t &len, plen_t &packed_len);
+    void read_frame(char *data, plen_t len, plen_t packed_len);
 public:
     chunk_reader(package *parent, const string &_name);
     ~chunk_reader();
@@ -78,13 +111,15 @@ public:
     ~package();
     chunk_writer* writer(const string &name);
     chunk_reader* reader(const string &name);
-    void commit();
+    void commit(bool async = false);
+    void finish_commit();
     void delete_chunk(const string &name);
     bool has_chunk(const string &name);
     vector<string> list_chunks();
     void abort();
     void unlink();
     string get_filename() { return filename; }
+    void set_codec(chunk_codec c) { codec = c; }
 
     // statistics
     plen_t get_slack();
@@ -99,15 +134,24 @@ private:
     int n_users;
     bool dirty;
     bool aborted;
+    chunk_codec codec;
+    const char *map_base;
+    plen_t map_len;
+    bool map_failed;
 #ifdef DO_FSYNC
     bool tmp;
 #endif
     map<string, plen_t> directory;
     map<plen_t, plen_t> free_blocks;
     vector<plen_t> unlinked_blocks;
+    vector<plen_t> committing_blocks;
+    unique_ptr<async_commit> pending_commit;
     map<plen_t, pair<plen_t, plen_t> > block_map;
     set<plen_t> new_chunks;
     map<plen_t, uint32_t> reader_count;
+    const char *map_range(plen_t at, plen_t len);
+    void unmap();
+    bool read_at(plen_t at, void *data, plen_t len);
     plen_t extend_block(plen_t at, plen_t size, plen_t by);
     plen_t alloc_block(plen_t &size);
     void finish_chunk(const string &name, plen_t at);
@@ -125,3 +169,9 @@ private:
     friend class chunk_writer;
     friend class chunk_reader;
 };
+
+// To be called in a child process straight after fork(), which leaves it
+// without the compression and commit threads of its parent. Packages the
+// child opens compress their frames in place; it must not use any it shared
+// with the parent.
+void package_after_fork();
@@ -14,6 +14,9 @@
 #endif
 
 #include "pattern.h"
+
+#include <deque>
+
 #include "stringutil.h"
 
 #if defined(REGEX_PCRE)
@@ -229,3 +232,252 @@ pattern_match plaintext_pattern::match_location(const string &s) const
     else
         return pattern_match::failed(s);
 }
+
+// Skip a bracket expression starting at re[i] == '[', returning the index of
+// its closing ']', or the end of re.
+static size_t _skip_bracket(const string &re, size_t i)
+{
+    ++i;
+    // A ']' straight after the '[' or "[^" stands for itself.
+    if (i < re.size() && re[i] == '^')
+        ++i;
+    if (i < re.size() && re[i] == ']')
+        ++i;
+    for (; i < re.size() && re[i] != ']'; ++i)
+    {
+        if (re[i] == '\\')
+            ++i;
+        else if (re[i] == '[' && i + 1 < re.size()
+                 && (re[i + 1] == ':' || re[i + 1] == '.' || re[i + 1] == '='))
+        {
+            // [:alpha:] and friends
+            const size_t end = re.find(string(1, re[i + 1]) + "]", i + 2);
+            if (end == string::npos)
+                return re.size();
+            i = end + 1;
+        }
+    }
+    return i;
+}
+
+/**
+ * Only what is outside all groups, bracket expressions and escapes other
+ * than escaped punctuation counts, and a character followed by a quantifier
+ * that allows zero repeats doesn't. Anything more involved (alternatives at
+ * the top, inline options, unusual escapes) gives up and says there's no
+ * literal, which is always safe: it only means the regex always gets run.
+ * Literals are lowercased and never contain non-ASCII bytes, so matching
+ * them against lowercased text is right for case-insensitive regexes too.
+ */
+string text_pattern_set::required_literal(const string &re)
+{
+    string best, run;
+    auto flush = [&]()
+    {
+        if (run.size() > best.size())
+            best = run;
+        run.clear();
+    };
+
+    for (size_t i = 0; i < re.size(); ++i)
+    {
+        const unsigned char c = re[i];
+        switch (c)
+        {
+        case '|':
+            return "";
+        case ')':
+            return "";
+        case '(':
+        {
+            // (?i) and the like can change how the rest is read.
+            if (i + 2 < re.size() && re[i + 1] == '?' && isaalpha(re[i + 2]))
+                return "";
+            flush();
+            int depth = 1;
+            for (++i; i < re.size() && depth; ++i)
+            {
+                if (re[i] == '\\')
+                    ++i;
+                else if (re[i] == '[')
+                    i = _skip_bracket(re, i);
+                else if (re[i] == '(')
+                    ++depth;
+                else if (re[i] == ')')
+                    --depth;
+            }
+            if (depth)
+                return best;
+            --i;
+            break;
+        }
+        case '[':
+            flush();
+            i = _skip_bracket(re, i);
+            break;
+        case '.':
+        case '^':
+        case '$':
+            flush();
+            break;
+        case '*':
+        case '?':
+            if (!run.empty())
+                run.erase(run.size() - 1);
+            flush();
+            break;
+        case '+':
+            flush();
+            break;
+        case '{':
+        {
+            if (!run.empty())
+                run.erase(run.size() - 1);
+            flush();
+            const size_t end = re.find('}', i);
+            if (end == string::npos)
+                return best;
+            i = end;
+            break;
+        }
+        case '\\':
+        {
+            if (i + 1 >= re.size())
+                return best;
+            const unsigned char e = re[++i];
+            if (!isaalnum(e))
+            {
+                // \< \> \` \' are GNU anchors, not literal characters.
+                if (e >= 0x80 || strchr("<>`'", e))
+                    flush();
+                else
+                    run += e;
+            }
+            else if (strchr("bBdDwWsS", e))
+                flush();
+            else
+            {
+                // Backreferences, \x41, \Q...\E, \p{...}: too much to
+                // follow.
+                flush();
+                return best;
+            }
+            break;
+        }
+        default:
+            if (c >= 0x80)
+                flush();
+            else
+                run += toalower((int) c);
+            break;
+        }
+    }
+    flush();
+    return best;
+}
+
+void text_pattern_set::clear()
+{
+    nodes.clear();
+    nodes.emplace_back();
+    nodes[0].fail = 0;
+    nodes[0].dict = -1;
+    always.clear();
+    found.clear();
+    built = true;
+}
+
+int text_pattern_set::child(int node, unsigned char c) const
+{
+    for (const auto &edge : nodes[node].next)
+        if (edge.first == c)
+            return edge.second;
+    return -1;
+}
+
+void text_pattern_set::add(const string &regex)
+{
+    const int index = always.size();
+    const string literal = required_literal(regex);
+    always.push_back(literal.empty());
+    found.push_back(false);
+    if (literal.empty())
+        return;
+
+    int node = 0;
+    for (const unsigned char c : literal)
+    {
+        int next = child(node, c);
+        if (next < 0)
+        {
+            next = nodes.size();
+            nodes.emplace_back();
+            nodes[node].next.emplace_back(c, next);
+        }
+        node = next;
+    }
+    nodes[node].outputs.push_back(index);
+    built = false;
+}
+
+// Work out the failure and dictionary links, breadth first.
+void text_pattern_set::build() const
+{
+    deque<int> todo;
+    for (const auto &edge : nodes[0].next)
+    {
+        nodes[edge.second].fail = 0;
+        nodes[edge.second].dict = -1;
+        todo.push_back(edge.second);
+    }
+    while (!todo.empty())
+    {
+        const int node = todo.front();
+        todo.pop_front();
+        for (const auto &edge : nodes[node].next)
+        {
+            int fail = nodes[node].fail;
+            int target;
+            while ((target = child(fail, edge.first)) < 0 && fail)
+                fail = nodes[fail].fail;
+            if (target < 0)
+                target = 0;
+            ac_node &next = nodes[edge.second];
+            next.fail = target;
+            next.dict = nodes[target].outputs.empty() ? nodes[target].dict
+                                                      : target;
+            todo.push_back(edge.second);
+        }
+    }
+    built = true;
+}
+
+int text_pattern_set::find(const string &s,
+                           const function<bool(size_t)> &check) const
+{
+    if (!built)
+        build();
+
+    fill(found.begin(), found.end(), false);
+    int node = 0;
+    for (const char ch : s)
+    {
+        const unsigned char c = toalower((int) (unsigned char) ch);
+        int next;
+        while ((next = child(node, c)) < 0 && node)
+            node = nodes[node].fail;
+        node = max(next, 0);
+
+        for (int out = nodes[node].outputs.empty() ? nodes[node].dict : node;
+             out >= 0; out = nodes[out].dict)
+        {
+            for (int index : nodes[out].outputs)
+                found[index] = true;
+        }
+    }
+
+    for (size_t i = 0; i < always.size(); ++i)
+        if ((always[i] || found[i]) && check(i))
+            return i;
+    return -1;
+}
@@ -1,5 +1,13 @@
 #pragma once
 
+#include <functional>
+#include <string>
+#include <vector>
+
+using std::function;
+using std::string;
+using std::vector;
+
 class pattern_match
 {
 public:
@@ -154,3 +162,52 @@ private:
     string pattern;
     bool ignore_case;
 };
+
+/**
+ * Finds which of many regexes match a string without running them all.
+ *
+ * For each regex, a literal that every match of it has to contain is worked
+ * out where that's possible, and all those literals are looked for at once
+ * with a single Aho-Corasick automaton. Only the regexes whose literal turned
+ * up, and those without one, are left to be run.
+ */
+class text_pattern_set
+{
+public:
+    text_pattern_set() { clear(); }
+
+    void clear();
+    // Add a regex; its index is the number of regexes added before it.
+    void add(const string &regex);
+    size_t size() const { return always.size(); }
+
+    /**
+     * Of the regexes that might match s, find the first (in the order they
+     * were added) for which check() is true. check() is given an index, and
+     * should decide with the regex itself.
+     *
+     * @return the index of the regex, or -1 if there is none.
+     */
+    int find(const string &s, const function<bool(size_t)> &check) const;
+
+    // A (lowercase) literal that any text matching regex has to contain,
+    // or "" if none could be found.
+    static string required_literal(const string &regex);
+
+private:
+    struct ac_node
+    {
+        vector<pair<unsigned char, int>> next;
+        int fail;
+        int dict;            // the nearest node along fail links with outputs
+        vector<int> outputs; // the regexes whose literal ends here
+    };
+
+    int child(int node, unsigned char c) const;
+    void build() const;
+
+    mutable vector<ac_node> nodes;
+    mutable bool built;
+    vector<bool> always;
+    mutable vector<bool> found;
+};
@@ -45,6 +45,7 @@
 #include "hints.h"
 #include "hiscores.h"
 #include "invent.h"
+#include "item-name.h"
 #include "item-prop.h"
 #include "items.h"
 #include "item-use.h"
@@ -2210,6 +2211,7 @@ void forget_map(bool rot)
     }
 
     ash_detect_portals(is_map_persistent());
+    invalidate_travel_safety();
 #ifdef USE_TILE
     tiles.update_minimap_bounds();
 #endif
@@ -5306,6 +5308,7 @@ player::player()
     dactions.clear();
     level_stack.clear();
     type_ids.init(false);
+    invalidate_item_names();
 
     banished_by.clear();
     banished_power = 0;
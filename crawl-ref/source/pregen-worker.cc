@@ -0,0 +1,419 @@
+/**
+ * @file
+ * @brief Building the next levels of a seeded game in another process.
+ *
+ * With incremental pregeneration, which levels get built and how only
+ * depends on the game seed and on a small part of the player state, so the
+ * level below can be built ahead of time in a forked copy of the game while
+ * the player is still on this one. The copy writes its levels, and the state
+ * that building them changed, to a package of its own; when the levels are
+ * needed they are taken from it if that state hasn't been changed here in the
+ * meantime, and built again as usual if it has.
+**/
+
+#include "AppHdr.h"
+
+#include "pregen-worker.h"
+
+#include <memory>
+#include <set>
+
+#ifdef UNIX
+#include <csignal>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "errors.h"
+#include "files.h"
+#include "message.h"
+#include "options.h"
+#include "package.h"
+#include "player.h"
+#include "state.h"
+#include "store.h"
+#include "syscalls.h"
+#include "tag-version.h"
+#include "tags.h"
+#include "ui.h"
+#include "unwind.h"
+
+// A webtiles game shares its socket and message ring with any child, so it
+// doesn't get one.
+#if defined(UNIX) && !defined(USE_TILE_WEB)
+#define BACKGROUND_PREGEN
+#endif
+
+#ifdef BACKGROUND_PREGEN
+
+// The chunk a worker leaves everything but its levels in.
+#define RESULT_CHUNK "pregen"
+
+// How many monster ids a worker may use. They are set aside in this process
+// before the worker starts, so that monsters made here in the meantime can't
+// get the same ones.
+#define PREGEN_MID_BLOCK 0x10000
+
+struct pregen_worker
+{
+    pid_t pid;
+    string path;
+    vector<level_id> levels;
+    // What building levels depended on when the worker was started. Its
+    // levels are only used if this is still the same.
+    vector<unsigned char> levelgen_state;
+    CrawlHashTable props;
+    // The first of the worker's block of monster ids.
+    mid_t first_mid;
+    // The chunks the save had then.
+    set<string> chunks;
+    bool finished;
+    bool succeeded;
+};
+
+static unique_ptr<pregen_worker> worker;
+// How many times a worker's levels have been taken.
+static int workers_taken = 0;
+
+static vector<unsigned char> _levelgen_state()
+{
+    vector<unsigned char> buf;
+    writer th(&buf);
+    tag_write_levelgen_state(th);
+    return buf;
+}
+
+// A single prop, or its absence, as bytes that can be compared.
+static vector<unsigned char> _prop_bytes(const CrawlHashTable &props,
+                                         const string &key)
+{
+    CrawlHashTable one;
+    if (props.exists(key))
+        one[key] = props[key];
+    vector<unsigned char> buf;
+    writer th(&buf);
+    one.write(th);
+    return buf;
+}
+
+static bool _build_levels(const pregen_worker &w)
+{
+    // Empty stand-ins for the chunks of the real save, so that the builder
+    // sees the same levels as already existing.
+    package *side = new package(w.path.c_str(), true, true);
+    side->set_codec(chunk_codec::store);
+    for (const string &chunk : w.chunks)
+        delete side->writer(chunk);
+    // The real save is never touched from here, not even to close it.
+    you.save = side;
+
+    for (const level_id &lid : w.levels)
+        if (!generate_level(lid) && !you.save->has_chunk(lid.describe()))
+            return false;
+
+    // Monsters past the end of our block could share ids with the game's.
+    if (you.last_mid - w.first_mid > PREGEN_MID_BLOCK)
+        return false;
+
+    CrawlHashTable changed;
+    vector<string> removed;
+    for (const auto &entry : you.props)
+        if (_prop_bytes(you.props, entry.first)
+            != _prop_bytes(w.props, entry.first))
+        {
+            changed[entry.first] = entry.second;
+        }
+    for (const auto &entry : w.props)
+        if (!you.props.exists(entry.first))
+            removed.push_back(entry.first);
+
+    {
+        writer th(you.save, RESULT_CHUNK);
+        changed.write(th);
+        marshallInt(th, removed.size());
+        for (const string &key : removed)
+            marshallString(th, key);
+        tag_write_levelgen_state(th);
+    }
+    you.save->commit(false);
+    return true;
+}
+
+static void NORETURN _run_worker(const pregen_worker &w)
+{
+    package_after_fork();
+
+    // Keep off the terminal, and out of the way of the game itself.
+    const int null_fd = open("/dev/null", O_RDWR);
+    if (null_fd >= 0)
+    {
+        dup2(null_fd, STDIN_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+    }
+    signal(SIGHUP, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    setpriority(PRIO_PROCESS, 0, 10);
+
+    crawl_state.need_save = false;
+    msg::suppress quiet;
+    // as in pregen_dungeon()
+    unwind_var<game_chapter> chapter(you.chapter, CHAPTER_ORB_HUNTING);
+
+    bool ok = false;
+    try
+    {
+        ok = _build_levels(w);
+    }
+    catch (...)
+    {
+    }
+    _exit(ok ? 0 : 1);
+}
+
+static bool _worker_finished(bool block)
+{
+    while (!worker->finished)
+    {
+        int status;
+        const pid_t pid = waitpid(worker->pid, &status, block ? 0 : WNOHANG);
+        if (!pid)
+            return false;
+        if (pid < 0 && errno == EINTR)
+            continue;
+        worker->finished = true;
+        worker->succeeded = pid == worker->pid && WIFEXITED(status)
+                            && !WEXITSTATUS(status);
+    }
+    return true;
+}
+
+static bool _import_levels()
+{
+    if (!worker->succeeded)
+        return false;
+    if (_levelgen_state() != worker->levelgen_state)
+    {
+        dprf("levelgen: background levels are stale");
+        return false;
+    }
+
+    CrawlHashTable changed;
+    vector<string> removed;
+    vector<pair<string, vector<char>>> chunks;
+    try
+    {
+        package side(worker->path.c_str(), false);
+        reader th(&side, RESULT_CHUNK, TAG_MINOR_VERSION);
+        changed.read(th);
+        for (int i = unmarshallInt(th); i > 0; --i)
+            removed.push_back(unmarshallString(th));
+
+        // The worker's changes to props stand only if we haven't made any of
+        // our own to the same ones.
+        for (const auto &entry : changed)
+            if (_prop_bytes(you.props, entry.first)
+                != _prop_bytes(worker->props, entry.first))
+            {
+                dprf("levelgen: background levels are stale (%s)",
+                     entry.first.c_str());
+                return false;
+            }
+        for (const string &key : removed)
+            if (_prop_bytes(you.props, key) != _prop_bytes(worker->props, key))
+            {
+                dprf("levelgen: background levels are stale (%s)",
+                     key.c_str());
+                return false;
+            }
+
+        for (const string &name : side.list_chunks())
+        {
+            if (name == RESULT_CHUNK || worker->chunks.count(name))
+                continue;
+            chunks.emplace_back(name, vector<char>());
+            chunk_reader inf(&side, name);
+            inf.read_all(chunks.back().second);
+        }
+
+        tag_read_levelgen_state(th);
+    }
+    catch (ext_fail_exception &fe)
+    {
+        mprf(MSGCH_ERROR, "Couldn't use the levels built in the background: %s",
+             fe.what());
+        return false;
+    }
+
+    for (const auto &entry : changed)
+        you.props[entry.first] = entry.second;
+    for (const string &key : removed)
+        you.props.erase(key);
+
+    for (const auto &chunk : chunks)
+    {
+        dprf("levelgen: using background level %s", chunk.first.c_str());
+        chunk_writer *outf = you.save->writer(chunk.first);
+        outf->write(chunk.second.data(), chunk.second.size());
+        delete outf;
+    }
+    return true;
+}
+
+/**
+ * Start building the levels that the player is likely to need next, if
+ * nothing is building them already.
+ */
+void start_background_pregen()
+{
+    if (!Options.pregen_in_background || crawl_state.test
+        || crawl_state.script || !crawl_state.game_has_random_floors())
+    {
+        return;
+    }
+
+    const vector<level_id> levels = upcoming_pregen_levels();
+    if (worker && worker->levels == levels
+        && _levelgen_state() == worker->levelgen_state)
+    {
+        return;
+    }
+    stop_background_pregen();
+    if (levels.empty())
+        return;
+
+    unique_ptr<pregen_worker> w(new pregen_worker);
+    w->path = you.save->get_filename() + ".pregen";
+    w->levels = levels;
+    w->levelgen_state = _levelgen_state();
+    w->props = you.props;
+    w->first_mid = you.last_mid;
+    for (const string &chunk : you.save->list_chunks())
+        w->chunks.insert(chunk);
+    w->finished = false;
+    w->succeeded = false;
+
+    const pid_t pid = fork();
+    if (pid < 0)
+        return;
+    if (!pid)
+        _run_worker(*w);
+    // The worker numbers its monsters on from first_mid; we skip its block.
+    you.last_mid += PREGEN_MID_BLOCK;
+
+    dprf("levelgen: building %s and %u more in the background",
+         levels[0].describe().c_str(), (unsigned int) levels.size() - 1);
+    w->pid = pid;
+    worker = move(w);
+}
+
+/**
+ * Take whatever levels the background worker has built, if they are the
+ * first of `needed`, the levels pregen_dungeon() is about to build. Waits for
+ * the worker if it is still going and isn't building more than is needed.
+ *
+ * @return whether any levels were taken.
+ */
+bool collect_background_pregen(const vector<level_id> &needed)
+{
+    if (!worker || needed.empty())
+        return false;
+
+    const size_t common = min(needed.size(), worker->levels.size());
+    if (!equal(needed.begin(), needed.begin() + common,
+               worker->levels.begin()))
+    {
+        stop_background_pregen();
+        return false;
+    }
+
+    if (!_worker_finished(false))
+    {
+        if (worker->levels.size() > needed.size())
+        {
+            stop_background_pregen();
+            return false;
+        }
+
+        ui::progress_popup progress("Generating dungeon...\n\n", 35);
+        while (!_worker_finished(false))
+        {
+            if (crawl_state.seen_hups)
+            {
+                stop_background_pregen();
+                return false;
+            }
+            progress.advance_progress();
+            ui::delay(50);
+        }
+    }
+
+    const bool imported = _import_levels();
+    if (imported)
+        workers_taken++;
+    stop_background_pregen();
+    return imported;
+}
+
+/**
+ * Stop the background worker, if any, and throw away what it has built.
+ */
+void stop_background_pregen()
+{
+    if (!worker)
+        return;
+
+    if (!worker->finished)
+    {
+        kill(worker->pid, SIGKILL);
+        _worker_finished(true);
+    }
+    unlink_u(worker->path.c_str());
+    worker.reset();
+}
+
+/**
+ * Is a background worker building levels, or holding levels it has built?
+ */
+bool background_pregen_running()
+{
+    return bool(worker);
+}
+
+/**
+ * How many times collect_background_pregen() has taken a worker's levels.
+ * For tests, which can't otherwise tell them from levels built as usual.
+ */
+int background_pregen_taken()
+{
+    return workers_taken;
+}
+
+#else
+
+void start_background_pregen()
+{
+}
+
+bool collect_background_pregen(const vector<level_id> &)
+{
+    return false;
+}
+
+void stop_background_pregen()
+{
+}
+
+bool background_pregen_running()
+{
+    return false;
+}
+
+int background_pregen_taken()
+{
+    return 0;
+}
+
+#endif
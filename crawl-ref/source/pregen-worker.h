@@ -0,0 +1,18 @@
+/**
+ * @file
+ * @brief Building the next levels of a seeded game in another process.
+**/
+
+#pragma once
+
+#include <vector>
+
+#include "level-id.h"
+
+using std::vector;
+
+void start_background_pregen();
+bool collect_background_pregen(const vector<level_id> &needed);
+void stop_background_pregen();
+bool background_pregen_running();
+int background_pregen_taken();
@@ -7,6 +7,7 @@
 
 #include "shout.h"
 
+#include <memory>
 #include <sstream>
 
 #include "act-iter.h"
@@ -38,7 +39,10 @@
 #include "view.h"
 #include "viewchar.h"
 
-static noise_grid _noise_grid;
+// The grid collecting noises for the next apply_noises(), and reset grids
+// to swap in for it.
+static unique_ptr<noise_grid> _noise_grid(new noise_grid);
+static vector<unique_ptr<noise_grid>> _spare_noise_grids;
 static void _actor_apply_noise(actor *act,
                                const coord_def &apparent_source,
                                int noise_intensity_millis);
@@ -803,17 +807,25 @@ void yell(const actor* mon)
 
 void apply_noises()
 {
-    // [ds] This copying isn't awesome, but we cannot otherwise handle
-    // the case where one set of noises wakes up monsters who then let
-    // out yips of their own, modifying _noise_grid while it is in the
-    // middle of propagate_noise().
-    if (_noise_grid.dirty())
+    // [ds] One set of noises can wake up monsters who then let out yips
+    // of their own, so new noises have to go to another grid while this
+    // one is in the middle of propagate_noise(). Spare grids are kept
+    // rather than copying the whole grid every time.
+    if (!_noise_grid->dirty())
+        return;
+
+    unique_ptr<noise_grid> grid = move(_noise_grid);
+    if (_spare_noise_grids.empty())
+        _noise_grid.reset(new noise_grid);
+    else
     {
-        noise_grid copy = _noise_grid;
-        // Reset the main grid.
-        _noise_grid.reset();
-        copy.propagate_noise();
+        _noise_grid = move(_spare_noise_grids.back());
+        _spare_noise_grids.pop_back();
     }
+
+    grid->propagate_noise();
+    grid->reset();
+    _spare_noise_grids.push_back(move(grid));
 }
 
 // noisy() has a messaging service for giving messages to the player
@@ -864,7 +876,7 @@ bool noisy(int original_loudness, const coord_def& where,
     // Add +1 to scaled_loudness so that all squares adjacent to a
     // sound of loudness 1 will hear the sound.
     const string noise_msg(msg ? msg : "");
-    _noise_grid.register_noise(
+    _noise_grid->register_noise(
         noise_t(where, noise_msg, (scaled_loudness + 1) * multiplier, who,
                 fake_noise));
 
@@ -919,7 +931,7 @@ static int _noise_attenuation_millis(const coord_def &pos)
 
 noise_cell::noise_cell()
     : neighbour_delta(0, 0), noise_id(-1), noise_intensity_millis(0),
-      noise_travel_distance(0)
+      noise_travel_distance(0), generation(0)
 {
 }
 
@@ -962,29 +974,53 @@ int noise_cell::turn_angle(const coord_def &next_delta) const
 }
 
 noise_grid::noise_grid()
-    : cells(), noises(), affected_actor_count(0)
+    : cells(), generation(1), noises(), affected_actor_count(0)
 {
 }
 
 void noise_grid::reset()
 {
-    cells.init(noise_cell());
+    // Forget every cell at once by moving to a new generation. Only on the
+    // rare wrap-around do the old stamps have to be cleared.
+    if (!++generation)
+    {
+        cells.init(noise_cell());
+        generation = 1;
+    }
     noises.clear();
     affected_actor_count = 0;
 }
 
+noise_cell &noise_grid::cell_at(const coord_def &p)
+{
+    noise_cell &cell(cells(p));
+    if (cell.generation != generation)
+    {
+        cell = noise_cell();
+        cell.generation = generation;
+    }
+    return cell;
+}
+
+const noise_cell &noise_grid::cell_at(const coord_def &p) const
+{
+    static const noise_cell silence;
+    const noise_cell &cell(cells(p));
+    return cell.generation == generation ? cell : silence;
+}
+
 void noise_grid::register_noise(const noise_t &noise)
 {
-    noise_cell &target_cell(cells(noise.noise_source));
+    noise_cell &target_cell(cell_at(noise.noise_source));
     if (target_cell.can_apply_noise(noise.noise_intensity_millis))
     {
         const int noise_index = noises.size();
         noises.push_back(noise);
         noises[noise_index].noise_id = noise_index;
-        cells(noise.noise_source).apply_noise(noise.noise_intensity_millis,
-                                              noise_index,
-                                              0,
-                                              coord_def(0, 0));
+        target_cell.apply_noise(noise.noise_intensity_millis,
+                                noise_index,
+                                0,
+                                coord_def(0, 0));
     }
 }
 
@@ -997,7 +1033,8 @@ void noise_grid::propagate_noise()
     dprf(DIAG_NOISE, "noise_grid: %u noises to apply",
          (unsigned int)noises.size());
 #endif
-    vector<coord_def> noise_perimeter[2];
+    noise_perimeter[0].clear();
+    noise_perimeter[1].clear();
     int circ_index = 0;
 
     for (const noise_t &noise : noises)
@@ -1011,7 +1048,7 @@ void noise_grid::propagate_noise()
         ++travel_distance;
         for (const coord_def &p : perimeter)
         {
-            const noise_cell &cell(cells(p));
+            const noise_cell &cell(cell_at(p));
 
             if (!cell.silent())
             {
@@ -1071,7 +1108,7 @@ bool noise_grid::propagate_noise_to_neighbour(int base_attenuation,
                                               const coord_def &current_pos,
                                               const coord_def &next_pos)
 {
-    noise_cell &neighbour(cells(next_pos));
+    noise_cell &neighbour(cell_at(next_pos));
     if (!neighbour.can_apply_noise(cell.noise_intensity_millis
                                    - base_attenuation))
     {
@@ -1174,7 +1211,8 @@ coord_def noise_grid::noise_perceived_position(actor *act,
                                                const coord_def &affected_pos,
                                                const noise_t &noise) const
 {
-    const int noise_travel_distance = cells(affected_pos).noise_travel_distance;
+    const int noise_travel_distance =
+        cell_at(affected_pos).noise_travel_distance;
     if (!noise_travel_distance)
         return noise.noise_source;
 
@@ -1287,7 +1325,7 @@ static void _write_noise_grid_css(FILE *outf)
 
 void noise_grid::write_cell(FILE *outf, coord_def p, int ch) const
 {
-    const int intensity = min(25, cells(p).noise_intensity_millis / 1000);
+    const int intensity = min(25, cell_at(p).noise_intensity_millis / 1000);
     if (intensity)
         fprintf(outf, "<span class='i%d'>&#%d;</span>", intensity, ch);
     else
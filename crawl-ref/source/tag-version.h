@@ -317,6 +317,7 @@ enum tag_minor_version
     TAG_MINOR_EQUIP_SLOT_REWRITE,  // Convert all player equipment handling over to a new system
     TAG_MINOR_REMOVE_STAT_DRAIN,   // Remove all stat draining
     TAG_MINOR_SIMPLIFY_STAT_ZERO,  // Simplify stat-zero to permaslow with no duration
+    TAG_MINOR_BULK_GRIDS,          // Marshall level features and properties as whole grids
 #endif
     NUM_TAG_MINORS,
     TAG_MINOR_VERSION = NUM_TAG_MINORS - 1
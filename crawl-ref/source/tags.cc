@@ -117,25 +117,26 @@ extern set<pair<string, level_id> > auto_unique_annotations;
 extern abyss_state abyssal_state;
 
 reader::reader(const string &_read_filename, int minorVersion)
-    : _filename(_read_filename), _chunk(0), _pbuf(nullptr), _read_offset(0),
-      _minorVersion(minorVersion), _safe_read(false)
+    : _filename(_read_filename), _data(nullptr), _data_len(0),
+      _read_offset(0), _minorVersion(minorVersion), _safe_read(false)
 {
     _file       = fopen_u(_filename.c_str(), "rb");
     opened_file = !!_file;
 }
 
 reader::reader(package *save, const string &chunkname, int minorVersion)
-    : _file(0), _chunk(0), opened_file(false), _pbuf(0), _read_offset(0),
+    : _file(0), opened_file(false), _read_offset(0),
      _minorVersion(minorVersion), _safe_read(false)
 {
     ASSERT(save);
-    _chunk = new chunk_reader(save, chunkname);
+    chunk_reader inf(save, chunkname);
+    inf.read_all(_chunk_data);
+    _data = (const unsigned char*)_chunk_data.data();
+    _data_len = _chunk_data.size();
 }
 
 reader::~reader()
 {
-    if (_chunk)
-        delete _chunk;
     close();
 }
 
@@ -161,7 +162,7 @@ void reader::advance(size_t offset)
 bool reader::valid() const
 {
     return (_file && !feof(_file)) ||
-           (_pbuf && _read_offset < _pbuf->size());
+           (!_file && _read_offset < _data_len);
 }
 
 static NORETURN void _short_read(bool safe_read)
@@ -173,8 +174,9 @@ static NORETURN void _short_read(bool safe_read)
     die_noline("short read while reading save");
 }
 
-// Reads input in network byte order, from a file or buffer.
-unsigned char reader::readByte()
+// Reads input in network byte order, from a file, or past the end of a
+// buffer. In-memory reads are handled inline by readByte() and read().
+unsigned char reader::read_byte_slow()
 {
     if (_file)
     {
@@ -183,47 +185,33 @@ unsigned char reader::readByte()
             _short_read(_safe_read);
         return b;
     }
-    else if (_chunk)
+    _short_read(_safe_read);
+}
+
+void reader::read_slow(void *data, size_t size)
+{
+    if (!_file)
+        _short_read(_safe_read);
+
+    if (data)
     {
-        unsigned char buf;
-        if (_chunk->read(&buf, 1) != 1)
+        if (fread(data, 1, size, _file) != size)
             _short_read(_safe_read);
-        return buf;
     }
     else
-    {
-        if (_read_offset >= _pbuf->size())
-            _short_read(_safe_read);
-        return (*_pbuf)[_read_offset++];
-    }
+        fseek(_file, (long)size, SEEK_CUR);
 }
 
-void reader::read(void *data, size_t size)
+const unsigned char *reader::read_span(size_t size)
 {
     if (_file)
-    {
-        if (data)
-        {
-            if (fread(data, 1, size, _file) != size)
-                _short_read(_safe_read);
-        }
-        else
-            fseek(_file, (long)size, SEEK_CUR);
-    }
-    else if (_chunk)
-    {
-        if (_chunk->read(data, size) != size)
-            _short_read(_safe_read);
-    }
-    else
-    {
-        if (_read_offset+size > _pbuf->size())
-            _short_read(_safe_read);
-        if (data && size)
-            memcpy(data, &(*_pbuf)[_read_offset], size);
+        return nullptr;
+    if (size > _data_len - _read_offset)
+        _short_read(_safe_read);
 
-        _read_offset += size;
-    }
+    const unsigned char *span = _data + _read_offset;
+    _read_offset += size;
+    return span;
 }
 
 int reader::getMinorVersion() const
@@ -239,10 +227,7 @@ void reader::setMinorVersion(int minorVersion)
 
 void reader::fail_if_not_eof(const string &name)
 {
-    char dummy;
-    if (_chunk ? _chunk->read(&dummy, 1) :
-        _file ? (fgetc(_file) != EOF) :
-        _read_offset >= _pbuf->size())
+    if (_file ? (fgetc(_file) != EOF) : _read_offset < _data_len)
     {
         fail("Incomplete read of \"%s\" - aborting.", name.c_str());
     }
@@ -258,33 +243,17 @@ void writer::check_ok(bool ok)
     }
 }
 
-void writer::writeByte(unsigned char ch)
-{
-    if (failed)
-        return;
-
-    if (_chunk)
-        _chunk->write(&ch, 1);
-    else if (_file)
-        check_ok(fputc(ch, _file) != EOF);
-    else
-        _pbuf->push_back(ch);
-}
-
-void writer::write(const void *data, size_t size)
+// Writes to a chunk or file. Writes to memory are handled inline by
+// writeByte() and write().
+void writer::write_out(const void *data, size_t size)
 {
     if (failed)
         return;
 
     if (_chunk)
         _chunk->write(data, size);
-    else if (_file)
-        check_ok(fwrite(data, 1, size, _file) == size);
     else
-    {
-        const unsigned char* cdata = static_cast<const unsigned char*>(data);
-        _pbuf->insert(_pbuf->end(), cdata, cdata+size);
-    }
+        check_ok(fwrite(data, 1, size, _file) == size);
 }
 
 long writer::tell()
@@ -391,9 +360,9 @@ void marshallShort(writer &th, short data)
 // Unmarshall 2 byte short in network order.
 int16_t unmarshallShort(reader &th)
 {
-    int16_t b1 = th.readByte();
-    int16_t b2 = th.readByte();
-    int16_t data = (b1 << 8) | (b2 & 0x00FF);
+    unsigned char b[2];
+    th.read(b, sizeof(b));
+    int16_t data = (b[0] << 8) | b[1];
     return data;
 }
 
@@ -415,14 +384,10 @@ void marshallInt(writer &th, int32_t data)
 // Unmarshall 4 byte signed int in network order.
 int32_t unmarshallInt(reader &th)
 {
-    int32_t b1 = th.readByte();
-    int32_t b2 = th.readByte();
-    int32_t b3 = th.readByte();
-    int32_t b4 = th.readByte();
-
-    int32_t data = (b1 << 24) | ((b2 & 0x000000FF) << 16);
-    data |= ((b3 & 0x000000FF) << 8) | (b4 & 0x000000FF);
-    return data;
+    unsigned char b[4];
+    th.read(b, sizeof(b));
+    return (int32_t)((uint32_t)b[0] << 24 | (uint32_t)b[1] << 16
+                     | (uint32_t)b[2] << 8 | (uint32_t)b[3]);
 }
 
 void marshallUnsigned(writer& th, uint64_t v)
@@ -1286,6 +1251,102 @@ void tag_write(tag_type tagID, writer &outf)
     outf.write(&buf[0], buf.size());
 }
 
+void tag_write_level_grids(vector<unsigned char> &buf)
+{
+    buf.clear();
+    writer th(&buf);
+    _tag_construct_level(th);
+}
+
+void tag_read_level_grids(const vector<unsigned char> &buf)
+{
+    reader th(buf, TAG_MINOR_VERSION);
+    _tag_read_level(th);
+}
+
+// The player state that building levels reads and changes, other than
+// you.props. Only read back by the process that wrote it or one forked from
+// it, so it isn't versioned. Of the generators, only the level generation
+// ones are written: the others move on with every turn played, and two
+// states written on either side of some turns must still compare equal.
+void tag_write_levelgen_state(writer &th)
+{
+    const CrawlVector rng_states = rng::generators_to_vector();
+    CrawlVector levelgen_states;
+    for (int i = rng::LEVELGEN; i < rng::NUM_RNGS; ++i)
+        levelgen_states.push_back(rng_states[i]);
+    levelgen_states.write(th);
+
+    for (int j = 0; j < NUM_MONSTERS; ++j)
+        marshallBoolean(th, you.unique_creatures[j]);
+    for (int j = 0; j < NUM_UNRANDARTS; ++j)
+        marshallByte(th, you.unique_items[j]);
+    for (int j = 0; j < NUM_BRANCHES; ++j)
+        marshall_level_id(th, brentry[j]);
+
+    _marshall_iterator(th, you.uniq_map_tags.begin(), you.uniq_map_tags.end(),
+                       marshallString);
+    _marshall_iterator(th, you.uniq_map_names.begin(), you.uniq_map_names.end(),
+                       marshallString);
+    _marshall_iterator(th, you.uniq_map_tags_abyss.begin(),
+                       you.uniq_map_tags_abyss.end(), marshallString);
+    _marshall_iterator(th, you.uniq_map_names_abyss.begin(),
+                       you.uniq_map_names_abyss.end(), marshallString);
+    marshallMap(th, you.vault_list, marshall_level_id, marshallStringVector);
+
+    if (!dlua.callfn("dgn_save_data", "u", &th))
+        mprf(MSGCH_ERROR, "Failed to save Lua data: %s", dlua.error.c_str());
+}
+
+void tag_read_levelgen_state(reader &th)
+{
+    // Only the level generation streams were written; the others carry on
+    // as they were in this process.
+    CrawlVector written;
+    written.read(th);
+    CrawlVector rng_states = rng::generators_to_vector();
+    for (int i = rng::LEVELGEN; i < rng::NUM_RNGS; ++i)
+        rng_states[i] = written[i - rng::LEVELGEN];
+    rng::load_generators(rng_states);
+
+    for (int j = 0; j < NUM_MONSTERS; ++j)
+        you.unique_creatures.set(j, unmarshallBoolean(th));
+    for (int j = 0; j < NUM_UNRANDARTS; ++j)
+    {
+        you.unique_items[j] =
+            static_cast<unique_item_status_type>(unmarshallByte(th));
+    }
+    for (int j = 0; j < NUM_BRANCHES; ++j)
+        brentry[j] = unmarshall_level_id(th);
+
+    typedef pair<string_set::iterator, bool> ssipair;
+    unmarshall_container(th, you.uniq_map_tags,
+                         (ssipair (string_set::*)(const string &))
+                         &string_set::insert,
+                         unmarshallString);
+    unmarshall_container(th, you.uniq_map_names,
+                         (ssipair (string_set::*)(const string &))
+                         &string_set::insert,
+                         unmarshallString);
+    unmarshall_container(th, you.uniq_map_tags_abyss,
+                         (ssipair (string_set::*)(const string &))
+                         &string_set::insert,
+                         unmarshallString);
+    unmarshall_container(th, you.uniq_map_names_abyss,
+                         (ssipair (string_set::*)(const string &))
+                         &string_set::insert,
+                         unmarshallString);
+    you.vault_list.clear();
+    unmarshallMap(th, you.vault_list, unmarshall_level_id,
+                  unmarshallStringVector);
+
+    if (!dlua.callfn("dgn_load_data", "u", &th))
+    {
+        mprf(MSGCH_ERROR, "Failed to load Lua persist table: %s",
+             dlua.error.c_str());
+    }
+}
+
 static void _shunt_monsters_out_of_walls()
 {
     for (int i = 0; i < MAX_MONSTERS; ++i)
@@ -1308,6 +1369,7 @@ static void _shunt_monsters_out_of_walls()
                          m.pos().x, m.pos().y);
                     env.mgrid(m.pos()) = NON_MONSTER;
                     m.position = *di;
+                    monster_index_moved(m);
                     env.mgrid(*di) = i;
                     break;
                 }
@@ -1325,12 +1387,18 @@ void tag_read(reader &inf, tag_type tag_id)
     const int data_size = unmarshallInt(inf);
     ASSERT(data_size >= 0);
 
-    // Fetch data in one go
-    buf.resize(data_size);
-    inf.read(&buf[0], buf.size());
+    // Use the data in place if inf holds it in memory, otherwise fetch it
+    // in one go.
+    const unsigned char *data = inf.read_span(data_size);
+    if (!data)
+    {
+        buf.resize(data_size);
+        inf.read(buf.data(), buf.size());
+        data = buf.data();
+    }
 
     // Ok, we have data now.
-    reader th(buf, inf.getMinorVersion());
+    reader th(data, data_size, inf.getMinorVersion());
     switch (tag_id)
     {
     case TAG_YOU:
@@ -4669,6 +4737,7 @@ static void _tag_read_you_items(reader &th)
         for (int j = count2; j < MAX_SUBTYPES; ++j)
             you.type_ids[i][j] = false;
     }
+    invalidate_item_names();
 
 #if TAG_MAJOR_VERSION == 34
     if (th.getMinorVersion() < TAG_MINOR_ID_STATES)
@@ -5179,6 +5248,38 @@ static int _last_used_index(const Z &thinglist, int max_things)
 
 // ------------------------------- level tags ---------------------------- //
 
+// Features and terrain properties are written as whole grids, which is
+// much cheaper than going through the marshalling functions cell by cell.
+// Map knowledge is variable-length, so it follows one cell at a time.
+static void _marshall_level_grids(writer &th)
+{
+    vector<unsigned char> buf(GXM * GYM * 4);
+
+    unsigned char *p = buf.data();
+    for (int x = 0; x < GXM; x++)
+        for (int y = 0; y < GYM; y++)
+            *p++ = env.grid[x][y];
+    th.write(buf.data(), GXM * GYM);
+
+    // Terrain properties in network order, as marshallInt would.
+    p = buf.data();
+    for (int x = 0; x < GXM; x++)
+        for (int y = 0; y < GYM; y++)
+        {
+            const uint32_t flags = env.pgrid[x][y].flags;
+            CHECK_INITIALIZED(flags);
+            *p++ = flags >> 24;
+            *p++ = flags >> 16;
+            *p++ = flags >> 8;
+            *p++ = flags;
+        }
+    th.write(buf.data(), buf.size());
+
+    for (int x = 0; x < GXM; x++)
+        for (int y = 0; y < GYM; y++)
+            marshallMapCell(th, env.map_knowledge[x][y]);
+}
+
 static void _tag_construct_level(writer &th)
 {
     marshallByte(th, env.floor_colour);
@@ -5197,13 +5298,7 @@ static void _tag_construct_level(writer &th)
 
     CANARY;
 
-    for (int count_x = 0; count_x < GXM; count_x++)
-        for (int count_y = 0; count_y < GYM; count_y++)
-        {
-            marshallByte(th, env.grid[count_x][count_y]);
-            marshallMapCell(th, env.map_knowledge[count_x][count_y]);
-            marshallInt(th, env.pgrid[count_x][count_y].flags);
-        }
+    _marshall_level_grids(th);
 
     marshallBoolean(th, !!env.map_forgotten);
     if (env.map_forgotten)
@@ -5217,9 +5312,9 @@ static void _tag_construct_level(writer &th)
 
     // how many clouds?
     marshallShort(th, env.cloud.size());
-    for (const auto& entry : env.cloud)
+    for (const coord_def &pos : env.cloud.positions())
     {
-        const cloud_struct& cloud = entry.second;
+        const cloud_struct& cloud = *cloud_at(pos);
         marshallByte(th, cloud.type);
         ASSERT(cloud.type != CLOUD_NONE);
         ASSERT_IN_BOUNDS(cloud.pos);
@@ -6725,6 +6820,54 @@ void _tag_construct_level_tiles(writer &th)
     marshallInt(th, TILE_WALL_MAX);
 }
 
+static void _unmarshall_map_knowledge_cell(reader &th, const coord_def &c)
+{
+    map_cell &cell = env.map_knowledge(c);
+    unmarshallMapCell(th, cell);
+    // Fixup positions
+    if (cell.monsterinfo())
+        cell.monsterinfo()->pos = c;
+    if (cell.cloudinfo())
+        cell.cloudinfo()->pos = c;
+
+    cell.flags &= ~MAP_VISIBLE_FLAG;
+    if (cell.seen())
+        env.map_seen.set(c.x, c.y);
+}
+
+// The counterpart of _marshall_level_grids().
+static void _unmarshall_level_grids(reader &th)
+{
+    vector<unsigned char> buf(GXM * GYM * 4);
+
+    th.read(buf.data(), GXM * GYM);
+    const unsigned char *p = buf.data();
+    for (int x = 0; x < GXM; x++)
+        for (int y = 0; y < GYM; y++)
+        {
+            const dungeon_feature_type feat =
+                static_cast<dungeon_feature_type>(*p++);
+            ASSERT(feat < NUM_FEATURES);
+            env.grid[x][y] = feat;
+        }
+
+    th.read(buf.data(), buf.size());
+    p = buf.data();
+    for (int x = 0; x < GXM; x++)
+        for (int y = 0; y < GYM; y++)
+        {
+            env.pgrid[x][y].flags = (uint32_t)p[0] << 24
+                                    | (uint32_t)p[1] << 16
+                                    | (uint32_t)p[2] << 8
+                                    | (uint32_t)p[3];
+            p += 4;
+        }
+
+    for (int x = 0; x < GXM; x++)
+        for (int y = 0; y < GYM; y++)
+            _unmarshall_map_knowledge_cell(th, coord_def(x, y));
+}
+
 static void _tag_read_level(reader &th)
 {
     env.floor_colour = unmarshallUByte(th);
@@ -6752,35 +6895,29 @@ static void _tag_read_level(reader &th)
     EAT_CANARY;
 
     env.map_seen.reset();
+    env.mgrid.init(NON_MONSTER);
 #if TAG_MAJOR_VERSION == 34
     vector<coord_def> transporters;
-#endif
-    for (int i = 0; i < gx; i++)
-        for (int j = 0; j < gy; j++)
-        {
-            dungeon_feature_type feat = unmarshallFeatureType(th);
-            env.grid[i][j] = feat;
-            ASSERT(feat < NUM_FEATURES);
-
-#if TAG_MAJOR_VERSION == 34
-            // Save these for potential destination clean up.
-            if (env.grid[i][j] == DNGN_TRANSPORTER)
-                transporters.push_back(coord_def(i, j));
-#endif
-            unmarshallMapCell(th, env.map_knowledge[i][j]);
-            // Fixup positions
-            if (env.map_knowledge[i][j].monsterinfo())
-                env.map_knowledge[i][j].monsterinfo()->pos = coord_def(i, j);
-            if (env.map_knowledge[i][j].cloudinfo())
-                env.map_knowledge[i][j].cloudinfo()->pos = coord_def(i, j);
+    if (th.getMinorVersion() < TAG_MINOR_BULK_GRIDS)
+    {
+        for (int i = 0; i < gx; i++)
+            for (int j = 0; j < gy; j++)
+            {
+                dungeon_feature_type feat = unmarshallFeatureType(th);
+                env.grid[i][j] = feat;
+                ASSERT(feat < NUM_FEATURES);
 
-            env.map_knowledge[i][j].flags &= ~MAP_VISIBLE_FLAG;
-            if (env.map_knowledge[i][j].seen())
-                env.map_seen.set(i, j);
-            env.pgrid[i][j].flags = unmarshallInt(th);
+                // Save these for potential destination clean up.
+                if (env.grid[i][j] == DNGN_TRANSPORTER)
+                    transporters.push_back(coord_def(i, j));
 
-            env.mgrid[i][j] = NON_MONSTER;
-        }
+                _unmarshall_map_knowledge_cell(th, coord_def(i, j));
+                env.pgrid[i][j].flags = unmarshallInt(th);
+            }
+    }
+    else
+#endif
+    _unmarshall_level_grids(th);
 
 #if TAG_MAJOR_VERSION == 34
     if (th.getMinorVersion() < TAG_MINOR_FORGOTTEN_MAP)
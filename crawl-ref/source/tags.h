@@ -6,6 +6,7 @@
 #pragma once
 
 #include <cstdio>
+#include <cstring>
 #include <vector>
 
 #include "bitary.h"
@@ -71,13 +72,30 @@ public:
 
     ~writer() { if (_chunk) delete _chunk; }
 
-    void writeByte(unsigned char byte);
-    void write(const void *data, size_t size);
+    // Writing to memory is the common case, so it is kept inline.
+    void writeByte(unsigned char byte)
+    {
+        if (_pbuf)
+            _pbuf->push_back(byte);
+        else
+            write_out(&byte, 1);
+    }
+    void write(const void *data, size_t size)
+    {
+        if (_pbuf)
+        {
+            const unsigned char* cdata = static_cast<const unsigned char*>(data);
+            _pbuf->insert(_pbuf->end(), cdata, cdata + size);
+        }
+        else
+            write_out(data, size);
+    }
     long tell();
 
     bool succeeded() const { return !failed; }
 
 private:
+    void write_out(const void *data, size_t size);
     void check_ok(bool ok);
 
 private:
@@ -115,18 +133,44 @@ class reader
 public:
     reader(const string &filename, int minorVersion = TAG_MINOR_INVALID);
     reader(FILE* input, int minorVersion = TAG_MINOR_INVALID)
-        : _file(input), _chunk(0), opened_file(false), _pbuf(0),
+        : _file(input), opened_file(false), _data(nullptr), _data_len(0),
           _read_offset(0), _minorVersion(minorVersion), _safe_read(false) {}
     reader(const vector<unsigned char>& input,
            int minorVersion = TAG_MINOR_INVALID)
-        : _file(0), _chunk(0), opened_file(false), _pbuf(&input),
+        : _file(0), opened_file(false), _data(input.data()),
+          _data_len(input.size()), _read_offset(0),
+          _minorVersion(minorVersion), _safe_read(false) {}
+    // Reads from memory that must outlive the reader.
+    reader(const unsigned char *data, size_t len,
+           int minorVersion = TAG_MINOR_INVALID)
+        : _file(0), opened_file(false), _data(data), _data_len(len),
           _read_offset(0), _minorVersion(minorVersion), _safe_read(false) {}
+    // Decompresses the whole chunk up front.
     reader(package *save, const string &chunkname,
            int minorVersion = TAG_MINOR_INVALID);
     ~reader();
 
-    unsigned char readByte();
-    void read(void *data, size_t size);
+    // Reading from memory is the common case, so it is kept inline.
+    unsigned char readByte()
+    {
+        if (_read_offset < _data_len)
+            return _data[_read_offset++];
+        return read_byte_slow();
+    }
+    void read(void *data, size_t size)
+    {
+        if (!_file && size <= _data_len - _read_offset)
+        {
+            if (data && size)
+                memcpy(data, _data + _read_offset, size);
+            _read_offset += size;
+        }
+        else
+            read_slow(data, size);
+    }
+    // Skips the next size bytes and returns them in place, or nullptr
+    // (without skipping) if the input is not held in memory.
+    const unsigned char *read_span(size_t size);
     void advance(size_t size);
     int getMinorVersion() const;
     void setMinorVersion(int minorVersion);
@@ -138,13 +182,18 @@ public:
 
     void set_safe_read(bool setting) { _safe_read = setting; }
 
+private:
+    unsigned char read_byte_slow();
+    void read_slow(void *data, size_t size);
+
 private:
     string _filename;
     FILE* _file;
-    chunk_reader *_chunk;
     bool  opened_file;
-    const vector<unsigned char>* _pbuf;
-    unsigned int _read_offset;
+    vector<char> _chunk_data;
+    const unsigned char *_data;
+    size_t _data_len;
+    size_t _read_offset;
     int _minorVersion;
     // always throw an exception rather than dying when reading past EOF
     bool _safe_read;
@@ -204,6 +253,14 @@ void remove_removed_library_spells(FixedBitVector<NUM_SPELLS>& lib);
 
 void tag_read(reader &inf, tag_type tag_id);
 void tag_write(tag_type tagID, writer &outf);
+// Benchmarking hooks: marshall just the terrain and map part of the current
+// level, or read it back.
+void tag_write_level_grids(vector<unsigned char> &buf);
+void tag_read_level_grids(const vector<unsigned char> &buf);
+// The player state that level building depends on, for handing levels built
+// in another process back to this one.
+void tag_write_levelgen_state(writer &th);
+void tag_read_levelgen_state(reader &th);
 player_save_info tag_read_char_info(reader &th, uint8_t format, uint8_t major,
                                                                 uint32_t minor);
 
@@ -0,0 +1,23 @@
+-- Time procedural terrain sampling in the Abyss: many turns of terrain
+-- morphing in place, and many shifts to a fresh area as the player walks
+-- off the edge of the current one.
+
+local MORPH_TURNS = 2000
+local SHIFTS = 200
+
+debug.goto_place("Abyss")
+test.regenerate_level()
+
+local start = crawl.millis()
+debug.abyss_morph(MORPH_TURNS)
+local morph_ms = crawl.millis() - start
+
+start = crawl.millis()
+for i = 1, SHIFTS do
+  -- close enough to the edge to make the Abyss shift around the player
+  you.teleport_to(68, 5 + crawl.random2(50))
+end
+local shift_ms = crawl.millis() - start
+
+crawl.stderr(MORPH_TURNS .. " turns of morphing in " .. morph_ms .. " ms, "
+             .. SHIFTS .. " area shifts in " .. shift_ms .. " ms")
@@ -0,0 +1,35 @@
+-- Helpers shared by the level benchmarks in this directory; load with
+-- crawl_require('test/big/bench.lua'). Not a benchmark itself.
+
+util.namespace('bench')
+
+-- The levels each benchmark is timed on.
+bench.places = { "D:1", "D:10", "Lair:3", "Elf:2", "Zot:4" }
+
+-- All passable squares of the current level, as { x, y } pairs.
+function bench.open_cells()
+  local cells = { }
+  local gxm, gym = dgn.max_bounds()
+  for y = 1, gym - 2 do
+    for x = 1, gxm - 2 do
+      if dgn.is_passable(x, y) then
+        table.insert(cells, { x, y })
+      end
+    end
+  end
+  return cells
+end
+
+-- Generate each of bench.places in turn and call fn(place) on it. Returns
+-- the sums over all levels of each of the numbers fn returns.
+function bench.on_levels(fn)
+  local totals = { }
+  for _, place in ipairs(bench.places) do
+    debug.goto_place(place)
+    test.regenerate_level()
+    for i, n in ipairs({ fn(place) }) do
+      totals[i] = (totals[i] or 0) + n
+    end
+  end
+  return unpack(totals)
+end
@@ -0,0 +1,39 @@
+-- Time manage_clouds() on a few generated levels filled with spreading
+-- flame and freezing clouds: every open square gets a cloud, and they are
+-- left to spread and dissipate for a while before the level is filled again.
+
+crawl_require('test/big/bench.lua')
+
+local FILLS = 20
+local TURNS = 25
+
+local function fill_clouds(cells)
+  for i, c in ipairs(cells) do
+    -- leave some gaps for the clouds to spread into
+    if crawl.one_chance_in(3) then
+      local kind = i % 2 == 0 and "flame" or "freezing vapour"
+      dgn.place_cloud(c[1], c[2], kind, 5 + crawl.random2(10), "", 30)
+    end
+  end
+end
+
+local function bench_level(place)
+  local cells = bench.open_cells()
+
+  local managed_ms, peak = 0, 0
+  for i = 1, FILLS do
+    fill_clouds(cells)
+    local start = crawl.millis()
+    for j = 1, TURNS do
+      peak = math.max(peak, debug.manage_clouds(1))
+    end
+    managed_ms = managed_ms + crawl.millis() - start
+  end
+
+  crawl.stderr(place .. ": " .. FILLS * TURNS .. " cloud turns in "
+               .. managed_ms .. " ms, at most " .. peak .. " clouds")
+  return managed_ms
+end
+
+local total = bench.on_levels(bench_level)
+crawl.stderr("total: " .. total .. " ms")
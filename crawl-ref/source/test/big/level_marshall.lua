@@ -0,0 +1,33 @@
+-- Time marshalling of level terrain and map data (the TAG_LEVEL grids) in
+-- both directions, on a few generated levels.
+
+crawl_require('test/big/bench.lua')
+
+local REPS = 200
+
+local function mb_per_s(bytes, ms)
+  if ms == 0 then
+    return "inf"
+  end
+  return string.format("%.1f", bytes * REPS / 1000 / ms)
+end
+
+local function bench_level(place)
+  local start = crawl.millis()
+  local bytes = debug.marshall_level(REPS)
+  local write_ms = crawl.millis() - start
+
+  start = crawl.millis()
+  debug.unmarshall_level(REPS)
+  local read_ms = crawl.millis() - start
+
+  crawl.stderr(place .. ": " .. bytes .. " bytes, write "
+               .. mb_per_s(bytes, write_ms) .. " MB/s, read "
+               .. mb_per_s(bytes, read_ms) .. " MB/s")
+  return bytes, write_ms, read_ms
+end
+
+local total_bytes, total_write, total_read = bench.on_levels(bench_level)
+crawl.stderr("total (" .. REPS .. " reps per level): write "
+             .. mb_per_s(total_bytes, total_write) .. " MB/s, read "
+             .. mb_per_s(total_bytes, total_read) .. " MB/s")
@@ -0,0 +1,37 @@
+-- Time the word-parallel LOS kernel against the original bit_vector one
+-- on the debug_los layouts used by los_maps.lua.
+
+local ITERATIONS = 20000
+
+local function time_kernel(reference)
+  local start = crawl.millis()
+  for i = 1, ITERATIONS do
+    los.losight(30, 30, reference)
+  end
+  return crawl.millis() - start
+end
+
+local function bench_los_map(map)
+  dgn.reset_level()
+  dgn.tags(map, "no_rotate no_vmirror no_hmirror no_pool_fixup")
+  local function place_map()
+    return dgn.place_map(map, true, true)
+  end
+  dgn.with_map_anchors(30, 30, place_map)
+  assert(los.kernels_agree(30, 30),
+         "LOS kernels disagree in " .. dgn.name(map) .. ".")
+  return time_kernel(false), time_kernel(true)
+end
+
+local total_new, total_old = 0, 0
+local map = dgn.map_by_tag("debug_los")
+assert(map, "Could not find debug-los maps (tag 'debug_los')")
+while map do
+  local new, old = bench_los_map(map)
+  crawl.stderr(dgn.name(map) .. ": new " .. new .. "ms, old " .. old .. "ms")
+  total_new = total_new + new
+  total_old = total_old + old
+  map = dgn.map_by_tag("debug_los")
+end
+crawl.stderr("total (" .. ITERATIONS .. " calls per map): new " .. total_new
+             .. "ms, old " .. total_old .. "ms")
@@ -0,0 +1,122 @@
+-- Time matching messages against the message options (force_more_message,
+-- flash_screen_message, note_messages and message_colour_mappings), with as
+-- many patterns as a large rc file, by feeding a recorded message log
+-- through them.
+
+local REPS = 200
+
+-- A stretch of a real game's messages, with their channels.
+local LOG = [[
+plain:Welcome, Gnoll the Gnoll Berserker.
+tutorial:Press ? for a list of commands and other information.
+plain:Found a staircase leading out of the dungeon.
+plain:You see here a +0 scale mail.
+floor:There are several objects here.
+plain:You hit the goblin.
+monster_damage:The goblin is moderately wounded.
+plain:You kill the goblin!
+plain:You see here a goblin corpse.
+plain:There is a stone staircase leading down here.
+warning:A jackal comes into view.
+plain:You smite the jackal.
+monster_damage:The jackal is severely wounded.
+plain:The jackal bites you.
+plain:You kill the jackal!
+warning:A kobold comes into view. It is wielding a short sword.
+plain:The kobold hits you with a short sword.
+plain:You hit the kobold.
+plain:You kill the kobold!
+plain:Found 12 gold pieces.
+plain:You now have 40 gold pieces.
+plain:Found a shop of weapons.
+plain:You see here a scroll labelled JEXIRIAN POMPLOTEK.
+plain:z - a scroll labelled JEXIRIAN POMPLOTEK
+plain:As you read the scroll of identify, it crumbles to dust.
+plain:It is a scroll of identify.
+warning:An orc priest comes into view. It is wielding a +0 club.
+monster_spell:The orc priest utters an invocation to Beogh.
+plain:The orc priest is blessed by Beogh.
+sound:You hear a shout!
+plain:The orc priest hits you with a +0 club.
+plain:You are now more vulnerable to electricity.
+plain:You kill the orc priest!
+god:Trog is pleased.
+plain:You feel a bit more experienced.
+intrinsic_gain:You have reached level 5!
+intrinsic_gain:Your experience leads to an increase in your attributes!
+danger:You are too injured to fight recklessly!
+plain:You feel strangely unstable.
+plain:You blink.
+warning:Sigmund comes into view. He is wielding a +0 scythe.
+talk:Sigmund shouts, "I will never be defeated!"
+monster_spell:Sigmund casts a spell.
+plain:You are confused.
+plain:You feel less confused.
+plain:You go berserk!
+plain:You feel mighty!
+plain:You feel yourself speed up.
+plain:You hit Sigmund.
+monster_damage:Sigmund is heavily wounded.
+plain:Sigmund hits you with a +0 scythe!
+plain:You kill Sigmund!
+plain:You are no longer berserk.
+plain:You are exhausted.
+plain:You feel yourself slow down.
+plain:You see here the +2 scythe of Holy Wrath {holy}.
+plain:You pick up 23 gold pieces.
+plain:You drink a potion labelled bubbling orange.
+plain:It was a potion of curing.
+plain:You feel better.
+plain:Your stomach is very full now.
+recovery:You feel less exhausted.
+prompt:Really attack while wielding nothing? (y/N)
+warning:Two adders come into view.
+plain:The adder bites you.
+plain:You are poisoned.
+danger:* * * LOW HITPOINT WARNING * * *
+plain:You feel very sick.
+plain:The poison in your body grows weaker.
+plain:There is an entrance to the Lair of Beasts on this level.
+plain:You enter the Lair of Beasts.
+plain:You feel a strange sense of loss.
+plain:Your hand slips and your gloves fall to the floor.
+plain:You hear the creaking of a portcullis.
+plain:A magical portal is leading to a bazaar.
+plain:You see a sewer grate here.
+plain:Ashenzari says: I see what you see.
+plain:The Ice Cave: you feel the frosty air.
+plain:This meat is rotten.
+duration:You are starting to lose your buoyancy.
+duration:Your transformation is almost over.
+equipment:a - a +0 hand axe (weapon)
+multiturn:You start removing your armour.
+examine:A jackal. It is mildly wounded.
+]]
+
+local MONSTERS = { "orc", "goblin", "jackal", "adder", "kobold", "ogre",
+                   "troll", "hydra", "dragon", "lich", "demon", "giant",
+                   "naga", "centaur", "yak", "wolf", "spider", "ghoul",
+                   "wraith", "mummy", "vampire", "golem", "elf", "dwarf",
+                   "imp", "eye", "bat", "rat", "snake", "scorpion" }
+
+-- Roughly what a long rc file adds on top of the defaults.
+for _, mon in ipairs(MONSTERS) do
+  crawl.setopt("force_more_message += " .. mon .. ".* comes? into view")
+  crawl.setopt("force_more_message += The " .. mon .. " (casts|breathes)")
+  crawl.setopt("flash_screen_message += " .. mon .. " .*(gestures|shouts)")
+  crawl.setopt("note_messages += You kill .*" .. mon)
+  crawl.setopt("message_colour += yellow:" .. mon .. " is (heavily|severely)")
+  crawl.setopt("message_colour += mute:The " .. mon .. " misses")
+end
+crawl.setopt("force_more_message += You feel (yourself slow|a strange)")
+crawl.setopt("force_more_message += danger:")
+crawl.setopt("flash_screen_message += LOW HITPOINT WARNING")
+crawl.setopt("note_messages += Ashenzari|Trog|Beogh")
+crawl.setopt("message_colour += lightred:(poison|sick)")
+
+local start = crawl.millis()
+local matches = debug.filter_messages(LOG, REPS)
+local ms = crawl.millis() - start
+
+crawl.stderr(REPS .. " passes over the message log (" .. matches
+             .. " matches) in " .. ms .. " ms")
@@ -0,0 +1,42 @@
+-- Time noise propagation (register_noise() and propagate_noise()) on a few
+-- generated levels: many quiet noises, each applied on its own, and a few
+-- loud ones applied together.
+
+crawl_require('test/big/bench.lua')
+
+local QUIET_REPS = 5000
+local LOUD_REPS = 200
+
+local function make_noise(cells, loudness)
+  local c = cells[crawl.random2(#cells) + 1]
+  dgn.noisy(loudness, c[1], c[2])
+end
+
+local function bench_level(place)
+  local cells = bench.open_cells()
+
+  local start = crawl.millis()
+  for i = 1, QUIET_REPS do
+    make_noise(cells, 2)
+    debug.apply_noises()
+  end
+  local quiet_ms = crawl.millis() - start
+
+  start = crawl.millis()
+  for i = 1, LOUD_REPS do
+    for j = 1, 8 do
+      make_noise(cells, 15 + crawl.random2(10))
+    end
+    debug.apply_noises()
+  end
+  local loud_ms = crawl.millis() - start
+
+  crawl.stderr(place .. ": " .. QUIET_REPS .. " quiet noises in " .. quiet_ms
+               .. " ms, " .. LOUD_REPS .. " rounds of loud noises in "
+               .. loud_ms .. " ms")
+  return quiet_ms, loud_ms
+end
+
+local total_quiet, total_loud = bench.on_levels(bench_level)
+crawl.stderr("total: quiet " .. total_quiet .. " ms, loud " .. total_loud
+             .. " ms")
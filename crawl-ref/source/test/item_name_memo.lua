@@ -0,0 +1,41 @@
+-- Check that item names, which item_def::name() remembers, follow what the
+-- player learns about the item's type and the descriptions given to types.
+
+local p = dgn.point(20, 20)
+
+dgn.reset_level()
+dgn.fill_grd_area(1, 1, dgn.GXM - 2, dgn.GYM - 2, 'floor')
+dgn.create_item(p.x, p.y, "potion of curing")
+local potion = dgn.items_at(p.x, p.y)[1]
+assert(potion, "Could not create a potion of curing")
+
+debug.set_item_type_known(potion, false)
+local unknown = potion.name()
+assert(not string.find(unknown, "curing", 1, true),
+       "unidentified potion is called " .. unknown)
+-- The second time, the name may come from memory.
+assert(potion.name() == unknown,
+       "unidentified potion is now called " .. potion.name())
+
+debug.set_item_type_known(potion, true)
+assert(string.find(potion.name(), "curing", 1, true),
+       "identified potion is still called " .. potion.name())
+
+debug.set_item_type_known(potion, false)
+assert(potion.name() == unknown,
+       "forgotten potion is called " .. potion.name() .. ", not " .. unknown)
+
+-- New descriptions can happen to give the potion the same one, but not
+-- every time.
+local renamed = false
+for i = 1, 20 do
+  debug.initialise_item_descriptions()
+  if potion.name() ~= unknown then
+    renamed = true
+    break
+  end
+end
+assert(renamed, "potion is still called " .. unknown
+                .. " with new item descriptions")
+
+dgn.reset_level()
@@ -0,0 +1,65 @@
+-- Check that the global LOS cache stays correct when single cells change
+-- opacity, i.e. that invalidate_los_around forgets every affected pair.
+
+local floor = "floor"
+local wall = "rock_wall"
+
+local x1, y1, x2, y2 = 30, 20, 60, 45
+
+local function cached_matches_fresh(ox, oy)
+  for y = oy - 7, oy + 7 do
+    for x = ox - 7, ox + 7 do
+      local dx, dy = x - ox, y - oy
+      if (dx ~= 0 or dy ~= 0) and dx * dx + dy * dy <= 49
+         and dgn.in_bounds(x, y) then
+        local cached = los.cell_see_cell(ox, oy, x, y) ~= 0
+        local fresh = los.findray(ox, oy, x, y) ~= nil
+        if cached ~= fresh then
+          debug.dump_map("loscachefail.map")
+          assert(false, "stale LOS cache: (" .. ox .. "," .. oy .. ") to ("
+                        .. x .. "," .. y .. ") cached " .. tostring(cached)
+                        .. ", fresh " .. tostring(fresh))
+        end
+      end
+    end
+  end
+end
+
+local function test_los_cache()
+  dgn.reset_level()
+  dgn.grid(10, 10, floor)
+  you.moveto(10, 10)
+
+  for y = y1, y2 do
+    for x = x1, x2 do
+      dgn.grid(x, y, crawl.one_chance_in(4) and wall or floor)
+    end
+  end
+
+  -- Fill the cache.
+  for y = y1, y2 do
+    for x = x1, x2 do
+      los.cell_see_cell(x, y, x1 + 15, y1 + 12)
+      cached_matches_fresh(x, y)
+    end
+  end
+
+  for i = 1, 60 do
+    local cx = x1 + 8 + crawl.random2(x2 - x1 - 15)
+    local cy = y1 + 8 + crawl.random2(y2 - y1 - 15)
+    if dgn.grid(cx, cy) == dgn.find_feature_number(wall) then
+      dgn.grid(cx, cy, floor)
+    else
+      dgn.grid(cx, cy, wall)
+    end
+    for oy = cy - 7, cy + 7, 2 do
+      for ox = cx - 7, cx + 7, 2 do
+        cached_matches_fresh(ox, oy)
+      end
+    end
+  end
+end
+
+for i = 1, 3 do
+  test_los_cache()
+end
@@ -21,6 +21,8 @@ local function test_los_map(map)
   dgn.with_map_anchors(30, 30, place_map)
   you.moveto(30, 30)
   crawl.redraw_view()
+  assert(los.kernels_agree(30, 30),
+         "LOS kernels disagree in " .. name .. ".")
   for x = 0, 9 do
     for y = 0, 9 do
       local xa = 30 + x
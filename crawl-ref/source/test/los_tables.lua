@@ -0,0 +1,3 @@
+-- Check that the build-time LOS ray tables match the rays cast at run time.
+
+assert(los.verify_tables(), "los-tables.h is out of date with los-rays.cc")
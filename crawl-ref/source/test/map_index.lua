@@ -0,0 +1,19 @@
+-- Check that vault selection by tag sees tags that map Lua adds to or
+-- removes from a loaded map after it was indexed.
+
+local TAG = "map_index_test"
+
+local map = dgn.map_by_tag("bounce_test")
+assert(map, "Could not find bounce_test map (tag 'bounce_test')")
+local name = dgn.name(map)
+
+assert(not dgn.map_by_tag(TAG, false), "a map already has tag " .. TAG)
+
+dgn.tags(map, TAG)
+local found = dgn.map_by_tag(TAG, false)
+assert(found and dgn.name(found) == name,
+       "map " .. name .. " not found by a tag added after loading")
+
+dgn.tags_remove(map, TAG)
+assert(not dgn.map_by_tag(TAG, false),
+       "map " .. name .. " still found by a removed tag")
@@ -0,0 +1,25 @@
+-- Check that a seeded game takes the level below from the background worker
+-- when the player goes down after playing some turns. The turns move the
+-- gameplay and UI generators on, which mustn't make the worker's level look
+-- stale.
+
+local function test_pregen_worker()
+  if not debug.start_background_pregen() then
+    -- This build doesn't build levels in the background.
+    return
+  end
+
+  local taken = debug.background_pregen_taken()
+  debug.pass_turns(30)
+  debug.down_stairs()
+  assert(you.where() == "D:2", "went to " .. you.where() .. ", not D:2")
+  assert(debug.background_pregen_taken() == taken + 1,
+         "D:2 was built again instead of taken from the background worker")
+end
+
+debug.start_seeded_game(1)
+local ok, err = pcall(test_pregen_worker)
+debug.end_seeded_game()
+if not ok then
+  error(err, 0)
+end
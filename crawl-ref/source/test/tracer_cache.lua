@@ -0,0 +1,34 @@
+-- Check that a monster tracer fired again with the same beam while tracers
+-- are cached, as when a monster picks a spell, comes from the cache and
+-- gives the same results as the first one.
+
+local floor = "floor"
+
+local function test_tracer_cache()
+  dgn.reset_level()
+  for y = 20, 40 do
+    for x = 20, 40 do
+      dgn.grid(x, y, floor)
+    end
+  end
+  dgn.grid(10, 10, floor)
+  you.moveto(10, 10)
+
+  dgn.create_monster(25, 30, "generate_awake test statue")
+  dgn.create_monster(30, 30, "generate_awake goblin")
+  dgn.create_monster(33, 31, "generate_awake goblin")
+  dgn.grid(30, 34, "rock_wall")
+
+  for _, target in ipairs({ { 30, 30 }, { 37, 32 }, { 30, 37 },
+                            { 25, 20 } }) do
+    local agree, hits = debug.refire_tracer(25, 30, target[1], target[2])
+    assert(agree, "cached tracer at (" .. target[1] .. "," .. target[2]
+                  .. ") differs from a fresh one")
+    assert(hits == 1, "tracer at (" .. target[1] .. "," .. target[2]
+                      .. ") was not cached: " .. hits .. " hits")
+  end
+
+  dgn.dismiss_monsters()
+end
+
+test_tracer_cache()
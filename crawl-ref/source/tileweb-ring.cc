@@ -0,0 +1,131 @@
+#include "AppHdr.h"
+
+#ifdef USE_TILE_WEB
+
+#include "tileweb-ring.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "stringutil.h"
+
+static const size_t RING_HEADER_SIZE = 64;
+static const uint32_t RING_VERSION = 3;
+
+const char RING_SOCKET_MARKER[] = "*{\"msg\":\"ring_socket\"}\n";
+
+struct ring_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t capacity;
+    uint64_t write_seq;
+    uint64_t reserve_seq;
+};
+COMPILE_CHECK(sizeof(ring_header) <= RING_HEADER_SIZE);
+
+WebMessageRing::WebMessageRing()
+    : m_fd(-1), m_map(nullptr), m_capacity(0), m_seq(0)
+{
+}
+
+WebMessageRing::~WebMessageRing()
+{
+    close();
+}
+
+bool WebMessageRing::open(size_t capacity)
+{
+    close();
+
+    // The name only has to be unique until it is unlinked, just below.
+    static int opened = 0;
+    for (int tries = 0; m_fd < 0 && tries < 10; ++tries)
+    {
+        const string name = make_stringf("/crawl-ring-%d-%d", (int) getpid(),
+                                         opened++);
+        m_fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (m_fd >= 0)
+            shm_unlink(name.c_str());
+        else if (errno != EEXIST)
+            return false;
+    }
+    if (m_fd < 0)
+        return false;
+
+    const size_t size = RING_HEADER_SIZE + capacity;
+    void *map = MAP_FAILED;
+    if (!ftruncate(m_fd, size))
+        map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (map == MAP_FAILED)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    m_map = static_cast<char *>(map);
+    m_capacity = capacity;
+    m_seq = 0;
+
+    ring_header *header = reinterpret_cast<ring_header *>(m_map);
+    memcpy(header->magic, "crawlrng", sizeof(header->magic));
+    header->version = RING_VERSION;
+    header->header_size = RING_HEADER_SIZE;
+    header->capacity = capacity;
+    header->write_seq = 0;
+    header->reserve_seq = 0;
+    return true;
+}
+
+void WebMessageRing::close()
+{
+    if (!m_map)
+        return;
+
+    munmap(m_map, RING_HEADER_SIZE + m_capacity);
+    ::close(m_fd);
+    m_map = nullptr;
+    m_fd = -1;
+}
+
+// Writes a message to the ring. A message that doesn't fit could never be
+// read whole, so for one of those this writes RING_SOCKET_MARKER instead,
+// and returns false: the caller has to send the message to the readers
+// itself.
+bool WebMessageRing::write(const char *data, size_t len)
+{
+    ASSERT(m_map);
+    if (len > m_capacity)
+    {
+        _append(RING_SOCKET_MARKER, strlen(RING_SOCKET_MARKER));
+        return false;
+    }
+
+    _append(data, len);
+    return true;
+}
+
+void WebMessageRing::_append(const char *data, size_t len)
+{
+    ring_header *header = reinterpret_cast<ring_header *>(m_map);
+    // Announce what we're about to overwrite before touching it.
+    __atomic_store_n(&header->reserve_seq, m_seq + len, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    char *ring = m_map + RING_HEADER_SIZE;
+    const size_t start = m_seq % m_capacity;
+    const size_t first = min(len, m_capacity - start);
+    memcpy(ring + start, data, first);
+    memcpy(ring, data + first, len - first);
+    m_seq += len;
+
+    __atomic_store_n(&header->write_seq, m_seq, __ATOMIC_RELEASE);
+}
+
+#endif
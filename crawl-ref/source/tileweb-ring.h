@@ -0,0 +1,58 @@
+#ifdef USE_TILE_WEB
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+using std::string;
+
+extern const char RING_SOCKET_MARKER[];
+
+// A shared memory object that webtiles messages are written to once,
+// however many webserver connections read them. Readers keep their own
+// position and are told by a datagram when there is more to read, so a
+// slow reader can't hold the game up; one that falls more than a ring's
+// worth behind loses messages and has to ask for everything again.
+//
+// The object is unlinked as soon as it is created, so that it never
+// outlives the game: readers are sent its descriptor over their socket.
+// It is a 64-byte header followed by the ring itself: byte n of the
+// message stream is at offset 64 + n % capacity. The header is
+//   char     magic[8];     "crawlrng"
+//   uint32_t version;      3
+//   uint32_t header_size;  64
+//   uint64_t capacity;
+//   uint64_t write_seq;    bytes written so far
+//   uint64_t reserve_seq;  bytes written or being written
+// in native byte order. reserve_seq is updated before a message is copied
+// in and write_seq after, so a reader that checks reserve_seq after
+// copying knows whether the writer may have overwritten what it copied.
+//
+// A message too large for the ring is replaced there by the line
+// RING_SOCKET_MARKER, and sent over the reader's socket instead: a reader
+// that meets the marker stops reading the ring until it has that message.
+class WebMessageRing
+{
+public:
+    WebMessageRing();
+    ~WebMessageRing();
+
+    bool open(size_t capacity);
+    void close();
+    bool is_open() const { return m_map != nullptr; }
+
+    int fd() const { return m_fd; }
+    uint64_t seq() const { return m_seq; }
+
+    bool write(const char *data, size_t len);
+
+private:
+    void _append(const char *data, size_t len);
+
+    int m_fd;
+    char *m_map;
+    size_t m_capacity;
+    uint64_t m_seq;
+};
+
+#endif
@@ -83,6 +83,12 @@ static unsigned int get_milliseconds()
 
 TilesFramework tiles;
 
+// The newest packed map format this version can write; see _send_map().
+static const int PACKED_MAP_FORMAT = 1;
+
+// Big enough for many full map messages.
+static const size_t MESSAGE_RING_SIZE = 4 * 1024 * 1024;
+
 TilesFramework::TilesFramework() :
       m_controlled_from_web(false),
       _send_lock(false),
@@ -93,6 +99,8 @@ TilesFramework::TilesFramework() :
       m_next_view_tl(0, 0),
       m_next_view_br(-1, -1),
       m_need_full_map(true),
+      m_map_format(0),
+      m_packing_cells(false),
       m_text_menu("menu_txt"),
       m_print_fg(15)
 {
@@ -113,6 +121,7 @@ void TilesFramework::shutdown()
 
     close(m_sock);
     remove(m_sock_name.c_str());
+    m_ring.close();
 }
 
 void TilesFramework::draw_doll_edit()
@@ -201,90 +210,172 @@ void TilesFramework::finish_message()
     }
 
     m_msg_buf.append("\n");
+
+    // However many connections read the ring, the message is written once,
+    // and they are only poked to read it. One too large for the ring goes
+    // to them like to everyone else, after the marker that it left there.
+    int fragments = 0;
+    if (!m_ring_addrs.empty())
+    {
+        const bool in_ring = m_ring.write(m_msg_buf.data(), m_msg_buf.size());
+        _notify_ring_readers();
+        if (!in_ring)
+            fragments += _send_in_fragments(m_ring_addrs);
+    }
+    fragments += _send_in_fragments(m_dest_addrs);
+    m_msg_buf.clear();
+    m_need_flush = true;
+#ifdef DEBUG_WEBSOCKETS
+    // should the game actually crash in this case?
+    if (m_controlled_from_web && m_dest_addrs.empty() && m_ring_addrs.empty())
+        fprintf(stderr, "No open websockets after finish_message!!\n");
+
+    fprintf(stderr, "websocket: Sent %d bytes in %d fragments.\n",
+                                                initial_buf_size, fragments);
+#else
+    UNUSED(fragments);
+#endif
+}
+
+// Sends m_msg_buf to each of addrs, in fragments of at most m_max_msg_size,
+// and forgets those that have gone away. Returns the number of fragments.
+int TilesFramework::_send_in_fragments(vector<sockaddr_un> &addrs)
+{
     const char* fragment_start = m_msg_buf.data();
     const char* data_end = m_msg_buf.data() + m_msg_buf.size();
-#ifdef DEBUG_WEBSOCKETS
     int fragments = 0;
-#endif
-    while (fragment_start < data_end)
+    while (fragment_start < data_end && !addrs.empty())
     {
         int fragment_size = data_end - fragment_start;
         if (fragment_size > m_max_msg_size)
             fragment_size = m_max_msg_size;
-#ifdef DEBUG_WEBSOCKETS
         fragments++;
-#endif
 
-        for (unsigned int i = 0; i < m_dest_addrs.size(); ++i)
+        for (unsigned int i = 0; i < addrs.size(); ++i)
         {
-            int retries = 30;
-            ssize_t sent = 0;
-            while (sent < fragment_size)
-            {
-                ssize_t retval = sendto(m_sock, fragment_start + sent,
-                    fragment_size - sent, 0, (sockaddr*) &m_dest_addrs[i],
-                    sizeof(sockaddr_un));
 #ifdef DEBUG_WEBSOCKETS
-                fprintf(stderr,
-                            "    trying to send fragment to client %d...", i);
+            fprintf(stderr, "    sending fragment to client %d...\n", i);
 #endif
-                if (retval <= 0)
-                {
-                    const char *errmsg = retval == 0 ? "No bytes sent"
-                                                     : strerror(errno);
-                    if (--retries <= 0)
-                        die("Socket write error: %s", errmsg);
+            if (!_send_fragment(addrs[i], fragment_start, fragment_size))
+            {
+                addrs.erase(addrs.begin() + i);
+                i--;
+            }
+        }
 
-                    if (retval == 0 || errno == ENOBUFS || errno == EWOULDBLOCK
-                        || errno == EINTR || errno == EAGAIN)
-                    {
-                        // Wait for half a second at first (up to five), then
-                        // try again.
-                        const int sleep_time = retries > 25 ? 2 * 1000
-                                             : retries > 10 ? 500 * 1000
-                                             : 5000 * 1000;
+        fragment_start += fragment_size;
+    }
+    return fragments;
+}
+
+// Sends one fragment of a message to one webserver connection, waiting
+// and retrying while its socket is full. Returns false if the other side
+// has gone away.
+bool TilesFramework::_send_fragment(const sockaddr_un &addr,
+                                    const char *data, int size)
+{
+    int retries = 30;
+    ssize_t sent = 0;
+    while (sent < size)
+    {
+        ssize_t retval = sendto(m_sock, data + sent, size - sent, 0,
+                                (sockaddr*) &addr, sizeof(sockaddr_un));
+        if (retval <= 0)
+        {
+            const char *errmsg = retval == 0 ? "No bytes sent"
+                                             : strerror(errno);
+            if (--retries <= 0)
+                die("Socket write error: %s", errmsg);
+
+            if (retval == 0 || errno == ENOBUFS || errno == EWOULDBLOCK
+                || errno == EINTR || errno == EAGAIN)
+            {
+                // Wait for half a second at first (up to five), then
+                // try again.
+                const int sleep_time = retries > 25 ? 2 * 1000
+                                     : retries > 10 ? 500 * 1000
+                                     : 5000 * 1000;
 #ifdef DEBUG_WEBSOCKETS
-                        fprintf(stderr, "failed (%s), sleeping for %dms.\n",
-                                                    errmsg, sleep_time / 1000);
+                fprintf(stderr, "    failed (%s), sleeping for %dms.\n",
+                                            errmsg, sleep_time / 1000);
 #endif
-                        usleep(sleep_time);
-                    }
-                    else if (errno == ECONNREFUSED || errno == ENOENT)
-                    {
-                        // the other side is dead
+                usleep(sleep_time);
+            }
+            else if (errno == ECONNREFUSED || errno == ENOENT)
+            {
+                // the other side is dead
 #ifdef DEBUG_WEBSOCKETS
-                        fprintf(stderr,
-                            "failed (%s), breaking.\n", errmsg);
+                fprintf(stderr, "    failed (%s), breaking.\n", errmsg);
 #endif
-                        m_dest_addrs.erase(m_dest_addrs.begin() + i);
-                        i--;
-                        break;
-                    }
-                    else
-                        die("Socket write error: %s", errmsg);
-                }
-                else
-                {
+                return false;
+            }
+            else
+                die("Socket write error: %s", errmsg);
+        }
+        else
+        {
 #ifdef DEBUG_WEBSOCKETS
-                    fprintf(stderr, "fragment size %d sent.\n", fragment_size);
+            fprintf(stderr, "    fragment size %d sent.\n", size);
 #endif
-                    sent += retval;
-                }
-            }
+            sent += retval;
         }
-
-        fragment_start += fragment_size;
     }
-    m_msg_buf.clear();
-    m_need_flush = true;
-#ifdef DEBUG_WEBSOCKETS
-    // should the game actually crash in this case?
-    if (m_controlled_from_web && m_dest_addrs.size() == 0)
-        fprintf(stderr, "No open websockets after finish_message!!\n");
+    return true;
+}
 
-    fprintf(stderr, "websocket: Sent %d bytes in %d fragments.\n",
-                                                initial_buf_size, fragments);
-#endif
+// Hands the ring to a new reader: its descriptor, and where in it to start
+// reading. If that fails, the reader just gets messages like a connection
+// that never asked for the ring.
+bool TilesFramework::_send_ring(const sockaddr_un &addr)
+{
+    const string reply = make_stringf(
+        "*{\"msg\":\"ring\",\"seq\":%" PRIu64 "}\n", m_ring.seq());
+    iovec iov;
+    iov.iov_base = const_cast<char *>(reply.data());
+    iov.iov_len = reply.size();
+
+    union
+    {
+        char buf[CMSG_SPACE(sizeof(int))];
+        cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = const_cast<sockaddr_un *>(&addr);
+    msg.msg_namelen = sizeof(sockaddr_un);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    const int fd = m_ring.fd();
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    return sendmsg(m_sock, &msg, 0) == (ssize_t) reply.size();
+}
+
+// Tells the connections reading the ring that there is more to read. This
+// never waits: if a reader's socket is full, it already has a notification
+// to wake it, and it always reads up to the ring's latest write_seq.
+void TilesFramework::_notify_ring_readers()
+{
+    const char poke = 0;
+    for (unsigned int i = 0; i < m_ring_addrs.size(); ++i)
+    {
+        if (sendto(m_sock, &poke, 1, MSG_DONTWAIT,
+                   (sockaddr*) &m_ring_addrs[i], sizeof(sockaddr_un)) < 0
+            && (errno == ECONNREFUSED || errno == ENOENT))
+        {
+            m_ring_addrs.erase(m_ring_addrs.begin() + i);
+            i--;
+        }
+    }
 }
 
 void TilesFramework::send_message(const char *format, ...)
@@ -327,7 +418,7 @@ void TilesFramework::_await_connection()
     if (m_sock_name.empty())
         return;
 
-    while (m_dest_addrs.size() == 0)
+    while (m_dest_addrs.empty() && m_ring_addrs.empty())
         _receive_control_message();
 }
 
@@ -439,8 +530,17 @@ wint_t TilesFramework::_handle_control_message(sockaddr_un addr, string data)
         JsonWrapper primary = json_find_member(obj.node, "primary");
         primary.check(JSON_BOOL);
 
-        m_dest_addrs.push_back(addr);
         m_controlled_from_web = primary->bool_;
+
+        JsonWrapper ring = json_find_member(obj.node, "ring");
+        if (ring.node && ring->tag == JSON_BOOL && ring->bool_
+            && (m_ring.is_open() || m_ring.open(MESSAGE_RING_SIZE))
+            && _send_ring(addr))
+        {
+            m_ring_addrs.push_back(addr);
+        }
+        else
+            m_dest_addrs.push_back(addr);
     }
     else if (msgtype == "key")
     {
@@ -450,6 +550,13 @@ wint_t TilesFramework::_handle_control_message(sockaddr_un addr, string data)
         // TODO: remove this fixup call
         c = (int) keycode->number_;
     }
+    else if (msgtype == "map_format")
+    {
+        JsonWrapper version = json_find_member(obj.node, "version");
+        version.check(JSON_NUMBER);
+        m_map_format = max(0, min((int) version->number_,
+                                  PACKED_MAP_FORMAT));
+    }
     else if (msgtype == "spectator_joined")
     {
         flush_messages();
@@ -1520,6 +1627,134 @@ void TilesFramework::write_tileidx(tileidx_t t)
         tiles.write_message("[%d,%d]", lo, hi);
 }
 
+static void _pack_varint(string &out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out += (char) ((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += (char) value;
+}
+
+static uint32_t _zigzag(int value)
+{
+    return (uint32_t) value << 1 ^ (value < 0 ? 0xFFFFFFFF : 0);
+}
+
+static string _base64(const string &in)
+{
+    static const char digits[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    string out;
+    out.reserve((in.size() + 2) / 3 * 4);
+    for (size_t i = 0; i < in.size(); i += 3)
+    {
+        const size_t n = min<size_t>(3, in.size() - i);
+        uint32_t word = (uint8_t) in[i] << 16;
+        if (n > 1)
+            word |= (uint8_t) in[i + 1] << 8;
+        if (n > 2)
+            word |= (uint8_t) in[i + 2];
+        out += digits[word >> 18 & 63];
+        out += digits[word >> 12 & 63];
+        out += n > 1 ? digits[word >> 6 & 63] : '=';
+        out += n > 2 ? digits[word & 63] : '=';
+    }
+    return out;
+}
+
+void TilesFramework::_write_cell_int(packed_cell_field field,
+                                     const string &name, int value)
+{
+    if (m_packing_cells)
+    {
+        m_packed_cell.fields |= 1 << field;
+        m_packed_cell.values[field] = _zigzag(value);
+    }
+    else
+        json_write_int(name, value);
+}
+
+void TilesFramework::_write_cell_tileidx(packed_cell_field field,
+                                         const string &name, tileidx_t t)
+{
+    if (m_packing_cells)
+    {
+        m_packed_cell.fields |= 1 << field;
+        m_packed_cell.values[field] = t;
+    }
+    else
+    {
+        json_write_name(name);
+        write_tileidx(t);
+    }
+}
+
+void TilesFramework::_write_cell_flag(packed_cell_flag flag,
+                                      const string &name, bool value)
+{
+    if (m_packing_cells)
+    {
+        m_packed_cell.fields |= 1 << PCF_FLAGS;
+        m_packed_cell.flags_changed |= 1 << flag;
+        if (value)
+            m_packed_cell.flag_values |= 1 << flag;
+    }
+    else
+        json_write_bool(name, value);
+}
+
+void TilesFramework::_write_cell_glyph(char32_t glyph)
+{
+    if (m_packing_cells)
+    {
+        m_packed_cell.fields |= 1 << PCF_GLYPH;
+        m_packed_cell.values[PCF_GLYPH] = glyph;
+    }
+    else
+    {
+        char buf[5];
+        buf[wctoutf8(buf, glyph)] = 0;
+        json_write_string("g", buf);
+    }
+}
+
+// A packed cell is a varint of its packed_cell_fields, then the value of
+// each of those fields in order, as varints: zigzag-encoded for numbers,
+// the low and then high 32 bits for tile indices (whose flags are in the
+// high bits, which Javascript numbers can't hold all of at once), and for
+// PCF_FLAGS the packed_cell_flags that changed, then those flags' values.
+void TilesFramework::_pack_cell(string &out)
+{
+    const packed_map_cell &cell = m_packed_cell;
+    _pack_varint(out, cell.fields);
+    for (int field = 0; field < NUM_PCF; ++field)
+    {
+        if (!(cell.fields & 1 << field))
+            continue;
+
+        switch (field)
+        {
+        case PCF_FG:
+        case PCF_BG:
+        case PCF_CLOUD:
+            _pack_varint(out, cell.values[field] & 0xFFFFFFFF);
+            _pack_varint(out, cell.values[field] >> 32);
+            break;
+        case PCF_FLAGS:
+            _pack_varint(out, cell.flags_changed);
+            _pack_varint(out, cell.flag_values);
+            break;
+        case PCF_EXTRA:
+            break;
+        default:
+            _pack_varint(out, cell.values[field]);
+            break;
+        }
+    }
+}
+
 void TilesFramework::_send_cell(const coord_def &gc,
                                 const screen_cell_t &current_sc, const screen_cell_t &next_sc,
                                 const map_cell &current_mc, const map_cell &next_mc,
@@ -1527,7 +1762,7 @@ void TilesFramework::_send_cell(const coord_def &gc,
                                 bool force_full)
 {
     if (current_mc.feat() != next_mc.feat())
-        json_write_int("f", next_mc.feat());
+        _write_cell_int(PCF_FEAT, "f", next_mc.feat());
 
     if (next_mc.monsterinfo())
         _send_monster(gc, next_mc.monsterinfo(), new_monster_locs, force_full);
@@ -1536,27 +1771,23 @@ void TilesFramework::_send_cell(const coord_def &gc,
 
     map_feature mf = get_cell_map_feature(gc);
     if (get_cell_map_feature(current_mc) != mf)
-        json_write_int("mf", mf);
+        _write_cell_int(PCF_MAP_FEATURE, "mf", mf);
 
     // Glyph and colour
     char32_t glyph = next_sc.glyph;
     if (current_sc.glyph != glyph)
-    {
-        char buf[5];
-        buf[wctoutf8(buf, glyph)] = 0;
-        json_write_string("g", buf);
-    }
+        _write_cell_glyph(glyph);
     if ((current_sc.colour != next_sc.colour
          || current_sc.glyph == ' ') && glyph != ' ')
     {
         int col = next_sc.colour;
         col = (_get_highlight(col) << 4) | macro_colour(col & 0xF);
-        json_write_int("col", col);
+        _write_cell_int(PCF_COLOUR, "col", col);
     }
     if (current_sc.flash_colour != next_sc.flash_colour)
-        json_write_int("flc", next_sc.flash_colour);
+        _write_cell_int(PCF_FLASH_COLOUR, "flc", next_sc.flash_colour);
     if (current_sc.flash_alpha != next_sc.flash_alpha)
-        json_write_int("fla", next_sc.flash_alpha);
+        _write_cell_int(PCF_FLASH_ALPHA, "fla", next_sc.flash_alpha);
 
     json_open_object("t");
     {
@@ -1573,79 +1804,78 @@ void TilesFramework::_send_cell(const coord_def &gc,
         {
             fg_changed = true;
 
-            json_write_name("fg");
-            write_tileidx(next_pc.fg);
+            _write_cell_tileidx(PCF_FG, "fg", next_pc.fg);
             if (get_tile_texture(fg_idx) == TEX_DEFAULT)
                 json_write_int("base", (int) tileidx_known_base_item(fg_idx));
         }
 
         if (next_pc.bg != current_pc.bg)
-        {
-            json_write_name("bg");
-            write_tileidx(next_pc.bg);
-        }
+            _write_cell_tileidx(PCF_BG, "bg", next_pc.bg);
 
         if (next_pc.cloud != current_pc.cloud)
-        {
-            json_write_name("cloud");
-            write_tileidx(next_pc.cloud);
-        }
+            _write_cell_tileidx(PCF_CLOUD, "cloud", next_pc.cloud);
 
         if (next_pc.icons != current_pc.icons)
             json_write_icons(next_pc.icons);
 
         if (Options.show_blood) {
             if (next_pc.is_bloody != current_pc.is_bloody)
-                json_write_bool("bloody", next_pc.is_bloody);
+                _write_cell_flag(PCFL_BLOODY, "bloody", next_pc.is_bloody);
 
             if (next_pc.old_blood != current_pc.old_blood)
-                json_write_bool("old_blood", next_pc.old_blood);
+                _write_cell_flag(PCFL_OLD_BLOOD, "old_blood",
+                                 next_pc.old_blood);
         }
 
         if (next_pc.is_silenced != current_pc.is_silenced)
-            json_write_bool("silenced", next_pc.is_silenced);
+            _write_cell_flag(PCFL_SILENCED, "silenced", next_pc.is_silenced);
 
         if (next_pc.halo != current_pc.halo)
-            json_write_int("halo", next_pc.halo);
+            _write_cell_int(PCF_HALO, "halo", next_pc.halo);
 
         if (next_pc.is_highlighted_summoner
             != current_pc.is_highlighted_summoner)
         {
-            json_write_bool("highlighted_summoner",
-                            next_pc.is_highlighted_summoner);
+            _write_cell_flag(PCFL_HIGHLIGHTED_SUMMONER, "highlighted_summoner",
+                             next_pc.is_highlighted_summoner);
         }
 
         if (next_pc.is_sanctuary != current_pc.is_sanctuary)
-            json_write_bool("sanctuary", next_pc.is_sanctuary);
+            _write_cell_flag(PCFL_SANCTUARY, "sanctuary", next_pc.is_sanctuary);
         if (next_pc.is_blasphemy != current_pc.is_blasphemy)
-            json_write_bool("blasphemy", next_pc.is_blasphemy);
+            _write_cell_flag(PCFL_BLASPHEMY, "blasphemy", next_pc.is_blasphemy);
 
         if (next_pc.has_bfb_corpse != current_pc.has_bfb_corpse)
-            json_write_bool("has_bfb_corpse", next_pc.has_bfb_corpse);
+            _write_cell_flag(PCFL_HAS_BFB_CORPSE, "has_bfb_corpse",
+                             next_pc.has_bfb_corpse);
 
         if (next_pc.is_liquefied != current_pc.is_liquefied)
-            json_write_bool("liquefied", next_pc.is_liquefied);
+            _write_cell_flag(PCFL_LIQUEFIED, "liquefied", next_pc.is_liquefied);
 
         if (next_pc.orb_glow != current_pc.orb_glow)
-            json_write_int("orb_glow", next_pc.orb_glow);
+            _write_cell_int(PCF_ORB_GLOW, "orb_glow", next_pc.orb_glow);
 
         if (next_pc.quad_glow != current_pc.quad_glow)
-            json_write_bool("quad_glow", next_pc.quad_glow);
+            _write_cell_flag(PCFL_QUAD_GLOW, "quad_glow", next_pc.quad_glow);
 
         if (next_pc.disjunct != current_pc.disjunct)
-            json_write_bool("disjunct", next_pc.disjunct);
+            _write_cell_flag(PCFL_DISJUNCT, "disjunct", next_pc.disjunct);
 
         if (next_pc.mangrove_water != current_pc.mangrove_water)
-            json_write_bool("mangrove_water", next_pc.mangrove_water);
+            _write_cell_flag(PCFL_MANGROVE_WATER, "mangrove_water",
+                             next_pc.mangrove_water);
 
         if (next_pc.awakened_forest != current_pc.awakened_forest)
-            json_write_bool("awakened_forest", next_pc.awakened_forest);
+            _write_cell_flag(PCFL_AWAKENED_FOREST, "awakened_forest",
+                             next_pc.awakened_forest);
 
         if (next_pc.blood_rotation != current_pc.blood_rotation)
-            json_write_int("blood_rotation", next_pc.blood_rotation);
+            _write_cell_int(PCF_BLOOD_ROTATION, "blood_rotation",
+                            next_pc.blood_rotation);
 
         if (next_pc.travel_trail != current_pc.travel_trail)
-            json_write_int("travel_trail", next_pc.travel_trail);
+            _write_cell_int(PCF_TRAVEL_TRAIL, "travel_trail",
+                            next_pc.travel_trail);
 
         if (_needs_flavour(next_pc) &&
             (next_pc.flv.floor != current_pc.flv.floor
@@ -1849,7 +2079,33 @@ void TilesFramework::_send_map(bool force_full)
     if (flash_colour == BLACK)
         flash_colour = viewmap_flash_colour();
 
-    json_open_array("cells");
+    // The cells sent below; the loop marks them clean.
+    const bitset<GXM * GYM> sent_cells = m_dirty_cells;
+
+    // In the packed format, "pcells" holds a format version byte, the map
+    // width and the origin (as in the JSON coordinates), then runs of
+    // consecutive cells (counting y * GXM + x): the number of cells since
+    // the end of the last run, the number of cells in the run, and each
+    // cell as written by _pack_cell(). The fields of cells that aren't
+    // packed are in the "pcx" array, one object for each cell with
+    // PCF_EXTRA set, in order.
+    m_packing_cells = m_map_format > 0;
+    m_packed_cells.clear();
+    m_packed_run.clear();
+    int last_run_end = 0, run_start = 0, run_length = 0;
+    auto end_run = [&]()
+    {
+        if (!run_length)
+            return;
+        _pack_varint(m_packed_cells, run_start - last_run_end);
+        _pack_varint(m_packed_cells, run_length);
+        m_packed_cells += m_packed_run;
+        m_packed_run.clear();
+        last_run_end = run_start + run_length;
+        run_length = 0;
+    };
+
+    json_open_array(m_packing_cells ? "pcx" : "cells");
     for (int y = 0; y < GYM; y++)
         for (int x = 0; x < GXM; x++)
         {
@@ -1876,9 +2132,15 @@ void TilesFramework::_send_map(bool force_full)
                 m_origin = gc;
 
             json_open_object();
-            if (send_gc
-                || last_gc.x + 1 != gc.x
-                || last_gc.y != gc.y)
+            if (m_packing_cells)
+            {
+                m_packed_cell.fields = 0;
+                m_packed_cell.flags_changed = 0;
+                m_packed_cell.flag_values = 0;
+            }
+            else if (send_gc
+                     || last_gc.x + 1 != gc.x
+                     || last_gc.y != gc.y)
             {
                 json_write_int("x", x - m_origin.x);
                 json_write_int("y", y - m_origin.y);
@@ -1895,7 +2157,22 @@ void TilesFramework::_send_map(bool force_full)
                        mc, env.map_knowledge(gc),
                        new_monster_locs, force_full);
 
-            if (!json_is_empty())
+            if (m_packing_cells)
+            {
+                if (!json_is_empty())
+                    m_packed_cell.fields |= 1 << PCF_EXTRA;
+                if (m_packed_cell.fields)
+                {
+                    const int index = y * GXM + x;
+                    if (run_length && index != run_start + run_length)
+                        end_run();
+                    if (!run_length)
+                        run_start = index;
+                    ++run_length;
+                    _pack_cell(m_packed_run);
+                }
+            }
+            else if (!json_is_empty())
             {
                 send_gc = false;
                 last_gc = gc;
@@ -1904,6 +2181,21 @@ void TilesFramework::_send_map(bool force_full)
         }
     json_close_array(true);
 
+    if (m_packing_cells)
+    {
+        end_run();
+        if (!m_packed_cells.empty())
+        {
+            string packed(1, (char) m_map_format);
+            _pack_varint(packed, GXM);
+            _pack_varint(packed, _zigzag(m_origin.x));
+            _pack_varint(packed, _zigzag(m_origin.y));
+            packed += m_packed_cells;
+            json_write_string("pcells", _base64(packed));
+        }
+        m_packing_cells = false;
+    }
+
     json_close_object(true);
 
     finish_message();
@@ -1914,8 +2206,27 @@ void TilesFramework::_send_map(bool force_full)
     if (m_mcache_ref_done)
         _mcache_ref(false);
 
-    m_current_map_knowledge = env.map_knowledge;
-    m_current_view = m_next_view;
+    // Only the cells just sent can differ from what the client has, so only
+    // those are snapshotted. Copying every cell (and the monster_info,
+    // item_def and cloud_info that each map_cell holds) for every frame is
+    // expensive enough to matter with many games per server.
+    if (force_full)
+    {
+        m_current_map_knowledge = env.map_knowledge;
+        m_current_view = m_next_view;
+    }
+    else if (sent_cells.any())
+    {
+        for (int y = 0; y < GYM; y++)
+            for (int x = 0; x < GXM; x++)
+            {
+                if (!sent_cells[y * GXM + x])
+                    continue;
+                const coord_def gc(x, y);
+                m_current_map_knowledge(gc) = env.map_knowledge(gc);
+                m_current_view(gc) = m_next_view(gc);
+            }
+    }
 
     _mcache_ref(true);
     m_mcache_ref_done = true;
@@ -20,6 +20,7 @@
 #include "text-tag-type.h"
 #include "tiledoll.h"
 #include "tilemcache.h"
+#include "tileweb-ring.h"
 #include "tileweb-text.h"
 #include "viewgeom.h"
 
@@ -228,6 +229,10 @@ protected:
     int m_max_msg_size;
     string m_msg_buf;
     vector<sockaddr_un> m_dest_addrs;
+    // Webserver connections that asked to read messages from m_ring. They
+    // only get a datagram to say that there is more to read.
+    vector<sockaddr_un> m_ring_addrs;
+    WebMessageRing m_ring;
 
     bool m_controlled_from_web;
     bool m_need_flush;
@@ -235,6 +240,10 @@ protected:
     bool _send_lock; // not thread safe
 
     void _await_connection();
+    int _send_in_fragments(vector<sockaddr_un> &addrs);
+    bool _send_fragment(const sockaddr_un &addr, const char *data, int size);
+    bool _send_ring(const sockaddr_un &addr);
+    void _notify_ring_readers();
     wint_t _handle_control_message(sockaddr_un addr, string data);
     wint_t _receive_control_message();
 
@@ -291,6 +300,66 @@ protected:
     map<uint32_t, coord_def> m_monster_locs;
     bool m_need_full_map;
 
+    // Clients that ask for it with a map_format message get the common
+    // fields of map cells packed into a binary string, instead of a JSON
+    // object per cell. See _send_map() for the format.
+    enum packed_cell_field
+    {
+        PCF_FEAT,           // f
+        PCF_MAP_FEATURE,    // mf
+        PCF_GLYPH,          // g, as a code point
+        PCF_COLOUR,         // col
+        PCF_FLASH_COLOUR,   // flc
+        PCF_FLASH_ALPHA,    // fla
+        PCF_FG,             // t.fg
+        PCF_BG,             // t.bg
+        PCF_CLOUD,          // t.cloud
+        PCF_HALO,           // t.halo
+        PCF_ORB_GLOW,       // t.orb_glow
+        PCF_BLOOD_ROTATION, // t.blood_rotation
+        PCF_TRAVEL_TRAIL,   // t.travel_trail
+        PCF_FLAGS,          // changed packed_cell_flags, then their values
+        PCF_EXTRA,          // the cell's other fields, as JSON
+        NUM_PCF
+    };
+    // Boolean fields of t.
+    enum packed_cell_flag
+    {
+        PCFL_BLOODY,
+        PCFL_OLD_BLOOD,
+        PCFL_SILENCED,
+        PCFL_HIGHLIGHTED_SUMMONER,
+        PCFL_SANCTUARY,
+        PCFL_BLASPHEMY,
+        PCFL_HAS_BFB_CORPSE,
+        PCFL_LIQUEFIED,
+        PCFL_QUAD_GLOW,
+        PCFL_DISJUNCT,
+        PCFL_MANGROVE_WATER,
+        PCFL_AWAKENED_FOREST,
+        NUM_PCFL
+    };
+    struct packed_map_cell
+    {
+        uint32_t fields;
+        uint32_t flags_changed;
+        uint32_t flag_values;
+        uint64_t values[NUM_PCF];
+    };
+    int m_map_format;
+    bool m_packing_cells;
+    packed_map_cell m_packed_cell;
+    string m_packed_run;
+    string m_packed_cells;
+    void _write_cell_int(packed_cell_field field, const string &name,
+                         int value);
+    void _write_cell_tileidx(packed_cell_field field, const string &name,
+                             tileidx_t t);
+    void _write_cell_flag(packed_cell_flag flag, const string &name,
+                          bool value);
+    void _write_cell_glyph(char32_t glyph);
+    void _pack_cell(string &out);
+
     coord_def m_cursor[CURSOR_MAX];
     coord_def m_last_clicked_grid;
     bool m_text_cursor;
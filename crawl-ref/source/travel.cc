@@ -12,6 +12,7 @@
 
 #include <algorithm>
 #include <array>
+#include <bitset>
 #include <cctype>
 #include <cstdarg>
 #include <cstdio>
@@ -406,47 +407,113 @@ static bool _is_reseedable(const coord_def& c, bool ignore_danger = false)
            || !_is_safe_cloud(c);
 }
 
-struct cell_travel_safety
+// Whether travel may use each square, as is_travelsafe_square() says. Every
+// flood asks about each square several times over, and a travel or explore
+// step does several floods, so answers are kept in a bit grid for each
+// combination of its arguments (and of g_Slime_Wall_Check) and only worked
+// out once per player turn. Anything else that changes them -- exclusions,
+// travel_avoid_terrain, changes to the map out of view -- calls
+// invalidate_travel_safety().
+#define TRAVEL_SAFETY_VARIANTS 16
+
+struct travel_safety_grids
+{
+    map_bitmask known[TRAVEL_SAFETY_VARIANTS];
+    map_bitmask safe[TRAVEL_SAFETY_VARIANTS];
+    // Variants with any squares known.
+    unsigned int used;
+    level_id level;
+    int turn;
+    coord_def pos;
+
+    travel_safety_grids() : used(0), turn(-1) { }
+};
+
+static travel_safety_grids _travel_safety;
+
+// While set, is_travelsafe_square() ignores its ignore_danger and
+// try_fallback arguments, and the pathfinder's traversability settings; see
+// LevelInfo::update().
+static bool _travel_safety_fixed = false;
+
+// Bumped whenever travel safety changes other than at the end of a turn.
+static unsigned int _travel_safety_generation = 0;
+
+static void _reset_travel_safety()
+{
+    for (int v = 0; v < TRAVEL_SAFETY_VARIANTS; ++v)
+        if (_travel_safety.used & (1 << v))
+            _travel_safety.known[v].reset();
+    _travel_safety.used = 0;
+}
+
+void invalidate_travel_safety()
+{
+    _reset_travel_safety();
+    ++_travel_safety_generation;
+}
+
+// What a travel flood looked at. Squares are numbered from 1 in the order
+// the flood looked at their neighbours.
+struct travel_flood_record
 {
-    bool safe;
-    bool safe_if_ignoring_hostile_terrain;
+    // The number of each square, and the number of the square the flood was
+    // looking at when it first asked whether this one was safe; 0 for never.
+    FixedArray<int, GXM, GYM> examined_at, asked_at;
+    // What it was told then, and what crossing the square cost.
+    map_bitmask safe;
+    FixedArray<uint8_t, GXM, GYM> cost;
+    int examinations;
+    // The number of the square from which the flood reached its destination,
+    // or 0 if it didn't.
+    int dest_reached_at;
 
-    cell_travel_safety() : safe(false), safe_if_ignoring_hostile_terrain(false)
+    void clear()
     {
+        examined_at.init(0);
+        asked_at.init(0);
+        safe.reset();
+        examinations = 0;
+        dest_reached_at = 0;
     }
 };
 
-typedef FixedArray<cell_travel_safety, GXM, GYM> travel_safe_grid;
-static unique_ptr<travel_safe_grid> _travel_safe_grid;
+// For each cloud type, whether the player may travel through a remembered
+// cloud of it, someone else's and then their own; then for each trap type,
+// whether a remembered trap of it is safe.
+typedef bitset<NUM_CLOUD_TYPES * 2 + NUM_TRAPS> travel_hazard_safety;
+
+// The flood of the last travel step, for the following steps to the same
+// destination to reuse; see _reuse_travel_flood().
+struct travel_flood_cache
+{
+    travel_flood_record flood;
+    bool valid;
+    level_id level;
+    coord_def target;
+    int turn;
+    unsigned int generation;
+    // What else decides whether the player can cross a square.
+    bool slime_check;
+    bool likes_water;
+    bool water_walk;
+    bool flight;
+    bool bog_immune;
+    bool sigil_immune;
+    bool plant_passthrough;
+    travel_hazard_safety hazards;
+};
+
+static travel_flood_cache _travel_flood;
 
 class precompute_travel_safety_grid
 {
 private:
-    bool did_compute;
+    unwind_bool fixed;
 
 public:
-    precompute_travel_safety_grid() : did_compute(false)
-    {
-        if (!_travel_safe_grid)
-        {
-            did_compute = true;
-            auto tsgrid = make_unique<travel_safe_grid>();
-            travel_safe_grid &safegrid(*tsgrid);
-            for (rectangle_iterator ri(1); ri; ++ri)
-            {
-                const coord_def p(*ri);
-                cell_travel_safety &ts(safegrid(p));
-                ts.safe = is_travelsafe_square(p, false);
-                ts.safe_if_ignoring_hostile_terrain =
-                    is_travelsafe_square(p, true);
-            }
-            _travel_safe_grid = std::move(tsgrid);
-        }
-    }
-    ~precompute_travel_safety_grid()
+    precompute_travel_safety_grid() : fixed(_travel_safety_fixed, true)
     {
-        if (did_compute)
-            _travel_safe_grid.reset(nullptr);
     }
 };
 
@@ -459,22 +526,10 @@ bool is_stair_exclusion(const coord_def &p)
     return get_exclusion_radius(p) == 1;
 }
 
-// Returns true if the square at (x,y) is okay to travel over. If ignore_hostile
-// is true, returns true even for dungeon features the character can normally
-// not cross safely (deep water, lava, traps).
-bool is_travelsafe_square(const coord_def& c, bool ignore_hostile,
+// is_travelsafe_square(), worked out afresh.
+static bool _is_travelsafe_square(const coord_def& c, bool ignore_hostile,
                                   bool ignore_danger, bool try_fallback)
 {
-    if (!in_bounds(c))
-        return false;
-
-    if (_travel_safe_grid)
-    {
-        const cell_travel_safety &cell((*_travel_safe_grid)(c));
-        return ignore_hostile? cell.safe_if_ignoring_hostile_terrain
-               : cell.safe;
-    }
-
     if (!env.map_knowledge(c).known())
         return false;
 
@@ -538,6 +593,55 @@ bool is_travelsafe_square(const coord_def& c, bool ignore_hostile,
     return feat_is_traversable_now(grid, try_fallback);
 }
 
+// Returns true if the square at (x,y) is okay to travel over. If ignore_hostile
+// is true, returns true even for dungeon features the character can normally
+// not cross safely (deep water, lava, traps).
+bool is_travelsafe_square(const coord_def& c, bool ignore_hostile,
+                                  bool ignore_danger, bool try_fallback)
+{
+    if (!in_bounds(c))
+        return false;
+
+    if (_travel_safety_fixed)
+    {
+        unwind_bool fixed(_travel_safety_fixed, false);
+        unwind_bool ipt(ignore_player_traversability, false);
+        unwind_bool slime_check(g_Slime_Wall_Check, true);
+        return is_travelsafe_square(c, ignore_hostile);
+    }
+
+    // Connectivity checks while building levels don't last long enough to
+    // be worth keeping.
+    if (ignore_player_traversability || crawl_state.generating_level
+        || !crawl_state.need_save)
+    {
+        return _is_travelsafe_square(c, ignore_hostile, ignore_danger,
+                                     try_fallback);
+    }
+
+    travel_safety_grids &grids(_travel_safety);
+    if (grids.turn != you.num_turns || grids.pos != you.pos()
+        || grids.level != level_id::current())
+    {
+        _reset_travel_safety();
+        grids.turn = you.num_turns;
+        grids.pos = you.pos();
+        grids.level = level_id::current();
+    }
+
+    const int v = ignore_hostile | ignore_danger << 1 | try_fallback << 2
+                  | g_Slime_Wall_Check << 3;
+    if (!grids.known[v](c))
+    {
+        grids.safe[v].set(c, _is_travelsafe_square(c, ignore_hostile,
+                                                   ignore_danger,
+                                                   try_fallback));
+        grids.known[v].set(c);
+        grids.used |= 1 << v;
+    }
+    return grids.safe[v](c);
+}
+
 // Returns true if the location at (x,y) is monster-free and contains
 // no clouds. Travel uses this to check if the square the player is
 // about to move to is safe.
@@ -564,6 +668,7 @@ static bool _is_safe_move(const coord_def& c)
 
 void travel_init_load_level()
 {
+    invalidate_travel_safety();
     curr_excludes.clear();
     travel_cache.set_level_excludes();
     travel_cache.update_waypoints();
@@ -890,6 +995,139 @@ void explore_pickup_event(int did_pickup, int tried_pickup)
     }
 }
 
+// Which remembered clouds and traps travel may cross. Resistances that time
+// out, cloud immunity, -Tele or a c_trap_is_safe() hook can change that for
+// squares out of view, where no map change will show it.
+static travel_hazard_safety _travel_hazard_safety()
+{
+    travel_hazard_safety safe;
+    for (int i = CLOUD_NONE + 1; i < NUM_CLOUD_TYPES; ++i)
+    {
+        const cloud_type ctype = static_cast<cloud_type>(i);
+        safe[2 * i] = !is_damaging_cloud(ctype, true, false);
+        safe[2 * i + 1] = !is_damaging_cloud(ctype, true, true);
+    }
+    for (int i = 0; i < NUM_TRAPS; ++i)
+    {
+        trap_def trap;
+        trap.type = static_cast<trap_type>(i);
+        trap.ammo_qty = 1;
+        safe[2 * NUM_CLOUD_TYPES + i] = trap.is_safe();
+    }
+    return safe;
+}
+
+static void _keep_travel_flood(const coord_def &target)
+{
+    travel_flood_cache &cache(_travel_flood);
+    // Nothing to keep if pathfind() gave up straight away.
+    cache.valid = cache.flood.examinations > 0;
+    cache.level = level_id::current();
+    cache.target = target;
+    cache.turn = you.num_turns;
+    cache.generation = _travel_safety_generation;
+    cache.slime_check = !actor_slime_wall_immune(&you);
+    cache.likes_water = player_likes_water(true);
+    cache.water_walk = have_passive(passive_t::water_walk);
+    cache.flight = you.permanent_flight();
+    cache.bog_immune = you.duration[DUR_NOXIOUS_BOG];
+    cache.sigil_immune = you.is_binding_sigil_immune();
+    cache.plant_passthrough = have_passive(passive_t::pass_through_plants);
+    cache.hazards = _travel_hazard_safety();
+}
+
+/**
+ * Find the next travel move from the last travel flood, if a new flood would
+ * choose the same one.
+ *
+ * A new flood from the same destination would look at the same squares in
+ * the same order, up to the first square next to the player, unless the
+ * safety or cost of a square it asks about on the way has changed. Map
+ * knowledge only changes in view, and only between turns, so if this is
+ * called every turn it only needs to check the squares in view; anything
+ * else that changes the map calls invalidate_travel_safety(). What the
+ * player can cross out of view also depends on the player, so everything
+ * about them that decides it, down to which remembered clouds and traps are
+ * safe, is kept with the flood and must still match. This gives the same
+ * moves as flooding every step would, while mostly flooding once per level.
+ *
+ * @param      youpos The starting position.
+ * @param      target The travel destination.
+ * @param[out] move   The move to make, or the origin for none; as
+ *                    travel_pathfind::pathfind() would give it.
+ * @return whether the move could be found without a new flood.
+ */
+static bool _reuse_travel_flood(const coord_def &youpos,
+                                const coord_def &target, coord_def &move)
+{
+    travel_flood_cache &cache(_travel_flood);
+    const travel_flood_record &flood(cache.flood);
+    if (!cache.valid
+        || cache.target != target
+        || cache.level != level_id::current()
+        || cache.generation != _travel_safety_generation
+        || you.num_turns != cache.turn && you.num_turns != cache.turn + 1
+        || cache.slime_check != !actor_slime_wall_immune(&you)
+        || cache.likes_water != player_likes_water(true)
+        || cache.water_walk != have_passive(passive_t::water_walk)
+        || cache.flight != you.permanent_flight()
+        || cache.bog_immune != !!you.duration[DUR_NOXIOUS_BOG]
+        || cache.sigil_immune != you.is_binding_sigil_immune()
+        || cache.plant_passthrough
+           != have_passive(passive_t::pass_through_plants)
+        || cache.hazards != _travel_hazard_safety()
+        || !is_map_persistent())
+    {
+        cache.valid = false;
+        return false;
+    }
+
+    // Cases that pathfind() handles specially.
+    if (youpos == target || env.grid(youpos) == DNGN_TRANSPORTER
+        || !is_travelsafe_square(target, false, false, true)
+           && !is_trap(target))
+    {
+        return false;
+    }
+
+    // A new flood would stop at the first square next to us that it looked
+    // at. Where the last one started from is no different from other
+    // squares in a new flood, so that must come before the last flood got
+    // there.
+    coord_def from;
+    int first = 0;
+    for (adjacent_iterator ai(youpos); ai; ++ai)
+    {
+        const int at = flood.examined_at(*ai);
+        if (at && (!first || at < first))
+        {
+            first = at;
+            from = *ai;
+        }
+    }
+    if (!first || flood.dest_reached_at && first > flood.dest_reached_at)
+        return false;
+
+    unwind_bool slime_wall_check(g_Slime_Wall_Check, cache.slime_check);
+    for (vision_iterator ri(you); ri; ++ri)
+    {
+        const int asked = flood.asked_at(*ri);
+        if (!asked || asked >= first)
+            continue;
+        if (is_travelsafe_square(*ri) != flood.safe(*ri)
+            || _feature_traverse_cost(env.map_knowledge(*ri).feat())
+               != flood.cost(*ri))
+        {
+            cache.valid = false;
+            return false;
+        }
+    }
+
+    cache.turn = you.num_turns;
+    move = _is_safe_move(from) ? from : coord_def();
+    return true;
+}
+
 /**
  * Run the travel_pathfind algorithm with a destination with the aim of
  * determining the next travel move. Try to avoid to let travel (including
@@ -908,13 +1146,21 @@ void explore_pickup_event(int did_pickup, int tried_pickup)
  */
 static void _find_travel_pos(const coord_def& youpos, int *move_x, int *move_y)
 {
-    travel_pathfind tp;
-
-    tp.set_src_dst(youpos, you.running.pos);
-
-    coord_def dest = tp.pathfind(RMODE_TRAVEL, false);
+    coord_def dest;
+    if (!_reuse_travel_flood(youpos, you.running.pos, dest))
+    {
+        travel_pathfind tp;
+        tp.set_src_dst(youpos, you.running.pos);
+        tp.set_record(&_travel_flood.flood);
+        dest = tp.pathfind(RMODE_TRAVEL, false);
+        _keep_travel_flood(you.running.pos);
+    }
     if (dest.origin())
+    {
+        travel_pathfind tp;
+        tp.set_src_dst(youpos, you.running.pos);
         dest = tp.pathfind(RMODE_TRAVEL, true);
+    }
     coord_def new_dest = dest;
 
     // We'd either have to travel through a runed door, in which case we'll be
@@ -1233,7 +1479,7 @@ travel_pathfind::travel_pathfind()
       unexplored_place(), greedy_place(), unexplored_dist(0), greedy_dist(0),
       refdist(nullptr), reseed_points(), features(nullptr), unreachables(),
       point_distance(travel_point_distance), next_iter_points(0),
-      traveled_distance(0), circ_index(0)
+      traveled_distance(0), circ_index(0), record(nullptr)
 {
 }
 
@@ -1262,6 +1508,12 @@ void travel_pathfind::set_src_dst(const coord_def &src, const coord_def &dst)
     floodout = double_flood = false;
 }
 
+void travel_pathfind::set_record(travel_flood_record *rec)
+{
+    record = rec;
+    record->clear();
+}
+
 void travel_pathfind::set_floodseed(const coord_def &seed, bool dblflood)
 {
     start = seed;
@@ -1546,6 +1798,19 @@ bool travel_pathfind::square_slows_movement(const coord_def &c)
     return false;
 }
 
+bool travel_pathfind::square_is_travelsafe(const coord_def &c)
+{
+    const bool safe = is_travelsafe_square(c, ignore_hostile, ignore_danger,
+                                           try_fallback);
+    if (record && !record->asked_at(c))
+    {
+        record->asked_at(c) = record->examinations;
+        record->safe.set(c, safe);
+        record->cost(c) = _feature_traverse_cost(env.map_knowledge(c).feat());
+    }
+    return safe;
+}
+
 void travel_pathfind::check_square_greed(const coord_def &c)
 {
     if (greedy_dist == UNFOUND_DIST
@@ -1705,9 +1970,11 @@ bool travel_pathfind::path_flood(const coord_def &c, const coord_def &dc)
         if (_is_safe_move(c))
             next_travel_move = c;
 
+        if (record && !record->dest_reached_at)
+            record->dest_reached_at = record->examinations;
         return true;
     }
-    else if (!is_travelsafe_square(dc, ignore_hostile, ignore_danger, try_fallback))
+    else if (!square_is_travelsafe(dc))
     {
         // This point is not okay to travel on, but if this is a
         // trap, we'll want to put it on the feature vector anyway.
@@ -1817,6 +2084,9 @@ bool travel_pathfind::path_examine_point(const coord_def &c)
     if (point_traverse_delay(c))
         return false;
 
+    if (record)
+        record->examined_at(c) = ++record->examinations;
+
     bool found_target = false;
 
     // For each point, we look at all surrounding points. Take them orthogonals
@@ -70,6 +70,7 @@ bool is_travelsafe_square(const coord_def& c,
                                   bool ignore_hostile = false,
                                   bool ignore_danger = false,
                                   bool try_fallback = false);
+void invalidate_travel_safety();
 
 bool is_known_branch_id(branch_type branch);
 bool is_unknown_stair(const coord_def &p);
@@ -496,6 +497,8 @@ private:
 // travel pathfinding directly (but is used internally by interlevel travel).
 // * All coordinates are grid coords.
 // * Do not reuse one travel_pathfind for different runmodes.
+struct travel_flood_record;
+
 class travel_pathfind
 {
 public:
@@ -534,6 +537,10 @@ public:
         ignore_danger = true;
     }
 
+    // Keep a record of what the flood looked at, so that the next travel
+    // step can tell whether it would come out the same.
+    void set_record(travel_flood_record *rec);
+
     // Determine if the level is fully explored, when called after pathfind().
     int explore_status();
 
@@ -543,6 +550,7 @@ protected:
     virtual bool point_traverse_delay(const coord_def &c);
     virtual bool path_flood(const coord_def &c, const coord_def &dc);
     bool square_slows_movement(const coord_def &c);
+    bool square_is_travelsafe(const coord_def &c);
     void check_square_greed(const coord_def &c);
     void good_square(const coord_def &c);
 
@@ -623,6 +631,8 @@ protected:
     // Attempt to path through temporary obstructions (like sealed doors)
     // due to the possibility they are no longer obstructing us
     bool try_fallback;
+
+    travel_flood_record *record;
 };
 
 extern TravelCache travel_cache;
@@ -0,0 +1,86 @@
+/**
+ * @file
+ * @brief Build-time generator for los-tables.h.
+ *
+ * Casts all LOS rays the slow way (see los-rays.cc) and writes the
+ * results as tables, so that the game does not have to do this at
+ * start-up. Only los-rays.cc, ray.cc and geom2d.cc are linked in, so
+ * the few game functions they need are provided here.
+**/
+
+#include "AppHdr.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+#include "los.h"
+#include "los-rays.h"
+
+bool double_is_zero(const double x)
+{
+    return x > -EPSILON_VALUE && x < EPSILON_VALUE;
+}
+
+NORETURN void AssertFailed(const char *expr, const char *file, int line,
+                           const char *text, ...)
+{
+    fprintf(stderr, "%s:%d: ASSERT(%s) failed", file, line, expr);
+    if (text)
+    {
+        va_list args;
+        va_start(args, text);
+        fprintf(stderr, ": ");
+        vfprintf(stderr, text, args);
+        va_end(args);
+    }
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+#undef die
+NORETURN void die(const char *file, int line, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%s:%d: ", file, line);
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    exit(1);
+}
+
+NORETURN void die_noline(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: %s <output file>\n", argv[0]);
+        return 1;
+    }
+
+    FILE *out = fopen(argv[1], "w");
+    if (!out)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    write_los_tables(out, calculate_los_rays());
+
+    if (fclose(out))
+    {
+        perror(argv[1]);
+        return 1;
+    }
+    return 0;
+}
@@ -839,6 +839,8 @@ bool magic_mapping(int map_radius, int proportion, bool suppress_msg,
             mpr_comma_separated_list("You sensed ", sensed);
     }
 
+    if (did_map)
+        invalidate_travel_safety();
     return did_map;
 }
 
@@ -108,6 +108,10 @@ template_path = "./webserver/templates/"
 # Path for server-side unix sockets (to be used to communicate with crawl)
 # server_socket_path = None # None: Uses global temp dir
 
+# Read game output from a shared-memory ring that crawl writes each message
+# to once, instead of crawl sending every message to every server socket.
+# use_message_ring = True
+
 # Server name, so far only used in the ttyrec metadata
 server_id = ""
 
@@ -1,7 +1,7 @@
-define(["jquery", "comm", "./map_knowledge", "./view_data", "./monster_list",
-        "./minimap", "./dungeon_renderer"],
-function ($, comm, map_knowledge, view_data, monster_list, minimap,
-          dungeon_renderer) {
+define(["jquery", "comm", "client", "./map_knowledge", "./view_data",
+        "./monster_list", "./minimap", "./dungeon_renderer", "./packed_cells"],
+function ($, comm, client, map_knowledge, view_data, monster_list, minimap,
+          dungeon_renderer, packed_cells) {
     "use strict";
 
     function invalidate(minimap_too)
@@ -82,6 +82,8 @@ function ($, comm, map_knowledge, view_data, monster_list, minimap,
 
         if (data.cells)
             map_knowledge.merge(data.cells);
+        if (data.pcells)
+            map_knowledge.merge(packed_cells.unpack(data.pcells, data.pcx));
 
         // Mark cells overlapped by dirty cells as dirty
         $.each(map_knowledge.dirty().slice(), function (i, loc) {
@@ -105,6 +107,14 @@ function ($, comm, map_knowledge, view_data, monster_list, minimap,
         "map": handle_map_message,
     });
 
+    // Ask for map cells in the packed format. Spectators get whatever the
+    // player's client asked for.
+    $(document).off("game_init.display")
+        .on("game_init.display", function () {
+            if (!client.is_watching())
+                comm.send_message("map_format", { version: packed_cells.format });
+        });
+
     return {
         invalidate: invalidate,
         display: display,
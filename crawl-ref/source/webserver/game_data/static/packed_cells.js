@@ -0,0 +1,129 @@
+define([], function () {
+    "use strict";
+
+    // Unpacks the "pcells" of a map message into the cell objects that the
+    // JSON format sends as "cells"; see TilesFramework::_send_map() in
+    // tileweb.cc for the format.
+
+    // The newest format this client understands.
+    var FORMAT = 1;
+
+    // Fields in packed_cell_field order. Tile fields go into cell.t.
+    var fields = [
+        ["f"], ["mf"], ["g"], ["col"], ["flc"], ["fla"],
+        ["fg", "t"], ["bg", "t"], ["cloud", "t"], ["halo", "t"],
+        ["orb_glow", "t"], ["blood_rotation", "t"], ["travel_trail", "t"],
+        ["flags", "t"], ["extra"]
+    ];
+
+    // Boolean tile fields, in packed_cell_flag order.
+    var flags = [
+        "bloody", "old_blood", "silenced", "highlighted_summoner",
+        "sanctuary", "blasphemy", "has_bfb_corpse", "liquefied", "quad_glow",
+        "disjunct", "mangrove_water", "awakened_forest"
+    ];
+
+    function unpack(packed, extra)
+    {
+        var bytes = atob(packed);
+        var pos = 0;
+
+        function varint()
+        {
+            var value = 0, scale = 1, b;
+            do
+            {
+                b = bytes.charCodeAt(pos++);
+                value += (b & 0x7f) * scale;
+                scale *= 128;
+            } while (b & 0x80);
+            return value;
+        }
+
+        function number()
+        {
+            var v = varint();
+            return v % 2 ? -(v + 1) / 2 : v / 2;
+        }
+
+        // As TilesFramework::write_tileidx() would send it.
+        function tileidx()
+        {
+            var lo = varint() | 0;
+            var hi = varint() | 0;
+            return hi ? [lo, hi] : lo;
+        }
+
+        var version = bytes.charCodeAt(pos++);
+        if (version > FORMAT)
+            throw new Error("Unknown packed map format " + version);
+
+        var width = varint();
+        var origin_x = number();
+        var origin_y = number();
+
+        var cells = [];
+        var next_extra = 0;
+        var index = 0;
+        while (pos < bytes.length)
+        {
+            index += varint();
+            var count = varint();
+            for (var n = 0; n < count; n++, index++)
+            {
+                var cell = {
+                    x: index % width - origin_x,
+                    y: Math.floor(index / width) - origin_y
+                };
+                var present = varint();
+                for (var i = 0; i < fields.length; i++)
+                {
+                    if (!(present & (1 << i)))
+                        continue;
+
+                    var name = fields[i][0];
+                    var target = cell;
+                    if (fields[i][1] == "t")
+                        target = cell.t = cell.t || {};
+
+                    if (name == "fg" || name == "bg" || name == "cloud")
+                        target[name] = tileidx();
+                    else if (name == "g")
+                        target[name] = String.fromCodePoint(varint());
+                    else if (name == "flags")
+                    {
+                        var changed = varint();
+                        var values = varint();
+                        for (var f = 0; f < flags.length; f++)
+                            if (changed & (1 << f))
+                                target[flags[f]] = !!(values & (1 << f));
+                    }
+                    else if (name == "extra")
+                    {
+                        var more = extra[next_extra++];
+                        for (var prop in more)
+                        {
+                            if (prop == "t")
+                            {
+                                cell.t = cell.t || {};
+                                for (var tprop in more.t)
+                                    cell.t[tprop] = more.t[tprop];
+                            }
+                            else
+                                cell[prop] = more[prop];
+                        }
+                    }
+                    else
+                        target[name] = number();
+                }
+                cells.push(cell);
+            }
+        }
+        return cells;
+    }
+
+    return {
+        format: FORMAT,
+        unpack: unpack,
+    };
+});
@@ -102,6 +102,7 @@ defaults = {
     'allow_anon_spectate': True,
     'enable_ttyrecs': True,
     'max_chat_length': 1000,
+    'use_message_ring': True,
 }
 
 
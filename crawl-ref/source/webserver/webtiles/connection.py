@@ -1,13 +1,17 @@
 import fcntl
+import mmap
+import array
 import os
 import os.path
 import socket
+import struct
 import tempfile
 import time
 import warnings
 from datetime import datetime
 from datetime import timedelta
 
+from tornado.escape import json_decode
 from tornado.escape import json_encode
 from tornado.escape import to_unicode
 from tornado.escape import utf8
@@ -16,6 +20,11 @@ from tornado.ioloop import IOLoop
 from webtiles import config, util
 
 
+# What crawl writes to the message ring in place of a message too large for
+# it; see tileweb-ring.h.
+RING_SOCKET_MARKER = b'*{"msg":"ring_socket"}\n'
+
+
 class WebtilesSocketConnection(object):
     def __init__(self, socketpath, logger):
         self.crawl_socketpath = socketpath
@@ -29,6 +38,16 @@ class WebtilesSocketConnection(object):
 
         self.msg_buffer = None
 
+        # Shared-memory message ring, if crawl offered one; see
+        # tileweb-ring.h in the crawl source for the layout.
+        self.ring = None
+        self.ring_seq = 0
+        self.ring_capacity = 0
+        self.ring_header_size = 0
+        # Whether the ring is at a marker for a message that was too large
+        # for it, which crawl sends over the socket instead.
+        self.ring_waiting = False
+
     def connect(self, primary = True):
         if not os.path.exists(self.crawl_socketpath):
             # Wait until the socket exists
@@ -72,7 +91,8 @@ class WebtilesSocketConnection(object):
 
         msg = json_encode({
                 "msg": "attach",
-                "primary": primary
+                "primary": primary,
+                "ring": bool(config.get('use_message_ring')),
                 })
 
         self.open = True
@@ -81,9 +101,24 @@ class WebtilesSocketConnection(object):
 
     def _handle_read(self, fd, events):
         if events & IOLoop.READ:
-            data = self.socket.recv(128 * 1024, socket.MSG_DONTWAIT)
-
-            self._handle_data(data)
+            # Only the ring message carries a descriptor: the ring's.
+            data, ancdata, _, _ = self.socket.recvmsg(
+                128 * 1024, socket.CMSG_SPACE(struct.calcsize("i")),
+                socket.MSG_DONTWAIT)
+            fds = array.array("i")
+            for level, kind, cdata in ancdata:
+                if level == socket.SOL_SOCKET and kind == socket.SCM_RIGHTS:
+                    fds.frombytes(cdata[:len(cdata)
+                                        - len(cdata) % fds.itemsize])
+
+            if self.ring and data == b'\0':
+                self._read_ring()
+            elif data.startswith(b'*{"msg":"ring"') and fds:
+                self._open_ring(json_decode(data[1:]), fds[0])
+            else:
+                self._handle_data(data)
+            for fd in fds:
+                os.close(fd)
 
         if events & IOLoop.ERROR:
             pass
@@ -104,6 +139,88 @@ class WebtilesSocketConnection(object):
             if self.message_callback:
                 self.message_callback(to_unicode(data))
 
+            if self.ring_waiting:
+                # That was the message the ring was waiting for.
+                self.ring_waiting = False
+                self._read_ring()
+
+    def _open_ring(self, msg, fd):
+        try:
+            self.ring = mmap.mmap(fd, 0, access=mmap.ACCESS_READ)
+        except (OSError, ValueError):
+            self.logger.warning("Couldn't map the message ring",
+                                exc_info=True)
+            self.close()
+            return
+        magic, version, header_size, capacity = struct.unpack_from(
+                                                    "=8sIIQ", self.ring, 0)
+        if magic != b"crawlrng" or version != 3:
+            self.logger.warning("Unknown message ring format")
+            self.close()
+            return
+        self.ring_header_size = header_size
+        self.ring_capacity = capacity
+        self.ring_seq = msg["seq"]
+
+    def _ring_write_seq(self):
+        return struct.unpack_from("=Q", self.ring, 24)[0]
+
+    def _ring_reserve_seq(self):
+        return struct.unpack_from("=Q", self.ring, 32)[0]
+
+    def _read_ring(self):
+        if self.ring_waiting:
+            return
+        write_seq = self._ring_write_seq()
+        available = write_seq - self.ring_seq
+        if available <= 0:
+            return
+        start = self.ring_header_size + self.ring_seq % self.ring_capacity
+        end = start + available
+        ring_end = self.ring_header_size + self.ring_capacity
+        if end <= ring_end:
+            data = self.ring[start:end]
+        else:
+            data = (self.ring[start:ring_end]
+                    + self.ring[self.ring_header_size:end - self.ring_capacity])
+
+        # Crawl never waits for us, so it may have written over what we
+        # hadn't read yet, or be writing over what we were copying: it
+        # announces how far it is about to write before it starts. If so,
+        # start again from what it's writing now, and ask for everything to
+        # be sent again.
+        reserve_seq = self._ring_reserve_seq()
+        if reserve_seq - self.ring_seq > self.ring_capacity:
+            self.logger.warning("Fell behind reading the message ring.")
+            self.ring_seq = reserve_seq
+            self.msg_buffer = None
+            self.send_message('{"msg":"spectator_joined"}')
+            return
+
+        # Stop at a marker for a message that comes over the socket, and
+        # carry on from there once it has.
+        marker = data.find(RING_SOCKET_MARKER)
+        while marker > 0 and data[marker - 1] != b'\n'[0]:
+            marker = data.find(RING_SOCKET_MARKER, marker + 1)
+        if marker >= 0:
+            data = data[:marker]
+            self.ring_seq += marker + len(RING_SOCKET_MARKER)
+            self.ring_waiting = True
+        else:
+            self.ring_seq = write_seq
+        self._handle_stream_data(data)
+
+    def _handle_stream_data(self, data): # type: (bytes) -> None
+        # Messages in the ring are back to back, each ending with \n, and
+        # may be split between reads.
+        if self.msg_buffer is not None:
+            data = self.msg_buffer + data
+        messages = data.split(b'\n')
+        self.msg_buffer = messages.pop() or None
+        for msg in messages:
+            if self.message_callback:
+                self.message_callback(to_unicode(msg + b'\n'))
+
     def send_message(self, data): # type: (str) -> None
         start = datetime.now()
         try:
@@ -128,5 +245,9 @@ class WebtilesSocketConnection(object):
             self.socket.close()
             os.remove(self.socketpath)
             self.socket = None
+        if self.ring:
+            self.ring.close()
+            self.ring = None
+            self.ring_waiting = False
         if self.close_callback:
             self.close_callback()
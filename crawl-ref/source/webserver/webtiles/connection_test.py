@@ -0,0 +1,138 @@
+import array
+import mmap
+import socket
+import struct
+import tempfile
+
+import pytest
+
+from tornado.ioloop import IOLoop
+
+from webtiles import connection
+
+try:
+    import mock
+except ImportError:
+    from unittest import mock
+
+
+class RingWriter:
+    """Writes a message ring as crawl's WebMessageRing does."""
+
+    HEADER_SIZE = 64
+
+    def __init__(self, capacity, version=3):
+        self.file = tempfile.TemporaryFile()
+        self.file.truncate(self.HEADER_SIZE + capacity)
+        self.map = mmap.mmap(self.file.fileno(), 0)
+        self.capacity = capacity
+        self.seq = 0
+        struct.pack_into("=8sIIQQQ", self.map, 0, b"crawlrng", version,
+                         self.HEADER_SIZE, capacity, 0, 0)
+
+    def write(self, data):
+        if len(data) > self.capacity:
+            data = connection.RING_SOCKET_MARKER
+        struct.pack_into("=Q", self.map, 32, self.seq + len(data))
+        for i, byte in enumerate(data):
+            self.map[self.HEADER_SIZE + (self.seq + i) % self.capacity] = byte
+        self.seq += len(data)
+        struct.pack_into("=Q", self.map, 24, self.seq)
+
+    def close(self):
+        self.map.close()
+        self.file.close()
+
+
+@pytest.fixture
+def reader():
+    conn = connection.WebtilesSocketConnection("unused", mock.Mock())
+    conn.received = []
+    conn.message_callback = conn.received.append
+    conn.send_message = mock.Mock()
+    yield conn
+    if conn.ring:
+        conn.ring.close()
+
+
+def open_ring(reader, writer):
+    reader._open_ring({"msg": "ring", "seq": writer.seq}, writer.file.fileno())
+
+
+class Test_message_ring:
+
+    def test_messages_are_read_in_order_across_the_wrap(self, reader):
+        writer = RingWriter(64)
+        writer.write(b'{"msg":"skipped"}\n')
+        open_ring(reader, writer)
+        for i in range(10):
+            writer.write(b'{"msg":"m%d"}\n' % i)
+            if i % 3 == 2:
+                reader._read_ring()
+        reader._read_ring()
+
+        assert reader.received == ['{"msg":"m%d"}\n' % i for i in range(10)]
+        reader.send_message.assert_not_called()
+        writer.close()
+
+    def test_a_reader_that_falls_behind_asks_for_everything(self, reader):
+        writer = RingWriter(64)
+        open_ring(reader, writer)
+        for i in range(10):
+            writer.write(b'{"msg":"m%d"}\n' % i)
+        reader._read_ring()
+
+        assert reader.received == []
+        reader.send_message.assert_called_once_with(
+            '{"msg":"spectator_joined"}')
+
+        writer.write(b'{"msg":"after"}\n')
+        reader._read_ring()
+        assert reader.received == ['{"msg":"after"}\n']
+        writer.close()
+
+    def test_oversized_messages_come_over_the_socket_in_order(self, reader):
+        writer = RingWriter(64)
+        open_ring(reader, writer)
+        big = b'{"msg":"big","data":"' + b'x' * 100 + b'"}\n'
+        writer.write(b'{"msg":"before"}\n')
+        writer.write(big)
+        writer.write(b'{"msg":"after"}\n')
+        reader._read_ring()
+
+        assert reader.received == ['{"msg":"before"}\n']
+        # Further pokes don't get past the marker either.
+        reader._read_ring()
+        assert reader.received == ['{"msg":"before"}\n']
+
+        reader._handle_data(big[:50])
+        reader._handle_data(big[50:])
+        assert reader.received == ['{"msg":"before"}\n', big.decode(),
+                                   '{"msg":"after"}\n']
+        writer.close()
+
+    def test_the_ring_comes_with_its_descriptor(self, reader):
+        writer = RingWriter(64)
+        writer.write(b'{"msg":"skipped"}\n')
+        game, reader.socket = socket.socketpair(socket.AF_UNIX,
+                                                socket.SOCK_DGRAM)
+        game.sendmsg([b'*{"msg":"ring","seq":%d}\n' % writer.seq],
+                     [(socket.SOL_SOCKET, socket.SCM_RIGHTS,
+                       array.array("i", [writer.file.fileno()]))])
+        reader._handle_read(reader.socket.fileno(), IOLoop.READ)
+        writer.write(b'{"msg":"read"}\n')
+        game.send(b'\0')
+        reader._handle_read(reader.socket.fileno(), IOLoop.READ)
+
+        assert reader.received == ['{"msg":"read"}\n']
+        game.close()
+        reader.socket.close()
+        reader.socket = None
+        writer.close()
+
+    def test_other_ring_versions_are_refused(self, reader):
+        writer = RingWriter(64, version=2)
+        open_ring(reader, writer)
+
+        assert reader.ring is None
+        writer.close()
@@ -178,8 +178,9 @@ class CrawlProcessHandlerBase(object):
                 update_all_lobbys(self)
 
     def flush_messages_to_all(self):
-        for receiver in self._receivers:
-            receiver.flush_messages()
+        # spectators are usually sent exactly what the player is, so this
+        # deflates each batch once rather than once per receiver
+        ws_handler.flush_messages_shared(self._receivers)
 
     def _is_full_map_msg(self, msg):
         # heuristic: map bundles can be very large (100k+), so we don't want to
@@ -202,11 +203,14 @@ class CrawlProcessHandlerBase(object):
             self._fresh_watchers = set()
             return
         for receiver in self._receivers:
-            receiver.append_message(msg, send)
+            receiver.append_message(msg, False)
+        if send:
+            self.flush_messages_to_all()
 
     def send_to_all(self, msg, **data): # type: (str, Any) -> None
         for receiver in self._receivers:
-            receiver.send_message(msg, **data)
+            receiver.queue_message(msg, **data)
+        self.flush_messages_to_all()
 
     def chat_help_message(self, source, command, desc):
         if len(command) == 0:
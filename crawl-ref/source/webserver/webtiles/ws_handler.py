@@ -87,6 +87,10 @@ def describe_sockets(names=False):
         restricted_lobby = list_of_names([s.username for s in lobby if s.username and s.account_restricted()])
         if restricted_lobby:
             summary += "; Account restricted (lobby): %s" % restricted_lobby
+    if broadcast_compressor.compressions_saved:
+        summary += "; %d compressions shared (%.1fs saved)" % (
+            broadcast_compressor.compressions_saved,
+            broadcast_compressor.seconds_saved)
     return summary
 
 
@@ -283,6 +287,62 @@ def admin_only(f):
 MessageBundle = collections.namedtuple('MessageBundle', ["binmsg", "compressed"])
 MessageBundle.__bool__ = lambda self: bool(self.binmsg)
 
+def new_compressobj():
+    return zlib.compressobj(zlib.Z_DEFAULT_COMPRESSION, zlib.DEFLATED,
+                            -zlib.MAX_WBITS)
+
+class BroadcastCompressor(object):
+    """Deflates a message batch once for all the sockets that are about to
+    send it, e.g. a game's player and spectators.
+
+    Each client inflates everything it is sent as one continuous stream, so
+    a compressed batch can be spliced into any socket's stream as long as it
+    never refers back to data sent before it; a full flush guarantees that.
+    A socket's own compressor has to start over after it sends a shared
+    batch, since its client's window no longer matches what that compressor
+    has seen."""
+    def __init__(self):
+        self._compressobj = new_compressobj()
+        self.compressions_saved = 0
+        self.seconds_saved = 0.0
+
+    def encode(self, msg, copies):
+        # type: (str, int) -> MessageBundle
+        try:
+            binmsg = utf8(msg)
+            start = time.time()
+            compressed = self._compressobj.compress(binmsg)
+            compressed += self._compressobj.flush(zlib.Z_FULL_FLUSH)
+            self.seconds_saved += (time.time() - start) * (copies - 1)
+            self.compressions_saved += copies - 1
+            return MessageBundle(binmsg, compressed[:-4])
+        except:
+            logging.warning("Exception trying to encode shared message.",
+                            exc_info=True)
+            return MessageBundle(None, None)
+
+broadcast_compressor = BroadcastCompressor()
+
+def flush_messages_shared(receivers):
+    """Flush the message queues of `receivers`, compressing each batch that
+    more than one of them would send only once."""
+    groups = collections.OrderedDict()
+    for socket in list(receivers):
+        if socket.client_closed or not socket.deflate or not socket.message_queue:
+            socket.flush_messages()
+        else:
+            groups.setdefault(socket.message_batch(), []).append(socket)
+
+    for batch, group in groups.items():
+        bundle = None
+        if len(group) > 1:
+            bundle = broadcast_compressor.encode(batch, len(group))
+        for socket in group:
+            if bundle:
+                socket.send_shared_batch(bundle)
+            else:
+                socket.flush_messages()
+
 class CrawlWebSocket(tornado.websocket.WebSocketHandler):
     def __init__(self, app, req, **kwargs):
         tornado.websocket.WebSocketHandler.__init__(self, app, req, **kwargs)
@@ -304,9 +364,9 @@ class CrawlWebSocket(tornado.websocket.WebSocketHandler):
         current_id += 1
 
         self.deflate = True
-        self._compressobj = zlib.compressobj(zlib.Z_DEFAULT_COMPRESSION,
-                                             zlib.DEFLATED,
-                                             -zlib.MAX_WBITS)
+        self._compressobj = new_compressobj()
+        # set after sending a batch from flush_messages_shared()
+        self._compressobj_stale = False
         self.total_message_bytes = 0
         self.compressed_bytes_sent = 0
         self.uncompressed_bytes_sent = 0
@@ -1363,6 +1423,9 @@ class CrawlWebSocket(tornado.websocket.WebSocketHandler):
                 # at the end
                 # note: a compressed stream is stateful, you can't use this
                 # compressobj for other sockets
+                if self._compressobj_stale:
+                    self._compressobj = new_compressobj()
+                    self._compressobj_stale = False
                 compressed = self._compressobj.compress(binmsg)
                 compressed += self._compressobj.flush(zlib.Z_SYNC_FLUSH)
                 compressed = compressed[:-4]
@@ -1385,7 +1448,10 @@ class CrawlWebSocket(tornado.websocket.WebSocketHandler):
         if not bundle:
             self.failed_messages += 1
             return False
+        return self._write_bundle(bundle)
 
+    def _write_bundle(self, bundle):
+        # type: (MessageBundle) -> bool
         try:
             self.total_message_bytes += len(bundle.binmsg)
             if self.deflate:
@@ -1453,12 +1519,26 @@ class CrawlWebSocket(tornado.websocket.WebSocketHandler):
         if self.client_closed or len(self.message_queue) == 0:
             return False
 
-        batch = ("{\"msgs\":["
-            + ",".join(self.message_queue)
-            + "]}")
+        batch = self.message_batch()
         self.message_queue = [] # always empty the queue
         return self._send_raw_message(batch)
 
+    def message_batch(self):
+        # type: () -> str
+        return ("{\"msgs\":["
+            + ",".join(self.message_queue)
+            + "]}")
+
+    # send a batch already compressed by a BroadcastCompressor in place of
+    # the per-socket queue, which must hold exactly that batch
+    def send_shared_batch(self, bundle):
+        # type: (MessageBundle) -> bool
+        self.message_queue = []
+        if self.client_closed:
+            return False
+        self._compressobj_stale = True
+        return self._write_bundle(bundle)
+
     # n.b. this looks a lot like superclass write_message, but has a static
     # type signature that is not compatible with it, so we do not override
     # that function.
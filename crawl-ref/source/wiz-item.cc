@@ -22,6 +22,7 @@
 #include "env.h"
 #include "god-passive.h"
 #include "invent.h"
+#include "item-name.h"
 #include "item-prop.h"
 #include "item-status-flag-type.h"
 #include "items.h"
@@ -648,7 +649,10 @@ void wizard_identify_pack()
 static void _forget_item(item_def &item)
 {
     if (item_type_has_ids(item.base_type))
+    {
         you.type_ids[item.base_type][item.sub_type] = false;
+        invalidate_item_names();
+    }
 
     item.flags &= ~(ISFLAG_SEEN | ISFLAG_HANDLED | ISFLAG_THROWN | ISFLAG_IDENTIFIED
                     | ISFLAG_DROPPED | ISFLAG_NOTED_ID | ISFLAG_NOTED_GET);
@@ -1414,6 +1418,7 @@ void wizard_unidentify_all_items()
         for (const auto j : all_item_subtypes(i))
             you.type_ids[i][j] = false;
     }
+    invalidate_item_names();
 }
 
 void wizard_recharge_evokers()
@@ -63,6 +63,73 @@ namespace worley
        is 1.0. This makes an easy natural "scale" size of the cellular features. */
 #define DENSITY_ADJUSTMENT  0.398150
 
+    /* The feature points of a cube only depend on the cube, and neighbouring
+       samples keep asking about the same few cubes, so the points of recently
+       used cubes are remembered rather than churned out of the seed every
+       time. Point positions are kept already offset by the cube's
+       coordinates, which gives the same doubles as adding them each time. */
+#define MAX_CUBE_POINTS 5
+#define CUBE_CACHE_SIZE 2048
+
+    struct feature_cube
+    {
+        int32_t xi, yi, zi;
+        int32_t count; /* -1 while the slot is unused */
+        uint32_t id[MAX_CUBE_POINTS];
+        double x[MAX_CUBE_POINTS];
+        double y[MAX_CUBE_POINTS];
+        double z[MAX_CUBE_POINTS];
+    };
+
+    static feature_cube cube_cache[CUBE_CACHE_SIZE];
+    static bool cube_cache_ready = false;
+
+    static const feature_cube &_feature_cube(int32_t xi, int32_t yi,
+                                             int32_t zi)
+    {
+        /* Each cube has a random number seed based on the cube's ID number.
+           The seed might be better if it were a nonlinear hash like Perlin uses
+           for noise but we do very well with this faster simple one.
+           Our LCG uses Knuth-approved constants for maximal periods. */
+        uint32_t seed=702395077*xi + 915488749*yi + 2120969693*zi;
+
+        if (!cube_cache_ready)
+        {
+            for (feature_cube &cube : cube_cache)
+                cube.count = -1;
+            cube_cache_ready = true;
+        }
+
+        feature_cube &cube
+            = cube_cache[(seed ^ (seed >> 11) ^ (seed >> 22)) % CUBE_CACHE_SIZE];
+        if (cube.count >= 0 && cube.xi == xi && cube.yi == yi && cube.zi == zi)
+            return cube;
+
+        cube.xi = xi;
+        cube.yi = yi;
+        cube.zi = zi;
+
+        /* How many feature points are in this cube? */
+        cube.count=Poisson_count[(seed>>24)%256]; /* 256 element lookup table. Use MSB */
+
+        seed=1402024253*seed+586950981; /* churn the seed with good Knuth LCG */
+
+        for (int32_t j=0; j<cube.count; j++)
+        {
+            cube.id[j]=seed;
+            seed=1402024253*seed+586950981; /* churn */
+
+            /* compute the 0..1 feature point location's XYZ */
+            cube.x[j]=xi+(seed+0.5)*(1.0/4294967296.0);
+            seed=1402024253*seed+586950981; /* churn */
+            cube.y[j]=yi+(seed+0.5)*(1.0/4294967296.0);
+            seed=1402024253*seed+586950981; /* churn */
+            cube.z[j]=zi+(seed+0.5)*(1.0/4294967296.0);
+            seed=1402024253*seed+586950981; /* churn */
+        }
+        return cube;
+    }
+
     /* the function to merge-sort a "cube" of samples into the current best-found
        list of values. */
     static void AddSamples(int32_t xi, int32_t yi, int32_t zi, int32_t max_order,
@@ -198,38 +265,18 @@ namespace worley
             double at[3], double *F,
             double (*delta)[3], uint32_t *ID)
     {
-        double dx, dy, dz, fx, fy, fz, d2;
-        int32_t count, i, j, index;
-        uint32_t seed, this_id;
-
-        /* Each cube has a random number seed based on the cube's ID number.
-           The seed might be better if it were a nonlinear hash like Perlin uses
-           for noise but we do very well with this faster simple one.
-           Our LCG uses Knuth-approved constants for maximal periods. */
-        seed=702395077*xi + 915488749*yi + 2120969693*zi;
-
-        /* How many feature points are in this cube? */
-        count=Poisson_count[(seed>>24)%256]; /* 256 element lookup table. Use MSB */
-
-        seed=1402024253*seed+586950981; /* churn the seed with good Knuth LCG */
-
-        for (j=0; j<count; j++) /* test and insert each point into our solution */
+        const feature_cube &cube = _feature_cube(xi, yi, zi);
+        double dx[MAX_CUBE_POINTS], dy[MAX_CUBE_POINTS], dz[MAX_CUBE_POINTS];
+        double d2[MAX_CUBE_POINTS];
+        int32_t i, j, index;
+
+        /* delta from feature point to sample location, for all the points at
+           once; simple enough a loop for the compiler to vectorize. */
+        for (j=0; j<cube.count; j++)
         {
-            this_id=seed;
-            seed=1402024253*seed+586950981; /* churn */
-
-            /* compute the 0..1 feature point location's XYZ */
-            fx=(seed+0.5)*(1.0/4294967296.0);
-            seed=1402024253*seed+586950981; /* churn */
-            fy=(seed+0.5)*(1.0/4294967296.0);
-            seed=1402024253*seed+586950981; /* churn */
-            fz=(seed+0.5)*(1.0/4294967296.0);
-            seed=1402024253*seed+586950981; /* churn */
-
-            /* delta from feature point to sample location */
-            dx=xi+fx-at[0];
-            dy=yi+fy-at[1];
-            dz=zi+fz-at[2];
+            dx[j]=cube.x[j]-at[0];
+            dy[j]=cube.y[j]-at[1];
+            dz[j]=cube.z[j]-at[2];
 
             /* Distance computation!  Lots of interesting variations are
                possible here!
@@ -244,9 +291,12 @@ large deltas in your distance function, so our 3D search can find
 them! [Alternatively, change the search algorithm for your special
 cases.]
 */
-            d2=dx*dx+dy*dy+dz*dz; /* Euclidean distance, squared */
+            d2[j]=dx[j]*dx[j]+dy[j]*dy[j]+dz[j]*dz[j]; /* Euclidean distance, squared */
+        }
 
-            if (d2<F[max_order-1]) /* Is this point close enough to remember? */
+        for (j=0; j<cube.count; j++) /* test and insert each point into our solution */
+        {
+            if (d2[j]<F[max_order-1]) /* Is this point close enough to remember? */
             {
                 /* Insert the information into the output arrays if it's close enough.
                    We use an insertion sort. No need for a binary search to find
@@ -256,7 +306,7 @@ cases.]
                    F[] list. */
 
                 index=max_order;
-                while (index>0 && d2<F[index-1]) index--;
+                while (index>0 && d2[j]<F[index-1]) index--;
 
                 /* We insert this new point into slot # <index> */
 
@@ -270,11 +320,11 @@ cases.]
                     delta[i+1][2]=delta[i][2];
                 }
                 /* Insert the new point's information into the list. */
-                F[index]=d2;
-                ID[index]=this_id;
-                delta[index][0]=dx;
-                delta[index][1]=dy;
-                delta[index][2]=dz;
+                F[index]=d2[j];
+                ID[index]=cube.id[j];
+                delta[index][0]=dx[j];
+                delta[index][1]=dy[j];
+                delta[index][2]=dz[j];
             }
         }
 